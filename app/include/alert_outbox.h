@@ -0,0 +1,92 @@
+#ifndef APP_ALERT_OUTBOX_H
+#define APP_ALERT_OUTBOX_H
+
+// Durable outbox for webhook alerts.
+//
+// Every alert is appended to the outbox before it is sent and marked done
+// once the webhook accepted it, so alerts that are queued or in flight when
+// the uplink drops or the hub restarts are replayed instead of lost.
+//
+// The file is an append-only log of text records, one per line:
+//
+//   A <seq> <event_id|-> <url> <msg>   alert queued (msg: \n and \\ escaped)
+//   U <seq> <event_id|-> <url> <msg>   urgent alert queued
+//   T <seq> <attempts>                 delivery attempt started
+//   D <seq>                            delivered (or given up)
+//   K <event_id>                       event delivered earlier (kept by compaction)
+//
+// Appends are write()s; fdatasync() is batched (ALERT_OUTBOX_SYNC_MS), so a
+// power cut can lose at most that much. A torn last line is ignored on
+// replay. The log is compacted on open and whenever dead records dominate.
+//
+// Alerts with an event id are deduplicated: appending an id that is still
+// pending or was delivered recently is a no-op.
+//
+// Urgent alerts (door and connectivity changes) are handed out before the
+// others, so they don't wait behind a backlog of routine ones.
+//
+// Without a path the outbox runs in memory only (same queueing, no replay).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ALERT_OUTBOX_MAX_PENDING  1024   // alerts held before new ones are refused
+#define ALERT_OUTBOX_MSG_MAX      2000   // longer messages are truncated
+#define ALERT_OUTBOX_EVENT_ID_LEN 64
+#define ALERT_OUTBOX_URL_LEN      512
+#define ALERT_OUTBOX_SYNC_MS      100    // max delay before appended records hit disk
+#define ALERT_OUTBOX_DEDUPE_IDS   256    // delivered event ids remembered
+
+typedef enum {
+    ALERT_OUTBOX_QUEUED = 0,
+    ALERT_OUTBOX_DUPLICATE,     // event id pending or already delivered
+    ALERT_OUTBOX_FULL,          // ALERT_OUTBOX_MAX_PENDING reached
+    ALERT_OUTBOX_ERROR,         // not open, bad arguments or out of memory
+} AlertOutboxResult;
+
+typedef struct {
+    uint64_t    seq;
+    const char *event_id;    // "" if none
+    const char *url;
+    const char *msg;
+    uint32_t    attempts;    // delivery attempts so far (survives restarts)
+    bool        urgent;
+} AlertOutboxEntry;
+
+// Open (creating if needed) and replay the log at `path`, or run in memory
+// if path is NULL/empty. Replayed alerts come back from alert_outbox_take().
+bool alert_outbox_open(const char *path);
+
+// Sync and close. Pending alerts stay in the file for the next open.
+void alert_outbox_close(void);
+
+// Queue an alert. `event_id` may be NULL for alerts that need no dedupe.
+AlertOutboxResult alert_outbox_append(const char *event_id, const char *url, const char *msg,
+                                      bool urgent);
+
+// Offer each waiting alert (urgent ones first, then oldest first) to
+// `take`; alerts it returns true
+// for are handed to the caller until alert_outbox_done() or
+// alert_outbox_release(). The entry is only valid during the callback.
+int alert_outbox_take(bool (*take)(const AlertOutboxEntry *e, void *arg), void *arg);
+
+// Record a delivery attempt for a taken alert.
+void alert_outbox_attempt(uint64_t seq);
+
+// The alert was delivered (or dropped for good): forget it.
+void alert_outbox_done(uint64_t seq);
+
+// Hand a taken alert back (e.g. the sender is stopping); it stays pending.
+void alert_outbox_release(uint64_t seq);
+
+// Flush batched records if they are due. Returns ms until the next flush
+// is needed, or -1 if nothing is waiting.
+int alert_outbox_sync(void);
+
+// Alerts currently pending (waiting or taken).
+int alert_outbox_pending(void);
+
+// True if alerts are backed by a file.
+bool alert_outbox_durable(void);
+
+#endif // APP_ALERT_OUTBOX_H
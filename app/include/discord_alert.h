@@ -8,10 +8,36 @@
 // Application-level Discord alert API
 typedef char *(*AlertMsgProvider)(void *ctx);
 
+// Reference counted: the first discordStart() starts the webhook client
+// (persistent curl multi handle + its own thread); the matching last
+// discordCleanup() flushes queued alerts (bounded wait) and stops it.
 bool discordStart(void);
 void discordCleanup(void);
+
+// Queue an alert for delivery and return immediately. Requires a prior
+// discordStart(); alerts are dropped (and counted) if the outbox is full.
+// Network errors and 5xx responses are retried with backoff.
+// Alerts for the same URL within the coalescing window go out as one
+// message, paced by Discord's rate-limit headers.
 void sendDiscordAlert(const char *webhookURL, const char *msg);
 
+// Same, with an event id: an alert whose id is still pending or was
+// delivered recently (even before a restart) is ignored. NULL = no id.
+void sendDiscordAlertEvent(const char *webhookURL, const char *event_id, const char *msg);
+
+// Same, for door and connectivity alerts: sent ahead of everything else
+// queued for the URL, without waiting for the coalescing window.
+void sendDiscordAlertUrgent(const char *webhookURL, const char *event_id, const char *msg);
+
+// Back queued alerts with the durable outbox at `path` (see alert_outbox.h);
+// alerts not yet delivered at shutdown are replayed by the next
+// discordStart(). Call before discordStart(). NULL/"" keeps them in memory.
+void discord_set_outbox(const char *path);
+
+// Coalescing window for sendDiscordAlert() in ms (default 500, 0 = send
+// each alert on its own).
+void discord_set_coalesce_window(int window_ms);
+
 /**
  * Bind Discord webhook traffic to a specific network device.
  * Pass NULL or empty string to use any available interface (default).
@@ -21,6 +47,9 @@ void sendDiscordAlert(const char *webhookURL, const char *msg);
  */
 void discord_set_device(const char *device);
 
+// Monitor thread: calls `provider` whenever the hub's door state version
+// changes (hub_udp_wait_state_change) and alerts if the message differs
+// from the last one sent.
 bool startDoorAlertMonitor(AlertMsgProvider provider, void *ctx, const char *webhook_url);
 void stopDoorAlertMonitor(void);
 
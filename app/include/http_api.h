@@ -3,9 +3,16 @@
 
 #include <stdbool.h>
 
-// Small local-only HTTP API for door_system.
-// Starts a listener on `bind_addr:port` (use "127.0.0.1" to restrict to localhost).
+// Small HTTP API (and web UI) for door_system.
+// Starts a listener on `bind_addr:port` (NULL = "127.0.0.1"). Anything but
+// a loopback address is refused unless HTTP_API_TOKEN is set, since /api
+// can lock and unlock doors.
 bool http_api_start(const char *bind_addr, unsigned short port, const char *local_module_id);
 void http_api_stop(void);
 
+// Serve the web UI (UI.html, web_control.js, style.css) from `dir`. Call
+// before http_api_start(); the files are cached (with gzip variants) at
+// start, so later edits need a restart. NULL disables static serving.
+bool http_api_set_web_root(const char *dir);
+
 #endif // HTTP_API_H
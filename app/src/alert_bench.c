@@ -0,0 +1,362 @@
+/*
+ * alert_bench.c
+ * Push N alerts through the Discord alert pipeline (outbox, coalescing,
+ * rate limiting, curl client) into a local stand-in for the webhook and
+ * report throughput, end-to-end latency and loss. Nothing leaves the host.
+ *
+ * Usage: ./alert_bench [options]
+ *   -n N      alerts to send (default 1000)
+ *   -r R      send rate in alerts/s, 0 = as fast as possible (default 200)
+ *   -w MS     coalescing window (default: the client's default)
+ *   -l MS     mock response latency (default 50)
+ *   -j MS     extra random latency, 0..MS (default 0)
+ *   -e PCT    percent of requests answered 503 (default 0)
+ *   -L N      mock rate limit: N requests ... (default 5)
+ *   -P MS     ... per MS window, 0 = no limit (default 2000)
+ *   -o PATH   durable outbox file (default: memory only)
+ *   -t S      give up waiting for deliveries after S seconds (default 60)
+ *   -u URL    send to URL instead of the built-in mock
+ *
+ * The mock speaks plain HTTP/1.1 with keep-alive and answers like Discord:
+ * 204 with X-RateLimit-* headers, or 429 + Retry-After once the window's
+ * budget is spent.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "discord_alert.h"
+#include "hal/hub_metrics.h"
+#include "hal/timing.h"
+
+typedef struct {
+    int latency_ms;
+    int jitter_ms;
+    int error_pct;
+    int limit;          // requests per period, 0 = unlimited
+    int period_ms;
+} MockConfig;
+
+static MockConfig g_mock = { .latency_ms = 50, .limit = 5, .period_ms = 2000 };
+static int        g_listen_fd = -1;
+
+// Per-alert bookkeeping, indexed by alert number
+static long long   *g_sent_us;
+static long long   *g_recv_us;
+static int          g_num_alerts;
+static atomic_int   g_received;
+static atomic_int   g_duplicates;
+static pthread_mutex_t g_recv_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Mock-side counters
+static pthread_mutex_t g_bucket_lock = PTHREAD_MUTEX_INITIALIZER;
+static long long   g_window_start_ms;
+static int         g_window_used;
+static atomic_long g_requests, g_rate_limited, g_errors;
+
+// ---------- mock webhook ----------
+
+// Decide the response for one request. Returns the HTTP status and fills
+// in the rate-limit headers.
+static int mock_decide(char *hdrs, size_t cap)
+{
+    if (g_mock.error_pct > 0 && rand() % 100 < g_mock.error_pct) {
+        atomic_fetch_add(&g_errors, 1);
+        hdrs[0] = '\0';
+        return 503;
+    }
+    if (g_mock.limit <= 0 || g_mock.period_ms <= 0) {
+        hdrs[0] = '\0';
+        return 204;
+    }
+
+    pthread_mutex_lock(&g_bucket_lock);
+    long long now = getTimeInMs();
+    if (now - g_window_start_ms >= g_mock.period_ms) {
+        g_window_start_ms = now;
+        g_window_used = 0;
+    }
+    double reset_s = (double)(g_window_start_ms + g_mock.period_ms - now) / 1000.0;
+    int status = 204;
+    if (g_window_used >= g_mock.limit) {
+        status = 429;
+        snprintf(hdrs, cap,
+                 "Retry-After: %.3f\r\nX-RateLimit-Limit: %d\r\nX-RateLimit-Remaining: 0\r\n"
+                 "X-RateLimit-Reset-After: %.3f\r\n", reset_s, g_mock.limit, reset_s);
+    } else {
+        g_window_used++;
+        snprintf(hdrs, cap,
+                 "X-RateLimit-Limit: %d\r\nX-RateLimit-Remaining: %d\r\nX-RateLimit-Reset-After: %.3f\r\n",
+                 g_mock.limit, g_mock.limit - g_window_used, reset_s);
+    }
+    pthread_mutex_unlock(&g_bucket_lock);
+    if (status == 429) atomic_fetch_add(&g_rate_limited, 1);
+    return status;
+}
+
+// Record every "bench <n>" line of a delivered {"content":"..."} body.
+static void mock_record(const char *body)
+{
+    const char *p = strstr(body, "\"content\":\"");
+    if (!p) return;
+    p += strlen("\"content\":\"");
+    long long now = getTimeInUs();
+    pthread_mutex_lock(&g_recv_lock);
+    while (*p && *p != '"') {
+        int id = -1;
+        if (sscanf(p, "bench %d", &id) == 1 && id >= 0 && id < g_num_alerts) {
+            if (g_recv_us[id] == 0) {
+                g_recv_us[id] = now;
+                atomic_fetch_add(&g_received, 1);
+            } else {
+                atomic_fetch_add(&g_duplicates, 1);
+            }
+        }
+        // next line: alerts are joined with an escaped newline
+        const char *nl = strstr(p, "\\n");
+        const char *end = strchr(p, '"');
+        if (!nl || (end && nl > end)) break;
+        p = nl + 2;
+    }
+    pthread_mutex_unlock(&g_recv_lock);
+}
+
+static void *mock_conn_thread(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    char buf[16384];
+    size_t have = 0;
+
+    for (;;) {
+        char *hdr_end = NULL;
+        while (!(hdr_end = memmem(buf, have, "\r\n\r\n", 4))) {
+            if (have == sizeof(buf) - 1) goto out;
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+            if (n <= 0) goto out;
+            have += (size_t)n;
+            buf[have] = '\0';
+        }
+        size_t hdr_len = (size_t)(hdr_end - buf) + 4;
+        size_t body_len = 0;
+        char *cl = strcasestr(buf, "Content-Length:");
+        if (cl && cl < hdr_end) body_len = strtoul(cl + 15, NULL, 10);
+        if (hdr_len + body_len >= sizeof(buf)) goto out;
+        while (have < hdr_len + body_len) {
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+            if (n <= 0) goto out;
+            have += (size_t)n;
+        }
+
+        atomic_fetch_add(&g_requests, 1);
+        int delay = g_mock.latency_ms + (g_mock.jitter_ms > 0 ? rand() % (g_mock.jitter_ms + 1) : 0);
+        if (delay > 0) sleepForMs(delay);
+
+        char hdrs[256];
+        int status = mock_decide(hdrs, sizeof(hdrs));
+        if (status == 204) {
+            char saved = buf[hdr_len + body_len];
+            buf[hdr_len + body_len] = '\0';
+            mock_record(buf + hdr_len);
+            buf[hdr_len + body_len] = saved;
+        }
+
+        char resp[512];
+        int len = snprintf(resp, sizeof(resp), "HTTP/1.1 %d %s\r\n%s%s\r\n", status,
+                           status == 204 ? "No Content" : status == 429 ? "Too Many Requests"
+                                                                        : "Service Unavailable",
+                           hdrs, status == 204 ? "" : "Content-Length: 0\r\n");
+        if (send(fd, resp, (size_t)len, MSG_NOSIGNAL) < 0) goto out;
+
+        memmove(buf, buf + hdr_len + body_len, have - hdr_len - body_len);
+        have -= hdr_len + body_len;
+    }
+out:
+    close(fd);
+    return NULL;
+}
+
+static void *mock_accept_thread(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        int fd = accept(g_listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;  // listen socket closed
+        }
+        pthread_t t;
+        if (pthread_create(&t, NULL, mock_conn_thread, (void *)(intptr_t)fd) == 0) {
+            pthread_detach(t);
+        } else {
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+// Listen on an ephemeral loopback port; returns the port or 0.
+static uint16_t mock_start(pthread_t *thread)
+{
+    g_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (g_listen_fd < 0) return 0;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t alen = sizeof(addr);
+    if (bind(g_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(g_listen_fd, 64) < 0 ||
+        getsockname(g_listen_fd, (struct sockaddr *)&addr, &alen) < 0) {
+        perror("alert_bench: mock listen");
+        close(g_listen_fd);
+        return 0;
+    }
+    g_window_start_ms = getTimeInMs();
+    if (pthread_create(thread, NULL, mock_accept_thread, NULL) != 0) {
+        close(g_listen_fd);
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+// ---------- report ----------
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_client_metrics(void)
+{
+    char buf[16384];
+    hub_metrics_render(buf, sizeof(buf));
+    for (char *save = NULL, *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        if (strncmp(line, "hub_discord_", 12) == 0 && !strstr(line, "_bucket")) printf("  %s\n", line);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int n = 1000, rate = 200, window_ms = -1, timeout_s = 60;
+    const char *outbox = NULL, *url_override = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:w:l:j:e:L:P:o:t:u:h")) != -1) {
+        switch (opt) {
+        case 'n': n = atoi(optarg); break;
+        case 'r': rate = atoi(optarg); break;
+        case 'w': window_ms = atoi(optarg); break;
+        case 'l': g_mock.latency_ms = atoi(optarg); break;
+        case 'j': g_mock.jitter_ms = atoi(optarg); break;
+        case 'e': g_mock.error_pct = atoi(optarg); break;
+        case 'L': g_mock.limit = atoi(optarg); break;
+        case 'P': g_mock.period_ms = atoi(optarg); break;
+        case 'o': outbox = optarg; break;
+        case 't': timeout_s = atoi(optarg); break;
+        case 'u': url_override = optarg; break;
+        default:
+            fprintf(stderr, "Usage: %s [-n alerts] [-r rate] [-w window_ms] [-l latency_ms] [-j jitter_ms]\n"
+                            "       [-e error_pct] [-L limit] [-P period_ms] [-o outbox] [-t timeout_s] [-u url]\n",
+                    argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (n <= 0) n = 1;
+
+    g_num_alerts = n;
+    g_sent_us = calloc((size_t)n, sizeof(*g_sent_us));
+    g_recv_us = calloc((size_t)n, sizeof(*g_recv_us));
+    if (!g_sent_us || !g_recv_us) return EXIT_FAILURE;
+    srand(1);
+
+    char url[128];
+    pthread_t mock_thread;
+    bool mock_running = false;
+    if (url_override) {
+        snprintf(url, sizeof(url), "%s", url_override);
+    } else {
+        uint16_t port = mock_start(&mock_thread);
+        if (port == 0) return EXIT_FAILURE;
+        mock_running = true;
+        snprintf(url, sizeof(url), "http://127.0.0.1:%u/api/webhooks/bench", port);
+    }
+
+    if (window_ms >= 0) discord_set_coalesce_window(window_ms);
+    discord_set_outbox(outbox);
+    if (!discordStart()) {
+        fprintf(stderr, "alert_bench: discordStart failed\n");
+        return EXIT_FAILURE;
+    }
+
+    char rate_s[16];
+    snprintf(rate_s, sizeof(rate_s), "%d", rate);
+    printf("alert_bench: %d alerts at %s/s -> %s\n", n, rate > 0 ? rate_s : "max", url);
+    long long t0 = getTimeInUs();
+    for (int i = 0; i < n; i++) {
+        if (rate > 0) {
+            long long due = t0 + (long long)i * 1000000 / rate;
+            long long now = getTimeInUs();
+            if (due > now) sleepForUs(due - now);
+        }
+        char msg[64];
+        snprintf(msg, sizeof(msg), "bench %d", i);
+        g_sent_us[i] = getTimeInUs();
+        sendDiscordAlert(url, msg);
+    }
+    long long t_sent = getTimeInUs();
+
+    long long deadline = t_sent + (long long)timeout_s * 1000000;
+    while (atomic_load(&g_received) < n && getTimeInUs() < deadline && !url_override) {
+        sleepForMs(10);
+    }
+    long long t_done = getTimeInUs();
+    discordCleanup();
+
+    // Latency of every delivered alert, send -> mock received
+    long long *lat = malloc((size_t)n * sizeof(*lat));
+    int delivered = 0;
+    long long last_recv = t0;
+    for (int i = 0; lat && i < n; i++) {
+        if (g_recv_us[i] == 0) continue;
+        lat[delivered++] = g_recv_us[i] - g_sent_us[i];
+        if (g_recv_us[i] > last_recv) last_recv = g_recv_us[i];
+    }
+
+    printf("sent      %d alerts in %.3fs\n", n, (double)(t_sent - t0) / 1e6);
+    if (url_override) {
+        printf("(external URL: delivery not observed)\n");
+    } else {
+        double span = (double)(last_recv - t0) / 1e6;
+        printf("delivered %d (%.1f alerts/s), lost %d, duplicates %d, waited %.3fs\n",
+               delivered, span > 0 ? delivered / span : 0.0, n - delivered,
+               atomic_load(&g_duplicates), (double)(t_done - t_sent) / 1e6);
+        printf("requests  %ld (429: %ld, 503: %ld)\n", atomic_load(&g_requests),
+               atomic_load(&g_rate_limited), atomic_load(&g_errors));
+        if (delivered > 0) {
+            qsort(lat, (size_t)delivered, sizeof(*lat), cmp_ll);
+            printf("latency   p50 %.1fms  p90 %.1fms  p99 %.1fms  max %.1fms\n",
+                   lat[delivered / 2] / 1000.0, lat[delivered * 90 / 100] / 1000.0,
+                   lat[delivered * 99 / 100] / 1000.0, lat[delivered - 1] / 1000.0);
+        }
+    }
+    printf("client metrics:\n");
+    print_client_metrics();
+
+    free(lat);
+    if (mock_running) {
+        shutdown(g_listen_fd, SHUT_RDWR);
+        close(g_listen_fd);
+        pthread_join(mock_thread, NULL);
+    }
+    free(g_sent_us);
+    free(g_recv_us);
+    return delivered == n || url_override ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,514 @@
+#define _GNU_SOURCE
+#include "alert_outbox.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal/timing.h"
+
+#define OUTBOX_LINE_MAX   (ALERT_OUTBOX_URL_LEN + ALERT_OUTBOX_EVENT_ID_LEN + 2 * ALERT_OUTBOX_MSG_MAX + 64)
+#define OUTBOX_COMPACT_MIN_RECORDS 2048   // don't bother compacting small logs
+
+typedef struct OutboxItem {
+    struct OutboxItem *prev, *next;
+    uint64_t seq;
+    char     event_id[ALERT_OUTBOX_EVENT_ID_LEN];
+    char    *url;
+    char    *msg;
+    uint32_t attempts;
+    bool     urgent;
+    bool     taken;
+} OutboxItem;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool        g_open = false;
+static char       *g_path = NULL;      // NULL: memory only
+static int         g_fd = -1;
+static OutboxItem *g_head = NULL, *g_tail = NULL;
+static int         g_pending = 0;
+static uint64_t    g_next_seq = 1;
+static bool        g_dirty = false;
+static long long   g_dirty_since_ms = 0;
+static long        g_file_records = 0;  // lines in the log, live or dead
+// Event ids delivered recently (ring, oldest at g_done_head)
+static char        g_done_ids[ALERT_OUTBOX_DEDUPE_IDS][ALERT_OUTBOX_EVENT_ID_LEN];
+static int         g_done_head = 0;
+static int         g_done_count = 0;
+
+// ---------- in-memory state (caller holds g_lock) ----------
+
+static void list_append(OutboxItem *it)
+{
+    it->next = NULL;
+    it->prev = g_tail;
+    if (g_tail) g_tail->next = it; else g_head = it;
+    g_tail = it;
+    g_pending++;
+}
+
+static void list_remove(OutboxItem *it)
+{
+    if (it->prev) it->prev->next = it->next; else g_head = it->next;
+    if (it->next) it->next->prev = it->prev; else g_tail = it->prev;
+    g_pending--;
+}
+
+static void free_item(OutboxItem *it)
+{
+    if (!it) return;
+    free(it->url);
+    free(it->msg);
+    free(it);
+}
+
+static OutboxItem *find_item(uint64_t seq)
+{
+    for (OutboxItem *it = g_head; it; it = it->next) {
+        if (it->seq == seq) return it;
+    }
+    return NULL;
+}
+
+static void remember_done(const char *event_id)
+{
+    if (!event_id[0]) return;
+    int slot;
+    if (g_done_count < ALERT_OUTBOX_DEDUPE_IDS) {
+        slot = (g_done_head + g_done_count++) % ALERT_OUTBOX_DEDUPE_IDS;
+    } else {
+        slot = g_done_head;
+        g_done_head = (g_done_head + 1) % ALERT_OUTBOX_DEDUPE_IDS;
+    }
+    snprintf(g_done_ids[slot], sizeof(g_done_ids[slot]), "%s", event_id);
+}
+
+static bool is_duplicate(const char *event_id)
+{
+    if (!event_id[0]) return false;
+    for (OutboxItem *it = g_head; it; it = it->next) {
+        if (strcmp(it->event_id, event_id) == 0) return true;
+    }
+    for (int i = 0; i < g_done_count; i++) {
+        if (strcmp(g_done_ids[(g_done_head + i) % ALERT_OUTBOX_DEDUPE_IDS], event_id) == 0) return true;
+    }
+    return false;
+}
+
+// Event ids are single tokens in the log; "-" means "no id".
+static void sanitize_event_id(const char *in, char *out, size_t out_len)
+{
+    size_t n = 0;
+    if (in && strcmp(in, "-") != 0) {
+        for (; in[n] && n < out_len - 1; n++) {
+            out[n] = isspace((unsigned char)in[n]) ? '_' : in[n];
+        }
+    }
+    out[n] = '\0';
+}
+
+// ---------- log records ----------
+
+// Escape newlines and backslashes so a message stays on one line.
+static size_t escape_msg(const char *msg, char *out, size_t cap)
+{
+    size_t n = 0;
+    for (const char *p = msg; *p && n + 2 < cap; p++) {
+        if (*p == '\n')      { out[n++] = '\\'; out[n++] = 'n'; }
+        else if (*p == '\\') { out[n++] = '\\'; out[n++] = '\\'; }
+        else if (*p != '\r') out[n++] = *p;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+static void unescape_msg(char *s)
+{
+    char *w = s;
+    for (char *r = s; *r; r++) {
+        if (*r == '\\' && r[1] == 'n')       { *w++ = '\n'; r++; }
+        else if (*r == '\\' && r[1] == '\\') { *w++ = '\\'; r++; }
+        else *w++ = *r;
+    }
+    *w = '\0';
+}
+
+static int format_alert(char *buf, size_t cap, const OutboxItem *it)
+{
+    int n = snprintf(buf, cap, "%c %llu %s %s ", it->urgent ? 'U' : 'A',
+                     (unsigned long long)it->seq,
+                     it->event_id[0] ? it->event_id : "-", it->url);
+    if (n < 0 || (size_t)n >= cap) return -1;
+    n += (int)escape_msg(it->msg, buf + n, cap - (size_t)n - 1);
+    buf[n++] = '\n';
+    buf[n] = '\0';
+    return n;
+}
+
+static bool write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t w = write(fd, buf, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buf += w;
+        len -= (size_t)w;
+    }
+    return true;
+}
+
+// Append one record; the fdatasync is left to alert_outbox_sync().
+static void log_record(const char *buf, int len)
+{
+    if (g_fd < 0 || len <= 0) return;
+    if (!write_all(g_fd, buf, (size_t)len)) {
+        perror("[outbox] write");
+        return;
+    }
+    g_file_records++;
+    if (!g_dirty) {
+        g_dirty = true;
+        g_dirty_since_ms = getTimeInMs();
+    }
+}
+
+static void log_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void log_printf(const char *fmt, ...)
+{
+    char buf[128];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0 && (size_t)n < sizeof(buf)) log_record(buf, n);
+}
+
+static void fsync_dir_of(const char *path)
+{
+    char *copy = strdup(path);
+    if (!copy) return;
+    int dfd = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+    if (dfd >= 0) {
+        fsync(dfd);
+        close(dfd);
+    }
+    free(copy);
+}
+
+// Rewrite the log with only the live state: remembered event ids, pending
+// alerts and their attempt counts. Atomic via rename.
+static bool compact_log(void)
+{
+    if (!g_path) return true;
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        perror("[outbox] compact open");
+        return false;
+    }
+
+    char *buf = malloc(OUTBOX_LINE_MAX);
+    bool ok = buf != NULL;
+    long records = 0;
+    for (int i = 0; ok && i < g_done_count; i++) {
+        int n = snprintf(buf, OUTBOX_LINE_MAX, "K %s\n",
+                         g_done_ids[(g_done_head + i) % ALERT_OUTBOX_DEDUPE_IDS]);
+        ok = write_all(fd, buf, (size_t)n);
+        records++;
+    }
+    for (OutboxItem *it = g_head; ok && it; it = it->next) {
+        int n = format_alert(buf, OUTBOX_LINE_MAX, it);
+        ok = n > 0 && write_all(fd, buf, (size_t)n);
+        records++;
+        if (ok && it->attempts > 0) {
+            n = snprintf(buf, OUTBOX_LINE_MAX, "T %llu %u\n",
+                         (unsigned long long)it->seq, it->attempts);
+            ok = write_all(fd, buf, (size_t)n);
+            records++;
+        }
+    }
+    free(buf);
+    if (ok && fdatasync(fd) < 0) ok = false;
+    close(fd);
+    if (!ok || rename(tmp, g_path) < 0) {
+        perror("[outbox] compact");
+        unlink(tmp);
+        return false;
+    }
+    fsync_dir_of(g_path);
+
+    // Appends now go to the new file
+    int nfd = open(g_path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (nfd < 0) {
+        perror("[outbox] reopen");
+        return false;
+    }
+    if (g_fd >= 0) close(g_fd);
+    g_fd = nfd;
+    g_file_records = records;
+    g_dirty = false;
+    return true;
+}
+
+// Apply the records of an existing log. Stops at a torn last line.
+static void replay_log(FILE *f)
+{
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    long bad = 0;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[len - 1] != '\n') break;   // torn write at the tail
+        line[len - 1] = '\0';
+
+        char *save = NULL;
+        char *type = strtok_r(line, " ", &save);
+        if (!type || type[1] != '\0') { bad++; continue; }
+
+        if (type[0] == 'A' || type[0] == 'U') {
+            char *seq_s = strtok_r(NULL, " ", &save);
+            char *eid   = strtok_r(NULL, " ", &save);
+            char *url   = strtok_r(NULL, " ", &save);
+            char *msg   = save ? save : (char *)"";
+            OutboxItem *it = (seq_s && eid && url) ? calloc(1, sizeof(*it)) : NULL;
+            if (!it) { bad++; continue; }
+            unescape_msg(msg);
+            it->seq = strtoull(seq_s, NULL, 10);
+            it->urgent = type[0] == 'U';
+            sanitize_event_id(eid, it->event_id, sizeof(it->event_id));
+            it->url = strdup(url);
+            it->msg = strdup(msg);
+            if (!it->url || !it->msg || it->seq == 0) { free_item(it); bad++; continue; }
+            list_append(it);
+            if (it->seq >= g_next_seq) g_next_seq = it->seq + 1;
+        } else if (type[0] == 'T' || type[0] == 'D') {
+            char *seq_s = strtok_r(NULL, " ", &save);
+            OutboxItem *it = seq_s ? find_item(strtoull(seq_s, NULL, 10)) : NULL;
+            if (!it) continue;  // already compacted away
+            if (type[0] == 'T') {
+                char *att = strtok_r(NULL, " ", &save);
+                if (att) it->attempts = (uint32_t)strtoul(att, NULL, 10);
+            } else {
+                remember_done(it->event_id);
+                list_remove(it);
+                free_item(it);
+            }
+        } else if (type[0] == 'K') {
+            char *eid = strtok_r(NULL, " ", &save);
+            char id[ALERT_OUTBOX_EVENT_ID_LEN];
+            sanitize_event_id(eid, id, sizeof(id));
+            remember_done(id);
+        } else {
+            bad++;
+        }
+    }
+    free(line);
+    if (bad) fprintf(stderr, "[outbox] skipped %ld unreadable records\n", bad);
+}
+
+// ---------- API ----------
+
+bool alert_outbox_open(const char *path)
+{
+    pthread_mutex_lock(&g_lock);
+    if (g_open) {
+        pthread_mutex_unlock(&g_lock);
+        return true;
+    }
+    g_next_seq = 1;
+    g_done_head = g_done_count = 0;
+    g_file_records = 0;
+    g_dirty = false;
+
+    if (path && path[0]) {
+        g_path = strdup(path);
+        if (!g_path) {
+            pthread_mutex_unlock(&g_lock);
+            return false;
+        }
+        FILE *f = fopen(path, "r");
+        if (f) {
+            replay_log(f);
+            fclose(f);
+        } else if (errno != ENOENT) {
+            perror("[outbox] open");
+        }
+        if (!compact_log()) {
+            fprintf(stderr, "[outbox] %s not writable, alerts are kept in memory only\n", path);
+            free(g_path);
+            g_path = NULL;
+        } else if (g_pending > 0) {
+            fprintf(stderr, "[outbox] replaying %d pending alerts from %s\n", g_pending, path);
+        }
+    }
+    g_open = true;
+    pthread_mutex_unlock(&g_lock);
+    return true;
+}
+
+void alert_outbox_close(void)
+{
+    pthread_mutex_lock(&g_lock);
+    if (!g_open) {
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+    if (g_fd >= 0) {
+        if (g_dirty) fdatasync(g_fd);
+        close(g_fd);
+        g_fd = -1;
+    }
+    while (g_head) {
+        OutboxItem *it = g_head;
+        list_remove(it);
+        free_item(it);
+    }
+    free(g_path);
+    g_path = NULL;
+    g_dirty = false;
+    g_open = false;
+    pthread_mutex_unlock(&g_lock);
+}
+
+AlertOutboxResult alert_outbox_append(const char *event_id, const char *url, const char *msg,
+                                      bool urgent)
+{
+    if (!url || !url[0] || !msg || strlen(url) >= ALERT_OUTBOX_URL_LEN) return ALERT_OUTBOX_ERROR;
+    for (const char *p = url; *p; p++) {
+        if (isspace((unsigned char)*p)) return ALERT_OUTBOX_ERROR;
+    }
+
+    char id[ALERT_OUTBOX_EVENT_ID_LEN];
+    sanitize_event_id(event_id, id, sizeof(id));
+
+    pthread_mutex_lock(&g_lock);
+    AlertOutboxResult res = ALERT_OUTBOX_QUEUED;
+    OutboxItem *it = NULL;
+    if (!g_open) {
+        res = ALERT_OUTBOX_ERROR;
+    } else if (is_duplicate(id)) {
+        res = ALERT_OUTBOX_DUPLICATE;
+    } else if (g_pending >= ALERT_OUTBOX_MAX_PENDING) {
+        res = ALERT_OUTBOX_FULL;
+    } else if (!(it = calloc(1, sizeof(*it))) || !(it->url = strdup(url)) ||
+               !(it->msg = strndup(msg, ALERT_OUTBOX_MSG_MAX))) {
+        free_item(it);
+        res = ALERT_OUTBOX_ERROR;
+    } else {
+        it->seq = g_next_seq++;
+        it->urgent = urgent;
+        memcpy(it->event_id, id, sizeof(id));
+        list_append(it);
+        if (g_fd >= 0) {
+            char *buf = malloc(OUTBOX_LINE_MAX);
+            if (buf) log_record(buf, format_alert(buf, OUTBOX_LINE_MAX, it));
+            free(buf);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return res;
+}
+
+int alert_outbox_take(bool (*take)(const AlertOutboxEntry *e, void *arg), void *arg)
+{
+    if (!take) return 0;
+    int n = 0;
+    pthread_mutex_lock(&g_lock);
+    // Two passes: urgent alerts, then the rest
+    for (int pass = 0; pass < 2; pass++) {
+        for (OutboxItem *it = g_head; it; it = it->next) {
+            if (it->taken || it->urgent != (pass == 0)) continue;
+            AlertOutboxEntry e = {
+                .seq = it->seq, .event_id = it->event_id, .url = it->url,
+                .msg = it->msg, .attempts = it->attempts, .urgent = it->urgent,
+            };
+            if (take(&e, arg)) {
+                it->taken = true;
+                n++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return n;
+}
+
+void alert_outbox_attempt(uint64_t seq)
+{
+    pthread_mutex_lock(&g_lock);
+    OutboxItem *it = find_item(seq);
+    if (it) {
+        it->attempts++;
+        log_printf("T %llu %u\n", (unsigned long long)seq, it->attempts);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void alert_outbox_done(uint64_t seq)
+{
+    pthread_mutex_lock(&g_lock);
+    OutboxItem *it = find_item(seq);
+    if (it) {
+        log_printf("D %llu\n", (unsigned long long)seq);
+        remember_done(it->event_id);
+        list_remove(it);
+        free_item(it);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void alert_outbox_release(uint64_t seq)
+{
+    pthread_mutex_lock(&g_lock);
+    OutboxItem *it = find_item(seq);
+    if (it) it->taken = false;
+    pthread_mutex_unlock(&g_lock);
+}
+
+int alert_outbox_sync(void)
+{
+    pthread_mutex_lock(&g_lock);
+    int wait = -1;
+    if (g_fd >= 0 && g_dirty) {
+        long long age = getTimeInMs() - g_dirty_since_ms;
+        if (age < ALERT_OUTBOX_SYNC_MS) {
+            wait = (int)(ALERT_OUTBOX_SYNC_MS - age);
+        } else {
+            if (fdatasync(g_fd) < 0) perror("[outbox] fdatasync");
+            g_dirty = false;
+            // Mostly delivered alerts: shrink the log
+            long live = g_pending * 2 + g_done_count;
+            if (g_file_records > OUTBOX_COMPACT_MIN_RECORDS && g_file_records > 4 * live) {
+                compact_log();
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return wait;
+}
+
+int alert_outbox_pending(void)
+{
+    pthread_mutex_lock(&g_lock);
+    int n = g_pending;
+    pthread_mutex_unlock(&g_lock);
+    return n;
+}
+
+bool alert_outbox_durable(void)
+{
+    pthread_mutex_lock(&g_lock);
+    bool d = g_fd >= 0;
+    pthread_mutex_unlock(&g_lock);
+    return d;
+}
@@ -4,11 +4,15 @@
 #include <pthread.h>
 #include <stdatomic.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <net/if.h>
 
+#include "alert_outbox.h"
 #include "discord_alert.h"
+#include "hal/hub_metrics.h"
+#include "hal/hub_udp.h"
 #include "hal/timing.h"
 
 /* Device binding for Discord webhook traffic (optional) */
@@ -74,45 +78,743 @@ void discord_set_device(const char *device)
     pthread_mutex_unlock(&g_discord_device_lock);
 }
 
-// Discord Alert sending handling using libcurl
-bool discordStart(void){
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+// ---------- webhook client ----------
+//
+// One long-lived curl multi handle, driven by its own thread, delivers all
+// webhook POSTs. Connections, DNS lookups and TLS sessions live in a share
+// handle, so after the first alert a POST to discord.com reuses a warm
+// keep-alive connection instead of paying DNS + TCP + TLS every time.
+// sendDiscordAlert() only queues the message and returns.
+//
+// Scheduling, per webhook URL ("route"):
+//  - Alerts arriving within the coalescing window are merged into one
+//    message (newline separated, up to Discord's 2000 character limit).
+//  - Urgent alerts (door and connectivity changes) skip the window and
+//    queue ahead of every routine batch; urgent alerts still waiting for a
+//    token are merged with each other.
+//  - A token bucket paces requests. It starts at Discord's usual webhook
+//    limit and is resynced from X-RateLimit-Limit/Remaining/Reset-After.
+//  - A 429 is not a failure: the batch goes back to the head of its route
+//    and the route (or every route, for a global limit) waits Retry-After.
+//  - Network errors and 5xx responses are retried with exponential backoff
+//    on the route; other 4xx responses drop the batch.
+//
+// Alerts are written to the outbox (alert_outbox.h) before anything else
+// and only marked done once Discord accepted them, so the client thread
+// pulls its work from the outbox: fresh alerts, alerts replayed after a
+// restart and alerts that didn't fit a full route queue all arrive the
+// same way.
+
+#define DISCORD_MAX_ROUTES    4      // distinct webhook URLs
+#define DISCORD_QUEUE_MAX     64     // sealed batches per route, incl. in flight
+#define DISCORD_MAX_INFLIGHT  4      // concurrent transfers, all routes
+#define DISCORD_TIMEOUT_MS    10000  // per request
+#define DISCORD_DRAIN_MS      3000   // how long cleanup waits for the queue
+#define DISCORD_MAX_CONTENT   2000   // Discord "content" limit (characters)
+#define DISCORD_DEFAULT_WINDOW_MS 500
+#define DISCORD_BUCKET_DEFAULT    5      // requests ...
+#define DISCORD_BUCKET_PERIOD_MS  2000   // ... per period until headers say otherwise
+#define DISCORD_RESET_MARGIN_MS   50     // slack for clock skew on bucket resets
+#define DISCORD_BACKOFF_MIN_MS    1000   // first retry after a failed request
+#define DISCORD_BACKOFF_MAX_MS    60000
+
+typedef struct DiscordJob {
+    struct DiscordJob *next;
+    struct WebhookRoute *route;
+    CURL  *easy;         // set while the transfer is in the multi handle
+    char  *body;         // JSON payload
+    char   content[DISCORD_MAX_CONTENT + 1];
+    uint64_t *seqs;      // outbox entries merged into this message
+    int    num_alerts;
+    int    cap_alerts;
+    bool   urgent;       // queued ahead of routine batches
+    long long start_us;
+    // Rate-limit headers from the last response
+    double retry_after_s;
+    double reset_after_s;
+    long   limit;
+    long   remaining;
+    bool   global;
+} DiscordJob;
+
+typedef struct WebhookRoute {
+    char url[512];
+    // coalescing batch being filled
+    DiscordJob *batch;
+    long long   batch_deadline_ms;
+    // sealed batches waiting to be sent
+    DiscordJob *head, *tail;
+    int         queued;      // sealed + in flight
+    // token bucket
+    double      tokens;
+    double      capacity;
+    double      refill_per_ms;
+    long long   last_refill_ms;
+    long long   blocked_until_ms;
+    int         backoff_ms;   // current retry delay after failures
+} WebhookRoute;
+
+static pthread_mutex_t g_client_lock = PTHREAD_MUTEX_INITIALIZER;
+static int          g_client_refs = 0;
+static CURLM       *g_multi = NULL;
+static CURLSH      *g_share = NULL;
+static pthread_t    g_client_thread;
+static bool         g_client_running = false;   // loop thread alive
+static bool         g_client_draining = false;  // cleanup requested
+static WebhookRoute g_routes[DISCORD_MAX_ROUTES];
+static int          g_num_routes = 0;
+static long long    g_global_blocked_until_ms = 0;
+static int          g_window_ms = DISCORD_DEFAULT_WINDOW_MS;
+static char        *g_outbox_path = NULL;
+static struct curl_slist *g_json_headers = NULL;
+
+static pthread_mutex_t g_share_locks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *h, curl_lock_data data, curl_lock_access access, void *userp)
+{
+    (void)h; (void)access; (void)userp;
+    pthread_mutex_lock(&g_share_locks[data]);
+}
+
+static void share_unlock(CURL *h, curl_lock_data data, void *userp)
+{
+    (void)h; (void)userp;
+    pthread_mutex_unlock(&g_share_locks[data]);
+}
+
+// Discard response bodies (Discord replies 204 or a small JSON error)
+static size_t discard_body(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    (void)ptr; (void)userdata;
+    return size * nmemb;
+}
+
+// Pick the rate-limit headers out of the response.
+static size_t header_cb(char *buf, size_t size, size_t nmemb, void *userdata)
+{
+    DiscordJob *job = userdata;
+    size_t len = size * nmemb;
+    char line[128];
+    size_t n = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+    memcpy(line, buf, n);
+    line[n] = '\0';
+
+    char *colon = strchr(line, ':');
+    if (!colon) return len;
+    *colon = '\0';
+    const char *val = colon + 1;
+
+    if (strcasecmp(line, "Retry-After") == 0)                job->retry_after_s = atof(val);
+    else if (strcasecmp(line, "X-RateLimit-Reset-After") == 0) job->reset_after_s = atof(val);
+    else if (strcasecmp(line, "X-RateLimit-Limit") == 0)       job->limit = atol(val);
+    else if (strcasecmp(line, "X-RateLimit-Remaining") == 0)   job->remaining = atol(val);
+    else if (strcasecmp(line, "X-RateLimit-Global") == 0)      job->global = (strstr(val, "true") != NULL);
+    return len;
+}
+
+static void free_job(DiscordJob *job)
+{
+    if (!job) return;
+    free(job->body);
+    free(job->seqs);
+    free(job);
+}
+
+// Build {"content":"<msg>"} with JSON escaping.
+static char *build_payload(const char *msg)
+{
+    size_t n = strlen(msg);
+    char *out = malloc(n * 6 + sizeof("{\"content\":\"\"}"));
+    if (!out) return NULL;
+    char *p = out;
+    p += sprintf(p, "{\"content\":\"");
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)msg[i];
+        if (c == '"' || c == '\\') { *p++ = '\\'; *p++ = (char)c; }
+        else if (c == '\n') { *p++ = '\\'; *p++ = 'n'; }
+        else if (c < 0x20) { p += sprintf(p, "\\u%04x", c); }
+        else *p++ = (char)c;
+    }
+    strcpy(p, "\"}");
+    return out;
+}
+
+// ---------- routes (caller holds g_client_lock) ----------
+
+static WebhookRoute *find_route(const char *url, bool create)
+{
+    for (int i = 0; i < g_num_routes; i++) {
+        if (strcmp(g_routes[i].url, url) == 0) return &g_routes[i];
+    }
+    if (!create || g_num_routes >= DISCORD_MAX_ROUTES || strlen(url) >= sizeof(g_routes[0].url)) {
+        return NULL;
+    }
+    WebhookRoute *r = &g_routes[g_num_routes++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->url, sizeof(r->url), "%s", url);
+    r->capacity       = DISCORD_BUCKET_DEFAULT;
+    r->tokens         = DISCORD_BUCKET_DEFAULT;
+    r->refill_per_ms  = (double)DISCORD_BUCKET_DEFAULT / DISCORD_BUCKET_PERIOD_MS;
+    r->last_refill_ms = getTimeInMs();
+    return r;
+}
+
+// Move the batch being filled onto the route's send queue.
+static void seal_batch(WebhookRoute *r)
+{
+    DiscordJob *job = r->batch;
+    if (!job) return;
+    r->batch = NULL;
+    job->next = NULL;
+    if (r->tail) r->tail->next = job; else r->head = job;
+    r->tail = job;
+}
+
+// Put a job at the front of its class: urgent jobs go after the urgent
+// ones already waiting (FIFO among themselves), a retried routine job
+// right behind them.
+static void queue_front(WebhookRoute *r, DiscordJob *job, bool after_urgent)
+{
+    DiscordJob **p = &r->head;
+    if (after_urgent) {
+        while (*p && (*p)->urgent) p = &(*p)->next;
+    }
+    job->next = *p;
+    *p = job;
+    if (!job->next) r->tail = job;
+}
+
+static void requeue_front(WebhookRoute *r, DiscordJob *job)
+{
+    queue_front(r, job, !job->urgent);
+}
+
+// Put a failed batch back at the head of its route and hold the route for
+// an exponentially growing delay (grown once per outage, not once per
+// concurrent request failing in it). Returns the delay in ms.
+static int backoff_route(WebhookRoute *r, DiscordJob *job, long long now)
+{
+    requeue_front(r, job);
+    if (now < r->blocked_until_ms) return (int)(r->blocked_until_ms - now);
+    r->backoff_ms = r->backoff_ms ? r->backoff_ms * 2 : DISCORD_BACKOFF_MIN_MS;
+    if (r->backoff_ms > DISCORD_BACKOFF_MAX_MS) r->backoff_ms = DISCORD_BACKOFF_MAX_MS;
+    r->blocked_until_ms = now + r->backoff_ms;
+    return r->backoff_ms;
+}
+
+static bool job_add_seq(DiscordJob *job, uint64_t seq)
+{
+    if (job->num_alerts == job->cap_alerts) {
+        int cap = job->cap_alerts ? job->cap_alerts * 2 : 4;
+        uint64_t *p = realloc(job->seqs, (size_t)cap * sizeof(*p));
+        if (!p) return false;
+        job->seqs = p;
+        job->cap_alerts = cap;
+    }
+    job->seqs[job->num_alerts++] = seq;
     return true;
 }
 
-void discordCleanup(void){
-    curl_global_cleanup();
+static void refill_tokens(WebhookRoute *r, long long now)
+{
+    if (now > r->last_refill_ms) {
+        r->tokens += (double)(now - r->last_refill_ms) * r->refill_per_ms;
+        if (r->tokens > r->capacity) r->tokens = r->capacity;
+        r->last_refill_ms = now;
+    }
 }
 
-void sendDiscordAlert(const char *webhook_url, const char *msg)
+// Apply the rate-limit headers of a finished request to its route.
+static void update_bucket(WebhookRoute *r, const DiscordJob *job, long long now)
 {
-    if (!webhook_url || !msg) return;
-    CURL *curl = curl_easy_init();
+    if (job->limit > 0) {
+        r->capacity = (double)job->limit;
+        if (job->reset_after_s > 0) {
+            // Remaining requests come back over reset_after
+            double missing = (double)(job->limit - job->remaining);
+            if (missing < 1) missing = 1;
+            r->refill_per_ms = missing / (job->reset_after_s * 1000.0);
+        }
+    }
+    if (job->remaining >= 0 && job->limit > 0) {
+        // Responses can arrive out of order; never let an older, more
+        // generous Remaining undo a newer one.
+        refill_tokens(r, now);
+        if ((double)job->remaining < r->tokens) r->tokens = (double)job->remaining;
+        if (job->remaining == 0 && job->reset_after_s > 0) {
+            long long until = now + (long long)(job->reset_after_s * 1000.0)
+                              + DISCORD_RESET_MARGIN_MS;
+            if (until > r->blocked_until_ms) r->blocked_until_ms = until;
+        }
+    }
+}
+
+// ---------- transfers (client thread only) ----------
+
+static bool start_transfer(DiscordJob *job)
+{
+    free(job->body);
+    job->body = build_payload(job->content);
+    CURL *curl = job->body ? curl_easy_init() : NULL;
     if (!curl) {
-        fprintf(stderr, "curl_easy_init() failed\n");
-        return;
+        fprintf(stderr, "Discord: failed to start webhook request\n");
+        return false;
     }
 
-    char json[512];
-    snprintf(json, sizeof(json), "{\"content\":\"%s\"}", msg);
+    job->retry_after_s = 0;
+    job->reset_after_s = 0;
+    job->limit = 0;
+    job->remaining = -1;
+    job->global = false;
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    curl_easy_setopt(curl, CURLOPT_URL, job->route->url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, g_json_headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, job->body);
+    curl_easy_setopt(curl, CURLOPT_SHARE, g_share);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, job);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_body);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_cb);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, job);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)DISCORD_TIMEOUT_MS);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
 
-    curl_easy_setopt(curl, CURLOPT_URL, webhook_url);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json);
-    
     /* Set socket creation callback to bind to wlan0 if configured */
     curl_easy_setopt(curl, CURLOPT_OPENSOCKETFUNCTION, socket_callback_bind_device);
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        fprintf(stderr, "Discord webhook failed: %s\n", curl_easy_strerror(res));
+    job->easy = curl;
+    job->start_us = getTimeInUs();
+    curl_multi_add_handle(g_multi, curl);
+    for (int i = 0; i < job->num_alerts; i++) alert_outbox_attempt(job->seqs[i]);
+    return true;
+}
+
+// Account for a finished request. Rate-limited and transiently failed jobs
+// go back on their route; delivered or rejected ones leave the outbox.
+static void finish_transfer(DiscordJob *job, CURLcode res)
+{
+    long long now = getTimeInMs();
+    hub_metrics_observe(HUB_HIST_DISCORD_LATENCY_US, getTimeInUs() - job->start_us);
+
+    long http_code = 0;
+    if (res == CURLE_OK) curl_easy_getinfo(job->easy, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_multi_remove_handle(g_multi, job->easy);
+    curl_easy_cleanup(job->easy);
+    job->easy = NULL;
+
+    pthread_mutex_lock(&g_client_lock);
+    WebhookRoute *r = job->route;
+    update_bucket(r, job, now);
+
+    if (http_code == 429) {
+        double wait_s = job->retry_after_s > 0 ? job->retry_after_s : job->reset_after_s;
+        if (wait_s <= 0) wait_s = 1.0;
+        long long until = now + (long long)(wait_s * 1000.0);
+        if (job->global) {
+            if (until > g_global_blocked_until_ms) g_global_blocked_until_ms = until;
+        } else if (until > r->blocked_until_ms) {
+            r->blocked_until_ms = until;
+        }
+        r->tokens = 0;
+        requeue_front(r, job);
+        pthread_mutex_unlock(&g_client_lock);
+        fprintf(stderr, "Discord webhook rate limited; retrying in %.2fs\n", wait_s);
+        hub_metrics_inc(HUB_CTR_DISCORD_RATE_LIMITED);
+        return;
+    }
+    if (res != CURLE_OK || http_code >= 500 || http_code == 408) {
+        int delay = backoff_route(r, job, now);
+        pthread_mutex_unlock(&g_client_lock);
+        if (res != CURLE_OK) {
+            fprintf(stderr, "Discord webhook failed: %s; retrying in %dms\n",
+                    curl_easy_strerror(res), delay);
+        } else {
+            fprintf(stderr, "Discord webhook failed: HTTP %ld; retrying in %dms\n", http_code, delay);
+        }
+        hub_metrics_inc(HUB_CTR_DISCORD_FAILED);
+        return;
+    }
+    r->backoff_ms = 0;
+    r->queued--;
+    pthread_mutex_unlock(&g_client_lock);
+
+    if (http_code >= 400) {
+        fprintf(stderr, "Discord webhook rejected: HTTP %ld; dropping %d alerts\n",
+                http_code, job->num_alerts);
+        hub_metrics_inc(HUB_CTR_DISCORD_FAILED);
+    } else {
+        hub_metrics_inc(HUB_CTR_DISCORD_SENT);
+    }
+    for (int i = 0; i < job->num_alerts; i++) alert_outbox_done(job->seqs[i]);
+    free_job(job);
+}
+
+// Give a job's alerts back to the outbox without delivering them (client
+// stopping). With a durable outbox they are replayed on the next start.
+static void abandon_job(DiscordJob *job)
+{
+    for (int i = 0; i < job->num_alerts; i++) alert_outbox_release(job->seqs[i]);
+    if (!alert_outbox_durable()) hub_metrics_inc(HUB_CTR_DISCORD_FAILED);
+    free_job(job);
+}
+
+// Append an alert to a job's message if it fits. Caller holds g_client_lock.
+static bool job_merge(DiscordJob *job, const AlertOutboxEntry *e, size_t len)
+{
+    size_t used = strlen(job->content);
+    if (used + 1 + len > DISCORD_MAX_CONTENT || !job_add_seq(job, e->seq)) return false;
+    job->content[used] = '\n';
+    memcpy(job->content + used + 1, e->msg, len);
+    job->content[used + 1 + len] = '\0';
+    hub_metrics_inc(HUB_CTR_DISCORD_COALESCED);
+    return true;
+}
+
+static DiscordJob *new_job(WebhookRoute *r, const AlertOutboxEntry *e, size_t len)
+{
+    DiscordJob *job = calloc(1, sizeof(*job));
+    if (!job || !job_add_seq(job, e->seq)) {
+        free(job);
+        return NULL;
+    }
+    job->route = r;
+    job->urgent = e->urgent;
+    memcpy(job->content, e->msg, len);
+    job->content[len] = '\0';
+    r->queued++;
+    return job;
+}
+
+// An urgent alert joins an urgent job that hasn't gone out yet, or starts
+// one ahead of the routine batches. Caller holds g_client_lock.
+static bool take_urgent(WebhookRoute *r, const AlertOutboxEntry *e, size_t len)
+{
+    for (DiscordJob *j = r->head; j && j->urgent; j = j->next) {
+        if (job_merge(j, e, len)) return true;
+    }
+    if (r->queued >= DISCORD_QUEUE_MAX) return false;  // stays in the outbox
+    DiscordJob *job = new_job(r, e, len);
+    if (!job) return false;
+    queue_front(r, job, true);
+    return true;
+}
+
+typedef struct {
+    long long now;
+    uint64_t  dropped[16];   // alerts for a URL we can't route
+    int       num_dropped;
+} TakeCtx;
+
+// alert_outbox_take() callback: merge an alert into its route's open batch,
+// or start a new batch if the route has room. Caller holds g_client_lock.
+static bool take_alert(const AlertOutboxEntry *e, void *arg)
+{
+    TakeCtx *ctx = arg;
+    WebhookRoute *r = find_route(e->url, true);
+    if (!r) {
+        if (ctx->num_dropped == (int)(sizeof(ctx->dropped) / sizeof(ctx->dropped[0]))) return false;
+        ctx->dropped[ctx->num_dropped++] = e->seq;
+        return true;
+    }
+
+    size_t len = strlen(e->msg);
+    if (len > DISCORD_MAX_CONTENT) len = DISCORD_MAX_CONTENT;
+    if (e->urgent) return take_urgent(r, e, len);
+    if (r->batch) {
+        if (job_merge(r->batch, e, len)) return true;
+        seal_batch(r);
+    }
+    if (r->queued >= DISCORD_QUEUE_MAX) return false;  // stays in the outbox
+
+    DiscordJob *job = new_job(r, e, len);
+    if (!job) return false;
+    r->batch = job;
+    r->batch_deadline_ms = ctx->now + g_window_ms;
+    if (g_window_ms == 0) seal_batch(r);
+    return true;
+}
+
+// Seal expired batches and pick jobs that may be sent now. Returns the
+// number of jobs placed in ready[]; *wait_ms is set to how long the loop
+// may sleep before something else becomes due. Caller holds g_client_lock.
+static int schedule(long long now, bool draining, int free_slots,
+                    DiscordJob **ready, int *wait_ms, bool *idle)
+{
+    int n = 0;
+    long long next_due = now + 1000;
+    *idle = true;
+
+    TakeCtx take = { .now = now };
+    alert_outbox_take(take_alert, &take);
+    for (int i = 0; i < take.num_dropped; i++) {
+        fprintf(stderr, "Discord webhook dropped: too many webhook URLs\n");
+        hub_metrics_inc(HUB_CTR_DISCORD_FAILED);
+        alert_outbox_done(take.dropped[i]);
+    }
+
+    for (int i = 0; i < g_num_routes; i++) {
+        WebhookRoute *r = &g_routes[i];
+        if (r->batch) {
+            if (draining || now >= r->batch_deadline_ms) seal_batch(r);
+            else if (r->batch_deadline_ms < next_due) next_due = r->batch_deadline_ms;
+        }
+        if (r->batch || r->queued > 0) *idle = false;
+        if (!r->head) continue;
+
+        long long blocked = r->blocked_until_ms > g_global_blocked_until_ms
+                            ? r->blocked_until_ms : g_global_blocked_until_ms;
+        if (now < blocked) {
+            if (blocked < next_due) next_due = blocked;
+            continue;
+        }
+        refill_tokens(r, now);
+        while (r->head && n < free_slots && r->tokens >= 1.0) {
+            DiscordJob *job = r->head;
+            r->head = job->next;
+            if (!r->head) r->tail = NULL;
+            job->next = NULL;
+            r->tokens -= 1.0;
+            ready[n++] = job;
+        }
+        if (r->head && r->tokens < 1.0 && r->refill_per_ms > 0) {
+            long long due = now + (long long)((1.0 - r->tokens) / r->refill_per_ms) + 1;
+            if (due < next_due) next_due = due;
+        }
+    }
+
+    long long wait = next_due - now;
+    *wait_ms = wait < 0 ? 0 : (wait > 1000 ? 1000 : (int)wait);
+    return n;
+}
+
+static void *discord_client_thread(void *arg)
+{
+    (void)arg;
+    DiscordJob *active[DISCORD_MAX_INFLIGHT] = {0};
+    int inflight = 0;
+    long long drain_deadline_ms = 0;
+
+    for (;;) {
+        DiscordJob *ready[DISCORD_MAX_INFLIGHT];
+        int wait_ms = 1000;
+        bool idle = true;
+
+        pthread_mutex_lock(&g_client_lock);
+        bool draining = g_client_draining;
+        int n = schedule(getTimeInMs(), draining, DISCORD_MAX_INFLIGHT - inflight,
+                         ready, &wait_ms, &idle);
+        pthread_mutex_unlock(&g_client_lock);
+
+        for (int k = 0; k < n; k++) {
+            if (start_transfer(ready[k])) {
+                for (int i = 0; i < DISCORD_MAX_INFLIGHT; i++) {
+                    if (!active[i]) { active[i] = ready[k]; break; }
+                }
+                inflight++;
+            } else {
+                hub_metrics_inc(HUB_CTR_DISCORD_FAILED);
+                pthread_mutex_lock(&g_client_lock);
+                backoff_route(ready[k]->route, ready[k], getTimeInMs());
+                pthread_mutex_unlock(&g_client_lock);
+            }
+        }
+
+        int still_running = 0;
+        curl_multi_perform(g_multi, &still_running);
+
+        CURLMsg *msg;
+        int left = 0;
+        while ((msg = curl_multi_info_read(g_multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            for (int i = 0; i < DISCORD_MAX_INFLIGHT; i++) {
+                if (active[i] && active[i]->easy == msg->easy_handle) {
+                    finish_transfer(active[i], msg->data.result);
+                    active[i] = NULL;
+                    inflight--;
+                    wait_ms = 0;  // a slot or a token may have opened up
+                    break;
+                }
+            }
+        }
+
+        int sync_ms = alert_outbox_sync();
+        if (sync_ms >= 0 && sync_ms < wait_ms) wait_ms = sync_ms;
+
+        if (draining) {
+            if (drain_deadline_ms == 0) drain_deadline_ms = getTimeInMs() + DISCORD_DRAIN_MS;
+            if ((idle && inflight == 0) || getTimeInMs() >= drain_deadline_ms) break;
+        }
+
+        // Sleep until a socket is ready, something becomes due or an alert is queued
+        curl_multi_poll(g_multi, NULL, 0, wait_ms, NULL);
+    }
+
+    // Abandon transfers still running after the drain deadline
+    for (int i = 0; i < DISCORD_MAX_INFLIGHT; i++) {
+        if (!active[i]) continue;
+        curl_multi_remove_handle(g_multi, active[i]->easy);
+        curl_easy_cleanup(active[i]->easy);
+        abandon_job(active[i]);
+    }
+    return NULL;
+}
+
+// Discord Alert sending handling using libcurl.
+// Reference counted: every discordStart() must be paired with a
+// discordCleanup(); the client stops when the last user cleans up.
+bool discordStart(void){
+    pthread_mutex_lock(&g_client_lock);
+    if (g_client_refs++ > 0) {
+        pthread_mutex_unlock(&g_client_lock);
+        return true;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) pthread_mutex_init(&g_share_locks[i], NULL);
+
+    g_share = curl_share_init();
+    g_multi = curl_multi_init();
+    g_json_headers = curl_slist_append(NULL, "Content-Type: application/json");
+    if (!g_share || !g_multi || !g_json_headers) {
+        fprintf(stderr, "Discord: failed to create curl handles\n");
+        goto fail;
     }
+    curl_share_setopt(g_share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(g_share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    curl_multi_setopt(g_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(g_multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)DISCORD_MAX_INFLIGHT);
+
+    memset(g_routes, 0, sizeof(g_routes));
+    g_num_routes = 0;
+    g_global_blocked_until_ms = 0;
+    g_client_draining = false;
+    alert_outbox_open(g_outbox_path);
+    if (pthread_create(&g_client_thread, NULL, discord_client_thread, NULL) != 0) {
+        perror("Discord: pthread_create");
+        alert_outbox_close();
+        goto fail;
+    }
+    g_client_running = true;
+    pthread_mutex_unlock(&g_client_lock);
+    return true;
+
+fail:
+    if (g_json_headers) curl_slist_free_all(g_json_headers);
+    if (g_multi) curl_multi_cleanup(g_multi);
+    if (g_share) curl_share_cleanup(g_share);
+    g_json_headers = NULL; g_multi = NULL; g_share = NULL;
+    curl_global_cleanup();
+    g_client_refs--;
+    pthread_mutex_unlock(&g_client_lock);
+    return false;
+}
+
+void discordCleanup(void){
+    pthread_mutex_lock(&g_client_lock);
+    if (g_client_refs == 0 || --g_client_refs > 0) {
+        pthread_mutex_unlock(&g_client_lock);
+        return;
+    }
+    g_client_draining = true;
+    pthread_mutex_unlock(&g_client_lock);
+
+    // Let queued alerts go out (bounded by DISCORD_DRAIN_MS)
+    curl_multi_wakeup(g_multi);
+    pthread_join(g_client_thread, NULL);
+
+    pthread_mutex_lock(&g_client_lock);
+    g_client_running = false;
+    for (int i = 0; i < g_num_routes; i++) {
+        WebhookRoute *r = &g_routes[i];
+        seal_batch(r);
+        while (r->head) {
+            DiscordJob *next = r->head->next;
+            abandon_job(r->head);
+            r->head = next;
+        }
+    }
+    memset(g_routes, 0, sizeof(g_routes));
+    g_num_routes = 0;
+    curl_multi_cleanup(g_multi);
+    curl_share_cleanup(g_share);
+    curl_slist_free_all(g_json_headers);
+    g_multi = NULL; g_share = NULL; g_json_headers = NULL;
+    pthread_mutex_unlock(&g_client_lock);
+
+    int left = alert_outbox_pending();
+    if (left > 0 && alert_outbox_durable()) {
+        fprintf(stderr, "Discord: %d undelivered alerts kept in the outbox\n", left);
+    }
+    alert_outbox_close();
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) pthread_mutex_destroy(&g_share_locks[i]);
+    curl_global_cleanup();
+}
+
+void discord_set_coalesce_window(int window_ms)
+{
+    pthread_mutex_lock(&g_client_lock);
+    g_window_ms = window_ms < 0 ? 0 : window_ms;
+    pthread_mutex_unlock(&g_client_lock);
+}
+
+void discord_set_outbox(const char *path)
+{
+    pthread_mutex_lock(&g_client_lock);
+    free(g_outbox_path);
+    g_outbox_path = (path && path[0]) ? strdup(path) : NULL;
+    pthread_mutex_unlock(&g_client_lock);
+}
+
+// Queue an alert; returns immediately. The client thread picks it up from
+// the outbox and merges it into the route's open batch.
+static void queue_alert(const char *webhook_url, const char *event_id, const char *msg,
+                        bool urgent)
+{
+    if (!webhook_url || !msg) return;
+
+    pthread_mutex_lock(&g_client_lock);
+    bool running = g_client_running && !g_client_draining;
+    CURLM *multi = g_multi;
+    pthread_mutex_unlock(&g_client_lock);
+
+    const char *drop_reason = NULL;
+    if (!running) {
+        drop_reason = "client not started";
+    } else {
+        switch (alert_outbox_append(event_id, webhook_url, msg, urgent)) {
+        case ALERT_OUTBOX_QUEUED:    break;
+        case ALERT_OUTBOX_DUPLICATE: return;
+        case ALERT_OUTBOX_FULL:      drop_reason = "outbox full"; break;
+        default:                     drop_reason = "bad alert"; break;
+        }
+    }
+    if (drop_reason) {
+        fprintf(stderr, "Discord webhook dropped: %s\n", drop_reason);
+        hub_metrics_inc(HUB_CTR_DISCORD_FAILED);
+        return;
+    }
+    curl_multi_wakeup(multi);
+}
+
+void sendDiscordAlertEvent(const char *webhook_url, const char *event_id, const char *msg)
+{
+    queue_alert(webhook_url, event_id, msg, false);
+}
+
+void sendDiscordAlertUrgent(const char *webhook_url, const char *event_id, const char *msg)
+{
+    queue_alert(webhook_url, event_id, msg, true);
+}
+
+void sendDiscordAlert(const char *webhook_url, const char *msg)
+{
+    queue_alert(webhook_url, NULL, msg, false);
 }
 
 // Door alert thread function. The provider callback returns a freshly
@@ -132,6 +834,7 @@ void* doorAlertThread(void* arg) {
     DoorMonitorCtx *ctx = (DoorMonitorCtx *)arg;
     const char *webhook_url = ctx->webhook_url;
     char *last_msg = NULL;
+    uint64_t seen = hub_udp_state_version();
 
     if (ctx->provider) {
         char *m = ctx->provider(ctx->provider_ctx);
@@ -142,7 +845,13 @@ void* doorAlertThread(void* arg) {
         }
     }
 
+    // Sleep until the hub reports a door/lock/online change instead of
+    // polling the provider; stopDoorAlertMonitor() wakes us to exit.
     while (atomic_load(&doorThreadRunning)) {
+        uint64_t v = hub_udp_wait_state_change(seen, -1);
+        if (!atomic_load(&doorThreadRunning)) break;
+        if (v == seen) continue;
+        seen = v;
         if (ctx->provider) {
             char *m = ctx->provider(ctx->provider_ctx);
             if (m) {
@@ -154,7 +863,6 @@ void* doorAlertThread(void* arg) {
                 free(m);
             }
         }
-        sleepForMs(500);
     }
 
     free(last_msg);
@@ -187,6 +895,7 @@ void stopDoorAlertMonitor() {
     if (!atomic_load(&doorThreadRunning)) return;
 
     atomic_store(&doorThreadRunning, false);
+    hub_udp_wake_waiters();
     pthread_join(doorThreadId, NULL);
 
     if (g_ctx) {
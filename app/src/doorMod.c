@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <time.h>
 #include "hal/HC-SR04.h"
+#include "hal/door_state.h"
 #include "hal/GPIO.h"
 #include "hal/timing.h"
 #include "hal/StepperMotor.h"
@@ -10,8 +11,10 @@
 #include "hal/led_worker.h"
 #include "doorMod.h"
 #include "hal/door_udp.h"
-/* app handler init prototype */
+#include "hal/reactor.h"
+/* app handler init/stop prototypes */
 extern bool app_udp_handler_init(void);
+extern void app_udp_handler_stop(void);
 #include <pthread.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -21,90 +24,87 @@ extern bool app_udp_handler_init(void);
 #include <stdint.h>
 
 #define DEBUG
-// forward declaration for helper used below
-static void update_last_known_state(const Door_t *door);
+#define DISTANCE_MAX_AGE_MS  (3 * HC_SR04_DEFAULT_PERIOD_MS)  // older cached readings are re-awaited
+#define DISTANCE_WAIT_MS     250
+#define DOOR_HYSTERESIS_CM   1.5   // dead band around DOOR_CLOSED_THRESHOLD_CM
+#define LOCK_MIN_CONFIDENCE  0.6   // closed-door confidence required to lock
+// Snapshot of the shared door state (sampler reading + motor position).
+// A sensor reading older than DISTANCE_MAX_AGE_MS counts as
+// DISTANCE_UNKNOWN with zero confidence; with wait_fresh the call first
+// waits (bounded) for the next sample instead. Never fires the sensor.
+static void door_snapshot(DoorStateSnapshot *s, bool wait_fresh)
+{
+    door_state_read(s);
+    long long now = getTimeInMs();
+    if (now - s->sensor_ms > DISTANCE_MAX_AGE_MS && wait_fresh &&
+        hc_sr04_wait_newer(now - DISTANCE_MAX_AGE_MS, DISTANCE_WAIT_MS, NULL)) {
+        door_state_read(s);
+    }
+    if (s->sensor_ms == 0 || getTimeInMs() - s->sensor_ms > DISTANCE_MAX_AGE_MS) {
+        s->door = DISTANCE_UNKNOWN;
+        s->confidence = 0;
+    }
+}
 
-// Small helper to map Door_t -> UDP booleans
+// Report the current door state to the hub (D0 = door sensor, D1 = lock)
 static void report_door_state_udp(Door_t *door)
 {
-    // Map hardware to protocol channels:
-    // D0 -> door open/close sensor
-    // D1 -> lock state (locked/unlocked)
     if (!door) return;
 
-    bool d0_open = false;
-    bool d0_locked = false; // unused for door sensor
-    bool d1_open = false;   // unused for lock
-    bool d1_locked = false;
-
-    // Door open/close from ultrasonic distance
-    long long distance = get_distance();
-    if (distance == -1) {
-        // sensor error: don't send
+    DoorStateSnapshot s;
+    door_snapshot(&s, true);
+    if (s.door == DISTANCE_UNKNOWN) {
+        // sensor error or not settled: don't send
         return;
     }
-    // Threshold: distance >= 10 means open (matches existing logic)
-    d0_open = (distance >= DOOR_CLOSED_THRESHOLD_CM);
-
-    // Lock state from stepper position: 180 = locked
-    d1_locked = (StepperMotor_GetPosition() == 180);
-
-    // Send mapping: D0 is door sensor; D1 is lock state
-    door_udp_update(d0_open, d0_locked, d1_open, d1_locked);
-
-    // Update last-known state/time for heartbeat using existing Door_t semantics
-    update_last_known_state(door);
+    door_udp_update_state(&s);
 }
 
-// forward declaration for helper used below
-static void update_last_known_state(const Door_t *door);
-
 // --- Heartbeat & reporting support ---
-static pthread_t __heartbeat_thread;
-static int __heartbeat_running = 0;
+static int __heartbeat_timer = 0;   // reactor timer id, 0 when not reporting
 static char *__report_module_id = NULL;
 static char __report_hub_ip[64];
 static uint16_t __heartbeat_port = 0;
 static int __heartbeat_interval_ms = 1000;
-static pthread_mutex_t __door_state_lock = PTHREAD_MUTEX_INITIALIZER;
-static Door_t __last_known_door = { .state = UNKNOWN };
-static long long __last_report_time_ms = 0;
 
-static void update_last_known_state(const Door_t *door)
+// Reactor timer: the kernel keeps the deadlines, so heartbeats go out
+// on time; door_udp picks the interval (see heartbeat_rate_changed).
+static void heartbeat_tick(uint64_t expirations, void *ctx)
 {
-    pthread_mutex_lock(&__door_state_lock);
-    if (door) __last_known_door = *door;
-    __last_report_time_ms = getTimeInMs();
-    pthread_mutex_unlock(&__door_state_lock);
+    (void)expirations;
+    (void)ctx;
+    // Wait-free read of the shared state; a stale sensor keeps the
+    // last reported door state
+    DoorStateSnapshot s;
+    door_snapshot(&s, false);
+
+    // Sends the HEARTBEAT plus EVENTs for anything the reporter missed
+    door_udp_heartbeat(&s);
 }
 
-static void *heartbeat_worker(void *arg)
+// The door or lock changed: send the EVENT from the loop now rather than
+// at the next heartbeat, which may be an idle interval away.
+static void report_change(void *ctx)
 {
-    (void)arg;
-    fprintf(stderr, "[heartbeat_worker] HAL heartbeat thread started - periodically calling door_udp_update()\n");
-    // This thread calls door_udp_update() periodically to trigger
-    // the HAL's heartbeat mechanism. The HAL handles the actual
-    // HEARTBEAT packet sending via door_udp.c when conditions are met.
-    
-    while (__heartbeat_running) {
-        sleepForMs(__heartbeat_interval_ms);
-        
-        // Read current hardware state directly (don't rely on stale cached state)
-        long long distance = get_distance();
-        uint16_t stepper_pos = StepperMotor_GetPosition();
-        
-        // Map to UDP booleans:
-        // D0 = door open/close (from ultrasonic), D1 = lock state (from stepper)
-        bool d0_open = (distance >= DOOR_CLOSED_THRESHOLD_CM);      // Door open if distance >= 10cm
-        bool d0_locked = false;               // unused
-        bool d1_open = false;                 // unused
-        bool d1_locked = (stepper_pos == STEPPER_LOCKED_POSITION); // Lock is locked at 180 degrees
-        
-        // Call HAL's update function to send heartbeat/notifications
-        door_udp_update(d0_open, d0_locked, d1_open, d1_locked);
-    }
-    
-    return NULL;
+    (void)ctx;
+    DoorStateSnapshot s;
+    door_snapshot(&s, false);
+    door_udp_update_state(&s);
+}
+
+// door_state listener, called on the sampler or motion thread
+static void door_state_changed(void *ctx)
+{
+    (void)ctx;
+    reactor_post(report_change, NULL);
+}
+
+// door_udp backs the heartbeat off while the door is quiet and snaps it
+// back on activity; follow it with the timer.
+static void heartbeat_rate_changed(int interval_ms, void *ctx)
+{
+    (void)ctx;
+    if (__heartbeat_timer > 0) reactor_set_timer_period(__heartbeat_timer, interval_ms);
 }
 
 bool door_reporting_start(const char *hub_ip, uint16_t report_port, uint16_t heartbeat_port,
@@ -126,44 +126,53 @@ bool door_reporting_start(const char *hub_ip, uint16_t report_port, uint16_t hea
     fprintf(stderr, "[door_reporting_start] Enabling HAL heartbeat mode (NOTIFICATION | HEARTBEAT)\n");
     fprintf(stderr, "[door_reporting_start] About to call door_udp_init2 with module_id='%s'\n", module_id);
     if (!door_udp_init2(hub_ip, report_port, heartbeat_port, module_id, mode, heartbeat_ms)) {
-        // still allow heartbeat thread to run if desired
+        // still allow the heartbeat timer to run if desired
         fprintf(stderr, "[door_reporting_start] door_udp_init2 failed\n");
     }
 
-    // configure heartbeat thread params
+    // configure heartbeat timer params
     strncpy(__report_hub_ip, hub_ip, sizeof(__report_hub_ip)-1);
     __report_hub_ip[sizeof(__report_hub_ip)-1] = '\0';
     __heartbeat_port = heartbeat_port;
     __heartbeat_interval_ms = (heartbeat_ms > 0) ? heartbeat_ms : 1000;
     __report_module_id = strdup(module_id);
 
-    __heartbeat_running = 1;
-    if (pthread_create(&__heartbeat_thread, NULL, heartbeat_worker, NULL) != 0) {
-        __heartbeat_running = 0;
+    if (!reactor_start()) {
         free(__report_module_id);
         __report_module_id = NULL;
         return false;
     }
-
-    // initialize last report time
-    pthread_mutex_lock(&__door_state_lock);
-    __last_report_time_ms = getTimeInMs();
-    pthread_mutex_unlock(&__door_state_lock);
+    __heartbeat_timer = reactor_add_timer(__heartbeat_interval_ms, heartbeat_tick, NULL);
+    if (__heartbeat_timer < 0) {
+        __heartbeat_timer = 0;
+        reactor_stop();
+        free(__report_module_id);
+        __report_module_id = NULL;
+        return false;
+    }
+    door_udp_set_heartbeat_rate_callback(heartbeat_rate_changed, NULL);
+    door_state_set_change_callback(door_state_changed, NULL);
 
     return true;
 }
 
 void door_reporting_stop(void)
 {
-    // stop heartbeat
-    __heartbeat_running = 0;
-    pthread_join(__heartbeat_thread, NULL);
+    // stop heartbeat (callers may stop twice: CLI exit, then cleanup)
+    if (__heartbeat_timer > 0) {
+        door_state_set_change_callback(NULL, NULL);
+        door_udp_set_heartbeat_rate_callback(NULL, NULL);
+        reactor_remove(__heartbeat_timer);
+        __heartbeat_timer = 0;
+        reactor_stop();
+    }
     
     if (__report_module_id) {
         free(__report_module_id);
         __report_module_id = NULL;
     }
-    // stop notification reporting
+    // let a running command report its result, then stop the listener
+    app_udp_handler_stop();
     door_udp_close();
 }
 
@@ -175,6 +184,16 @@ bool initializeDoorSystem (){
         return false;
     }
 
+    door_state_set_lock_position(STEPPER_LOCKED_POSITION);
+
+    // The sampler thread is the only caller of get_distance() from here on
+    DistanceFilterConfig filter;
+    distance_filter_config_default(&filter, DOOR_CLOSED_THRESHOLD_CM, DOOR_HYSTERESIS_CM);
+    if (!hc_sr04_sampler_start(HC_SR04_DEFAULT_PERIOD_MS, &filter)) {
+        printf("Failed to start distance sampler.\n");
+        return false;
+    }
+
     // Initialize LEDs (best-effort)
     if (!LED_init()) {
         fprintf(stderr, "Warning: LED_init failed (continuing)\n");
@@ -186,43 +205,27 @@ bool initializeDoorSystem (){
     return true;
 }
 
-long long avgDistanceSample (void){
-    long long totalDistance = 0;
-    int sample_count = 0;
-    long long start_sampling_time = getTimeInMs();
-    while ((getTimeInMs() - start_sampling_time) < 100){
-        long long distance = get_distance();
-        if (distance != -1){
-            totalDistance += distance;
-            sample_count++;
-        }
-        sleepForMs(5); // Small delay between samples
-    }
-    if (sample_count == 0){
-        return -1; // Indicate error if no valid samples
-    }
-
-    return totalDistance / sample_count;
-}
-
-
 // Lock the door
 Door_t lockDoor (Door_t *door){
-    long long dist = avgDistanceSample();
-    if (StepperMotor_GetPosition() == 180){
+    // Debounced state from the sampler; no sampling window to wait for
+    DoorStateSnapshot s;
+    door_snapshot(&s, true);
+    DistanceClass sense = s.door;
+    if (s.locked){
         printf("Door is already locked.\n");
+        door->state = LOCKED;
     } else {
-        if (dist >= DOOR_CLOSED_THRESHOLD_CM) {
+        if (sense == DISTANCE_FAR) {
             printf("Door is open, cannot lock.\n");
             door->state = OPEN;
             LED_enqueue_lock_failure();
         }
-        else if (dist == -1) {
+        else if (sense == DISTANCE_UNKNOWN || s.confidence < LOCK_MIN_CONFIDENCE) {
             printf("Ultrasonic sensor error, cannot lock door.\n");
             door->state = UNKNOWN;
             LED_enqueue_status_door_error();
         }
-        else if (dist < DOOR_CLOSED_THRESHOLD_CM) {
+        else if (sense == DISTANCE_NEAR) {
             if (StepperMotor_Rotate(180)){
                 printf("Door locked successfully.\n");
                 // Update door state
@@ -245,20 +248,20 @@ Door_t lockDoor (Door_t *door){
 
 // Unlock the door
 Door_t unlockDoor (Door_t *door){
-    if (StepperMotor_GetPosition() == 0){
+    DoorStateSnapshot s;
+    door_snapshot(&s, true);
+    if (s.motor_degrees == STEPPER_UNLOCKED_POSITION && !s.motor_moving){
         printf("Door is already unlocked.\n");
+        door->state = UNLOCKED;
     } else {
-        long long distance = get_distance();
+        DistanceClass sense = s.door;
 
-        /* If our last-known state indicates the door was previously locked
-           (for example from a recent heartbeat or event), allow unlocking
-           without re-checking the ultrasonic sensor. This helps when the
-           sensor is noisy or briefly unreliable right after a lock change. */
-        pthread_mutex_lock(&__door_state_lock);
-        bool last_was_locked = (__last_known_door.state == LOCKED);
-        pthread_mutex_unlock(&__door_state_lock);
+        /* A locked door is unlocked without re-checking the ultrasonic
+           sensor. This helps when the sensor is noisy or briefly
+           unreliable right after a lock change. */
+        bool last_was_locked = s.locked;
 
-        if (last_was_locked || StepperMotor_GetPosition() == STEPPER_LOCKED_POSITION) {
+        if (last_was_locked) {
             // Attempt unlock without checking distance
             if (StepperMotor_Rotate(STEPPER_UNLOCKED_POSITION)) {
                 printf("Door unlocked successfully.\n");
@@ -269,7 +272,7 @@ Door_t unlockDoor (Door_t *door){
                 LED_enqueue_unlock_failure();
             }
         }
-        else if (distance >= DOOR_CLOSED_THRESHOLD_CM) {
+        else if (sense == DISTANCE_FAR) {
             printf("Door is open, cannot unlock.\n");
             door->state = OPEN;
             LED_enqueue_unlock_failure();
@@ -299,23 +302,25 @@ Door_t unlockDoor (Door_t *door){
 
 // Get the current status of the door
 Door_t get_door_status (Door_t *door){
-    long long distance = get_distance();
-    if (StepperMotor_GetPosition() == STEPPER_LOCKED_POSITION){
+    DoorStateSnapshot s;
+    door_snapshot(&s, true);
+    DistanceClass sense = s.door;
+    if (s.locked){
         door->state = LOCKED;
         printf("Door is LOCKED.\n");
     } 
-    else if (distance < DOOR_CLOSED_THRESHOLD_CM && distance != -1) {
+    else if (sense == DISTANCE_NEAR) {
         door->state = UNLOCKED;
         printf("Door is CLOSED and UNLOCKED.\n");
     }
-    else if (distance == -1) {
+    else if (sense == DISTANCE_UNKNOWN) {
         printf("Error reading distance from ultrasonic sensor.\n");
         LED_enqueue_status_door_error();
         // Report UNKNOWN (helper will skip sending) and return
         report_door_state_udp(door);
         return *door;
     }
-    else if (distance >= DOOR_CLOSED_THRESHOLD_CM) {
+    else if (sense == DISTANCE_FAR) {
         door->state = OPEN;
         printf("Door is OPEN.\n");
     } 
@@ -330,12 +335,17 @@ Door_t get_door_status (Door_t *door){
 
 }
 void doorMod_cleanup(void){
-    if (StepperMotor_GetPosition()!= 0){
+    // Stop reporting and command intake first, so nothing reaches the
+    // motor once it is shut down
+    door_reporting_stop();
+
+    if (StepperMotor_GetPosition() != STEPPER_UNLOCKED_POSITION){
         // Unlock door on cleanup
-        StepperMotor_Rotate(180);
+        StepperMotor_Rotate(STEPPER_UNLOCKED_POSITION);
     }
-    // Stop reporting
-    door_reporting_stop();
+    StepperMotor_Shutdown();
+
+    hc_sr04_sampler_stop();
 
     // Shutdown LED worker
     LED_worker_shutdown();
@@ -2,6 +2,11 @@
  * doorMod_cli.c
  * Small CLI wrapper to run door module logic as a standalone executable.
  * Usage: ./doorMod_cli [MODULE_ID]
+ * DOOR_HB_IDLE_MS sets the idle heartbeat ceiling (default 16000; 1000
+ * keeps the fixed 1 s heartbeat). DOOR_EVENT_SPOOL is where EVENTs the
+ * hub hasn't acknowledged wait beyond the in-memory window (default
+ * door_event_spool.log, empty for memory only). DOOR_UDP_BATCH_MS is how
+ * long outgoing lines wait to share a datagram (default 5, 0 disables).
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -58,6 +63,16 @@ int main(int argc, char *argv[])
     }
 
     // ---- Start UDP reporting (notifications + heartbeat) ----
+    const char *hb_idle_ms = getenv("DOOR_HB_IDLE_MS");
+    if (hb_idle_ms) {
+        door_udp_set_heartbeat_idle(atoi(hb_idle_ms));
+    }
+    const char *event_spool = getenv("DOOR_EVENT_SPOOL");
+    door_udp_set_event_spool(event_spool ? event_spool : "door_event_spool.log");
+    const char *batch_ms = getenv("DOOR_UDP_BATCH_MS");
+    if (batch_ms) {
+        door_udp_set_batch_window(atoi(batch_ms));
+    }
     if (!door_reporting_start(hub_ip, 12345, 12346, module_id, 1000)) {
         fprintf(stderr, "\n");
         fprintf(stderr, "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
@@ -4,6 +4,8 @@
 #include <time.h>
 #include <string.h>
 #include "hal/hub_udp.h"
+#include "hal/hub_local.h"
+#include "hal/hub_shm.h"
 #include "hal/led.h"
 #include "hal/led_worker.h"
 #include "hal/door_udp.h"
@@ -73,27 +75,46 @@ int main(int argc, char *argv[]){
     }
 #endif
 
+    // Undelivered alerts survive restarts in the outbox ("" disables it)
+    const char *outbox = getenv("HUB_ALERT_OUTBOX");
+    discord_set_outbox(outbox ? outbox : "alert_outbox.log");
+
     // Initialize Discord
     if (!discordStart()) {
         fprintf(stderr, "Failed to initialize Discord\n");
         return 1;
     }
     
+    // Optional alert coalescing window override (ms)
+    const char *coalesce_ms = getenv("HUB_ALERT_COALESCE_MS");
+    if (coalesce_ms) {
+        discord_set_coalesce_window(atoi(coalesce_ms));
+    }
+
+    // Share of the UDP listener heartbeats may use before modules are slowed
+    const char *hb_budget = getenv("HUB_HB_BUDGET_PCT");
+    if (hb_budget) {
+        hub_udp_set_heartbeat_budget(atoi(hb_budget));
+    }
+
     /* Bind Discord webhook traffic to wlan0 interface */
     discord_set_device("wlan0");
     
-    hub_udp_set_webhook_url("https://discord.com/api/webhooks/1445277245743697940/-DWPsZbIoDTyo1iaXRW3Vo4URqJ1RpkjGQ4ijXENNeYcM9bNHUj90aunxeSU5GsnoZ_M");
+    // Door event alerts; HUB_ALERT_URL points them elsewhere (e.g. alert_bench's mock)
+    const char *alert_url = getenv("HUB_ALERT_URL");
+    hub_udp_set_webhook_url(alert_url ? alert_url : "https://discord.com/api/webhooks/1445277245743697940/-DWPsZbIoDTyo1iaXRW3Vo4URqJ1RpkjGQ4ijXENNeYcM9bNHUj90aunxeSU5GsnoZ_M");
 
         // Start webhook reporter if provided via argv[3] or environment
         const char *webhook_url = (argc > 3) ? argv[3] : getenv("HUB_WEBHOOK_URL");
         bool webhook_running = false;
         char *discord_provider_ctx = NULL;
-        if (webhook_url) {
-            if (!hub_webhook_init(webhook_url)) {
-                fprintf(stderr, "WARNING: webhook init failed, continuing without webhook.\n");
-            } else {
-                webhook_running = true;
-            }
+        bool discord_monitor_ref = false;
+        // The webhook queue also carries the hub's door and online/offline
+        // alerts (ahead of operator messages), so it runs even without a URL
+        if (!hub_webhook_init(webhook_url)) {
+            fprintf(stderr, "WARNING: webhook init failed, continuing without webhook.\n");
+        } else {
+            webhook_running = true;
         }
 
         // Start Discord alert monitor (application-owned provider).
@@ -102,6 +123,7 @@ int main(int argc, char *argv[]){
 
         if (webhook_url) {
             if (discordStart()) {
+                discord_monitor_ref = true;
                 discord_provider_ctx = strdup(module_id);
                 if (discord_provider_ctx) {
                     if (!startDoorAlertMonitor(door_alert_provider, discord_provider_ctx, webhook_url)) {
@@ -112,11 +134,20 @@ int main(int argc, char *argv[]){
             }
         }
 
-        // Start local HTTP API for web UI commands (bind to localhost only)
-        if (!http_api_start("127.0.0.1", 8080, module_id)) {
-            fprintf(stderr, "Warning: http_api_start failed (web UI disabled)\n");
+        // Serve the web UI from the hub itself (the Node server is optional).
+        // The service runs from the repo root, so "gui" is the default.
+        const char *web_root = getenv("HUB_WEB_ROOT");
+        http_api_set_web_root(web_root ? web_root : "gui");
+
+        // HTTP API and web UI, local only by default. HUB_HTTP_BIND=0.0.0.0
+        // opens it to the LAN, which http_api_start() refuses unless
+        // HTTP_API_TOKEN is set.
+        const char *http_bind = getenv("HUB_HTTP_BIND");
+        if (!http_bind || !http_bind[0]) http_bind = "127.0.0.1";
+        if (!http_api_start(http_bind, 8080, module_id)) {
+            fprintf(stderr, "Warning: http_api_start failed on %s (web UI disabled)\n", http_bind);
         } else {
-            printf("HTTP API listening on 127.0.0.1:8080\n");
+            printf("HTTP API listening on %s:8080\n", http_bind);
         }
 
     // ----------------------- UDP Communication Setup -----------------------
@@ -125,6 +156,18 @@ int main(int argc, char *argv[]){
         return 1;
     }
 
+    // Local clients on this host talk to the hub over a Unix socket instead
+    // of UDP (reliable, ordered, flow-controlled)
+    bool local_running = hub_local_init(getenv("HUB_LOCAL_SOCKET"));
+    if (!local_running) {
+        fprintf(stderr, "Warning: hub_local_init failed (local socket disabled)\n");
+    }
+
+    // The CLI reads module state from the shared status table like any
+    // other local reader; fall back to the locked copy if it's unavailable.
+    HubShmReader shm_reader;
+    bool shm_open = hub_shm_open(&shm_reader);
+
     fprintf(stderr, "========== Hub startup ==========\n");
     fprintf(stderr, "UDP listener initialized successfully\n");
     fprintf(stderr, "Listening on port 12345 (HELLO/notifications/FEEDBACKs)\n");
@@ -147,7 +190,9 @@ int main(int argc, char *argv[]){
             char id[16];
             if (sscanf(cmd, "s %15s", id) == 1) {
                 HubDoorStatus st;
-                if (hub_udp_get_status(id, &st)) {
+                bool have = shm_open ? hub_shm_read(&shm_reader, id, &st)
+                                     : hub_udp_get_status(id, &st);
+                if (have) {
                     printf("Status %s: D0=%s,%s D1=%s,%s lastHB=%lldms\n",
                            st.module_id,
                            st.d0_open   ? "OPEN" : "CLOSED",
@@ -193,6 +238,12 @@ int main(int argc, char *argv[]){
         }
     }
 
+    if (shm_open) {
+        hub_shm_close(&shm_reader);
+    }
+    if (local_running) {
+        hub_local_shutdown();
+    }
     hub_udp_shutdown();
 
     if (door_udp_running) {
@@ -201,6 +252,14 @@ int main(int argc, char *argv[]){
         if (webhook_running) {
             hub_webhook_shutdown();
         }
+    // Stop the alert monitor and release our Discord client references;
+    // the last release flushes any queued alerts.
+    stopDoorAlertMonitor();
+    free(discord_provider_ctx);
+    if (discord_monitor_ref) {
+        discordCleanup();
+    }
+    discordCleanup();
     // Stop HTTP API
     http_api_stop();
 
@@ -1,51 +1,161 @@
 // app/src/door_udp_handler.c
+// Commands arrive on door_udp's reactor thread, which must not block, so
+// they all run on a worker. LOCK/UNLOCK move the motor for a couple of
+// seconds: they are acked with ACCEPTED from the reactor thread, and the
+// worker then sends COMPLETED/FAILED with the final door state and how
+// long the command took. STATUS (which may wait on the distance sensor)
+// skips the ACCEPTED and gets its COMPLETED from the worker.
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include "hal/door_udp.h"
+#include "hal/timing.h"
 #include "doorMod.h"
 
+#define CMD_QUEUE_LEN 8
+
+typedef struct {
+    char module[16];
+    char target[32];
+    char action[16];
+    int  cmdid;
+    DoorCmdRef ref;
+} QueuedCmd;
+
+static pthread_mutex_t q_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  q_cond = PTHREAD_COND_INITIALIZER;
+static QueuedCmd q_cmds[CMD_QUEUE_LEN];
+static int       q_head = 0, q_len = 0;
+static bool      q_worker_running = false;
+static pthread_t q_worker;
+
+static const char *state_name(DoorState_t s)
+{
+    switch (s) {
+        case LOCKED:   return "LOCKED";
+        case UNLOCKED: return "UNLOCKED";
+        case OPEN:     return "OPEN";
+        case UNKNOWN:
+        default:       return "UNKNOWN";
+    }
+}
+
+static void *cmd_worker(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&q_lock);
+    for (;;) {
+        while (q_worker_running && q_len == 0)
+            pthread_cond_wait(&q_cond, &q_lock);
+        if (!q_worker_running) break;
+
+        QueuedCmd c = q_cmds[q_head];
+        q_head = (q_head + 1) % CMD_QUEUE_LEN;
+        q_len--;
+        pthread_mutex_unlock(&q_lock);
+
+        long long t0 = getTimeInMs();
+        Door_t d = { .state = UNKNOWN };
+        DoorState_t want;
+        if (strcmp(c.action, "STATUS") == 0) {
+            d = get_door_status(&d);
+            door_udp_send_result(c.module, c.cmdid, c.target, c.action, true,
+                                 state_name(d.state), 0, c.ref);
+            pthread_mutex_lock(&q_lock);
+            continue;
+        } else if (strcmp(c.action, "LOCK") == 0) {
+            d = lockDoor(&d);
+            want = LOCKED;
+        } else {
+            d = unlockDoor(&d);
+            want = UNLOCKED;
+        }
+        door_udp_send_result(c.module, c.cmdid, c.target, c.action,
+                             d.state == want, state_name(d.state), getTimeInMs() - t0, c.ref);
+
+        pthread_mutex_lock(&q_lock);
+    }
+    pthread_mutex_unlock(&q_lock);
+    return NULL;
+}
+
+// Queue a LOCK/UNLOCK/STATUS. Retransmits never get here: door_udp answers them
+// from its per-source command cache, and two clients may well pick the same
+// cmdid. Returns false if the queue is full.
+static bool enqueue_cmd(const char *module, int cmdid, const char *target, const char *action,
+                        DoorCmdRef ref)
+{
+    bool ok = true;
+    pthread_mutex_lock(&q_lock);
+    if (q_len == CMD_QUEUE_LEN || !q_worker_running) {
+        ok = false;
+    } else {
+        QueuedCmd *c = &q_cmds[(q_head + q_len) % CMD_QUEUE_LEN];
+        snprintf(c->module, sizeof(c->module), "%s", module);
+        snprintf(c->target, sizeof(c->target), "%s", target);
+        snprintf(c->action, sizeof(c->action), "%s", action);
+        c->cmdid = cmdid;
+        c->ref   = ref;
+        q_len++;
+        pthread_cond_signal(&q_cond);
+    }
+    pthread_mutex_unlock(&q_lock);
+    return ok;
+}
+
 static void app_command_handler(const char *module, int cmdid,
                                 const char *target, const char *action,
-                                void *ctx)
+                                DoorCmdRef ref, void *ctx)
 {
     (void)ctx;
-    Door_t d = { .state = UNKNOWN };
-
-    const char *out_action = action;
-    char action_buf[32];
-
-    if (action && strcmp(action, "LOCK") == 0) {
-        d = lockDoor(&d);
-        // leave out_action = "LOCK" (means "lock command completed")
-    } else if (action && strcmp(action, "UNLOCK") == 0) {
-        d = unlockDoor(&d);
-        // leave out_action = "UNLOCK"
-    } else if (action && strcmp(action, "STATUS") == 0) {
-        d = get_door_status(&d);
-
-        // Map our Door_t.state to text
-        const char *state_str = "UNKNOWN";
-        switch (d.state) {
-            case LOCKED:   state_str = "LOCKED";   break;
-            case UNLOCKED: state_str = "UNLOCKED"; break;
-            case OPEN:     state_str = "OPEN";     break;
-            case UNKNOWN:
-            default:       state_str = "UNKNOWN";  break;
-        }
+    if (!target) target = "";
+    if (!action) action = "";
 
-        // Encode as STATUS_<STATE> so the Node side can parse it
-        snprintf(action_buf, sizeof(action_buf), "STATUS_%s", state_str);
-        out_action = action_buf;
+    if (strcmp(action, "LOCK") == 0 || strcmp(action, "UNLOCK") == 0) {
+        if (enqueue_cmd(module, cmdid, target, action, ref)) {
+            door_udp_send_accepted(module, cmdid, target, action, ref);
+        } else {
+            fprintf(stderr, "[door_udp_handler] command %d dropped: queue full\n", cmdid);
+            door_udp_send_result(module, cmdid, target, action, false, "BUSY", 0, ref);
+        }
+    } else if (strcmp(action, "STATUS") == 0) {
+        if (!enqueue_cmd(module, cmdid, target, action, ref)) {
+            fprintf(stderr, "[door_udp_handler] command %d dropped: queue full\n", cmdid);
+            door_udp_send_result(module, cmdid, target, action, false, "BUSY", 0, ref);
+        }
+    } else {
+        door_udp_send_result(module, cmdid, target, action, false, "INVALID", 0, ref);
     }
-
-    // Send FEEDBACK via HAL transport
-    door_udp_send_feedback(module,
-                           cmdid,
-                           target ? target : "",
-                           out_action ? out_action : "");
 }
 
 bool app_udp_handler_init(void)
 {
+    pthread_mutex_lock(&q_lock);
+    if (!q_worker_running) {
+        q_worker_running = true;
+        if (pthread_create(&q_worker, NULL, cmd_worker, NULL) != 0) {
+            q_worker_running = false;
+            pthread_mutex_unlock(&q_lock);
+            fprintf(stderr, "[door_udp_handler] failed to start command worker\n");
+            return false;
+        }
+    }
+    pthread_mutex_unlock(&q_lock);
     return door_udp_register_command_handler(app_command_handler, NULL);
-}
\ No newline at end of file
+}
+
+// Finish the running command (its result still goes out) and drop the rest.
+void app_udp_handler_stop(void)
+{
+    pthread_mutex_lock(&q_lock);
+    if (!q_worker_running) {
+        pthread_mutex_unlock(&q_lock);
+        return;
+    }
+    q_worker_running = false;
+    q_len = 0;
+    pthread_cond_signal(&q_cond);
+    pthread_mutex_unlock(&q_lock);
+    pthread_join(q_worker, NULL);
+}
@@ -0,0 +1,200 @@
+/*
+ * hal_bench.c
+ * Benchmark the HAL drivers against the simulated GPIO/PWM backend
+ * (cmake -DHAL_BACKEND=sim): stepper step timing from the recorded coil
+ * edges, HC-SR04 read latency and accuracy against a scripted echo, and
+ * the duration and PWM traffic of the LED sequences. No board needed.
+ *
+ * Usage: ./hal_bench [options]
+ *   -m N      stepper moves, alternating 180 and 0 degrees (default 2)
+ *   -n N      distance reads (default 50)
+ *   -d CM     simulated distance (default 30)
+ *   -x        skip the LED sequences
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal/HC-SR04.h"
+#include "hal/PWM.h"
+#include "hal/StepperMotor.h"
+#include "hal/led.h"
+#include "hal/sim.h"
+#include "hal/timing.h"
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts v in place
+static long long pct(long long *v, int n, int p)
+{
+    if (n <= 0) return 0;
+    qsort(v, (size_t)n, sizeof(*v), cmp_ll);
+    int i = (n * p) / 100;
+    return v[i < n ? i : n - 1];
+}
+
+static bool is_coil(const SimGpioEdge *e)
+{
+    return (e->chip == IN1_GPIOCHIP && (e->line == IN1_GPIO_LINE || e->line == IN2_GPIO_LINE)) ||
+           (e->chip == IN3_GPIOCHIP && (e->line == IN3_GPIO_LINE || e->line == IN4_GPIO_LINE));
+}
+
+// ---------- stepper ----------
+
+static SimGpioEdge g_edges[SIM_GPIO_EDGE_LOG];
+static long long   g_gaps[SIM_GPIO_EDGE_LOG];
+
+static bool bench_stepper(int moves)
+{
+    printf("stepper: %d moves, profile %d -> %d half-steps/s, accel %d/s^2\n", moves,
+           STEPPER_DEFAULT_START_RATE, STEPPER_DEFAULT_MAX_RATE, STEPPER_DEFAULT_ACCEL);
+    if (!StepperMotor_Init()) return false;
+
+    const long long cruise_ns = 1000000000LL / STEPPER_DEFAULT_MAX_RATE;
+    bool ok = true;
+    for (int m = 0; m < moves; m++) {
+        int target = (m % 2 == 0) ? 180 : 0;
+        sim_gpio_take_edges(g_edges, SIM_GPIO_EDGE_LOG, NULL);  // discard earlier edges
+
+        long long t0 = getTimeInUs();
+        if (!StepperMotor_Rotate(target)) {
+            ok = false;
+            break;
+        }
+        long long t1 = getTimeInUs();
+
+        long long dropped = 0;
+        int n = sim_gpio_take_edges(g_edges, SIM_GPIO_EDGE_LOG, &dropped);
+
+        // One step changes one coil; edges sharing a timestamp are one write
+        int steps = 0, gaps = 0, late = 0;
+        long long prev = -1;
+        for (int i = 0; i < n; i++) {
+            if (!is_coil(&g_edges[i]) || g_edges[i].timestamp_ns == prev) continue;
+            if (prev >= 0) {
+                long long gap = g_edges[i].timestamp_ns - prev;
+                if (gap > 2 * 1000000000LL / STEPPER_DEFAULT_START_RATE) late++;
+                g_gaps[gaps++] = gap;
+            }
+            prev = g_edges[i].timestamp_ns;
+            steps++;
+        }
+
+        long long min_gap = gaps ? pct(g_gaps, gaps, 0) : 0;
+        printf("  -> %3d deg: %d steps in %.3fs, interval min %.3fms p50 %.3fms p99 %.3fms max %.3fms"
+               " (cruise target %.3fms), stalls %d%s\n",
+               target, steps, (double)(t1 - t0) / 1e6, min_gap / 1e6,
+               pct(g_gaps, gaps, 50) / 1e6, pct(g_gaps, gaps, 99) / 1e6,
+               pct(g_gaps, gaps, 100) / 1e6, cruise_ns / 1e6, late,
+               dropped ? " (edge log overflowed)" : "");
+    }
+    StepperMotor_Shutdown();
+    return ok;
+}
+
+// ---------- HC-SR04 ----------
+
+static bool bench_sensor(int reads, double distance_cm)
+{
+    printf("hc-sr04: %d reads at %.1fcm\n", reads, distance_cm);
+    if (!init_hc_sr04()) return false;
+    sim_hc_sr04_set_distance(distance_cm);
+
+    long long *lat = calloc((size_t)reads, sizeof(*lat));
+    if (!lat) return false;
+    int failed = 0;
+    double err_sum = 0, err_max = 0;
+    for (int i = 0; i < reads; i++) {
+        long long t0 = getTimeInUs();
+        long long d = get_distance();
+        lat[i] = getTimeInUs() - t0;
+        if (d < 0) {
+            failed++;
+            continue;
+        }
+        double err = d > distance_cm ? d - distance_cm : distance_cm - d;
+        err_sum += err;
+        if (err > err_max) err_max = err;
+        sleepForMs(1);
+    }
+    int good = reads - failed;
+    printf("  latency p50 %.3fms p99 %.3fms max %.3fms; error mean %.2fcm max %.2fcm; failed %d\n",
+           pct(lat, reads, 50) / 1e3, pct(lat, reads, 99) / 1e3, pct(lat, reads, 100) / 1e3,
+           good ? err_sum / good : 0.0, err_max, failed);
+    free(lat);
+
+    // No echo: how long a read takes to give up
+    sim_hc_sr04_set_distance(-1);
+    long long t0 = getTimeInUs();
+    long long d = get_distance();
+    printf("  no echo: %lld after %.3fms\n", d, (getTimeInUs() - t0) / 1e3);
+    sim_hc_sr04_set_distance(distance_cm);
+    return d < 0;
+}
+
+// ---------- LEDs ----------
+
+static void run_led(const char *name, void (*seq)(void))
+{
+    static SimPwmWrite writes[SIM_PWM_WRITE_LOG];
+    sim_pwm_take_writes(writes, SIM_PWM_WRITE_LOG, NULL);
+
+    long long t0 = getTimeInUs();
+    seq();
+    long long t1 = getTimeInUs();
+    int n = sim_pwm_take_writes(writes, SIM_PWM_WRITE_LOG, NULL);
+
+    long long rp = 0, rd = 0, gp = 0, gd = 0;
+    bool ron = false, gon = false;
+    sim_pwm_state(RED_LED, &rp, &rd, &ron);
+    sim_pwm_state(GREEN_LED, &gp, &gd, &gon);
+    printf("  %-16s %.3fs, %2d PWM writes; ends red %s", name, (t1 - t0) / 1e6, n,
+           ron ? "on" : "off");
+    if (ron && rp > 0) printf(" (%.0fHz %lld%%)", 1e9 / rp, rd * 100 / rp);
+    printf(", green %s", gon ? "on" : "off");
+    if (gon && gp > 0) printf(" (%.0fHz %lld%%)", 1e9 / gp, gd * 100 / gp);
+    printf("\n");
+}
+
+static void bench_leds(void)
+{
+    printf("leds:\n");
+    run_led("lock ok", LED_lock_success_sequence);
+    run_led("lock failed", LED_lock_failure_sequence);
+    run_led("unlock ok", LED_unlock_success_sequence);
+    run_led("hub cmd failed", LED_hub_command_failure);
+}
+
+int main(int argc, char *argv[])
+{
+    int moves = 2, reads = 50;
+    double distance_cm = 30;
+    bool leds = true;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:d:xh")) != -1) {
+        switch (opt) {
+        case 'm': moves = atoi(optarg); break;
+        case 'n': reads = atoi(optarg); break;
+        case 'd': distance_cm = atof(optarg); break;
+        case 'x': leds = false; break;
+        default:
+            fprintf(stderr, "Usage: %s [-m moves] [-n reads] [-d distance_cm] [-x]\n", argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (reads <= 0) reads = 1;
+
+    sim_hal_reset();
+    bool ok = true;
+    if (moves > 0) ok = bench_stepper(moves) && ok;
+    ok = bench_sensor(reads, distance_cm) && ok;
+    if (leds) bench_leds();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
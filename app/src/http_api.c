@@ -2,6 +2,9 @@
 #include "http_api.h"
 #include "doorMod.h"
 #include "hal/hub_udp.h"
+#include "hal/hub_metrics.h"
+#include "hal/system_webhook.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,257 +13,814 @@
 #include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <strings.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#ifdef HTTP_API_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define HTTP_RECV_BUF    8192
+#define HTTP_ARENA_SIZE  4096
+#define HTTP_RESP_BUF    32768
+#define HTTP_MAX_HEADERS 32
+#define HTTP_MAX_ASSETS  8
+#define HTTP_ASSET_MAX   (1024 * 1024)
+#define HTTP_IO_TIMEOUT_MS 2000   // one client at a time: don't wait on an idle one
 
 static int server_sock = -1;
 static volatile int server_running = 0;
 static pthread_t server_thread;
 static char g_module_id[32] = {0};
 
-// very small helper to send an HTTP response
-static void send_response_status(int client, int status_code, const char *body)
+// ---------- string views into the receive buffer ----------
+
+typedef struct {
+    const char *ptr;
+    size_t len;
+} StrView;
+
+static bool sv_eq(StrView v, const char *s)
+{
+    size_t n = strlen(s);
+    return v.ptr && v.len == n && memcmp(v.ptr, s, n) == 0;
+}
+
+static bool sv_ieq(StrView v, const char *s)
+{
+    size_t n = strlen(s);
+    return v.ptr && v.len == n && strncasecmp(v.ptr, s, n) == 0;
+}
+
+// Find `needle` in the first `len` bytes of `hay`.
+static const char *find_bytes(const char *hay, size_t len, const char *needle)
+{
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (memcmp(hay + i, needle, n) == 0) return hay + i;
+    }
+    return NULL;
+}
+
+// ---------- per-connection bump arena ----------
+
+typedef struct {
+    char buf[HTTP_ARENA_SIZE];
+    size_t used;
+} Arena;
+
+static void arena_reset(Arena *a) { a->used = 0; }
+
+// Copy a view into the arena as a NUL-terminated string, decoding %XX and
+// '+' (form/query encoding). Returns NULL if the view is empty/absent or
+// the arena is exhausted.
+static char *arena_decode(Arena *a, StrView v)
+{
+    if (!v.ptr) return NULL;
+    if (a->used + v.len + 1 > sizeof(a->buf)) return NULL;
+    char *out = a->buf + a->used;
+    size_t o = 0;
+    for (size_t i = 0; i < v.len; i++) {
+        char c = v.ptr[i];
+        if (c == '+') {
+            c = ' ';
+        } else if (c == '%' && i + 2 < v.len) {
+            char hex[3] = { v.ptr[i + 1], v.ptr[i + 2], '\0' };
+            char *end = NULL;
+            long x = strtol(hex, &end, 16);
+            if (end == hex + 2) { c = (char)x; i += 2; }
+        }
+        out[o++] = c;
+    }
+    out[o] = '\0';
+    a->used += o + 1;
+    return out;
+}
+
+// ---------- request parser ----------
+
+typedef struct {
+    StrView method;
+    StrView path;     // without query string
+    StrView query;    // after '?', may be empty
+    StrView body;
+    StrView hdr_name[HTTP_MAX_HEADERS];
+    StrView hdr_value[HTTP_MAX_HEADERS];
+    int     num_headers;
+} HttpRequest;
+
+// Parse the request head in place. All fields are views into `buf`.
+static bool parse_request(const char *buf, size_t len, HttpRequest *req)
+{
+    memset(req, 0, sizeof(*req));
+    const char *end = buf + len;
+
+    const char *line_end = find_bytes(buf, len, "\r\n");
+    if (!line_end) return false;
+
+    // request line: METHOD SP TARGET SP VERSION
+    const char *sp1 = memchr(buf, ' ', (size_t)(line_end - buf));
+    if (!sp1) return false;
+    const char *target = sp1 + 1;
+    const char *sp2 = memchr(target, ' ', (size_t)(line_end - target));
+    if (!sp2) sp2 = line_end;
+    req->method = (StrView){ buf, (size_t)(sp1 - buf) };
+
+    const char *q = memchr(target, '?', (size_t)(sp2 - target));
+    if (q) {
+        req->path  = (StrView){ target, (size_t)(q - target) };
+        req->query = (StrView){ q + 1, (size_t)(sp2 - q - 1) };
+    } else {
+        req->path  = (StrView){ target, (size_t)(sp2 - target) };
+    }
+
+    // headers
+    const char *p = line_end + 2;
+    while (p < end) {
+        const char *le = find_bytes(p, (size_t)(end - p), "\r\n");
+        if (!le) return false;
+        if (le == p) {                  // blank line: end of head
+            p += 2;
+            req->body = (StrView){ p, (size_t)(end - p) };
+            return true;
+        }
+        const char *col = memchr(p, ':', (size_t)(le - p));
+        if (col && req->num_headers < HTTP_MAX_HEADERS) {
+            size_t klen = (size_t)(col - p);
+            while (klen > 0 && p[klen - 1] == ' ') klen--;
+            const char *val = col + 1;
+            while (val < le && *val == ' ') val++;
+            req->hdr_name[req->num_headers]  = (StrView){ p, klen };
+            req->hdr_value[req->num_headers] = (StrView){ val, (size_t)(le - val) };
+            req->num_headers++;
+        }
+        p = le + 2;
+    }
+    return false;
+}
+
+static StrView get_header(const HttpRequest *req, const char *key)
+{
+    for (int i = 0; i < req->num_headers; i++) {
+        if (sv_ieq(req->hdr_name[i], key)) return req->hdr_value[i];
+    }
+    return (StrView){ NULL, 0 };
+}
+
+// Look up `key` in a form/query encoded string ("a=1&b=2").
+static StrView get_form_value(StrView form, const char *key)
+{
+    const char *p = form.ptr;
+    const char *end = form.ptr ? form.ptr + form.len : NULL;
+    while (p && p < end) {
+        const char *amp = memchr(p, '&', (size_t)(end - p));
+        const char *pair_end = amp ? amp : end;
+        const char *eq = memchr(p, '=', (size_t)(pair_end - p));
+        if (eq && sv_eq((StrView){ p, (size_t)(eq - p) }, key)) {
+            return (StrView){ eq + 1, (size_t)(pair_end - eq - 1) };
+        }
+        p = amp ? amp + 1 : NULL;
+    }
+    return (StrView){ NULL, 0 };
+}
+
+// ---------- streaming JSON writer ----------
+
+typedef struct {
+    char  *buf;
+    size_t cap;
+    size_t len;
+    bool   overflow;    // output did not fit; caller must not send it
+    bool   need_comma;
+} JsonWriter;
+
+static void jw_raw(JsonWriter *w, const char *s, size_t n)
+{
+    if (w->overflow || w->len + n + 1 > w->cap) { w->overflow = true; return; }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+    w->buf[w->len] = '\0';
+}
+
+static void jw_init(JsonWriter *w, char *buf, size_t cap)
+{
+    w->buf = buf; w->cap = cap; w->len = 0;
+    w->overflow = false; w->need_comma = false;
+    jw_raw(w, "{", 1);
+}
+
+static void jw_end(JsonWriter *w) { jw_raw(w, "}", 1); }
+
+static void jw_escaped(JsonWriter *w, const char *s, size_t n)
+{
+    jw_raw(w, "\"", 1);
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            jw_raw(w, esc, 2);
+        } else if (c < 0x20) {
+            char esc[8];
+            int k = snprintf(esc, sizeof(esc), "\\u%04x", c);
+            jw_raw(w, esc, (size_t)k);
+        } else {
+            jw_raw(w, (const char *)&s[i], 1);
+        }
+    }
+    jw_raw(w, "\"", 1);
+}
+
+static void jw_key(JsonWriter *w, const char *key)
+{
+    if (w->need_comma) jw_raw(w, ",", 1);
+    w->need_comma = true;
+    jw_escaped(w, key, strlen(key));
+    jw_raw(w, ":", 1);
+}
+
+static void jw_str(JsonWriter *w, const char *key, const char *val)
+{
+    jw_key(w, key);
+    jw_escaped(w, val, strlen(val));
+}
+
+static void jw_bool(JsonWriter *w, const char *key, bool val)
+{
+    jw_key(w, key);
+    if (val) jw_raw(w, "true", 4); else jw_raw(w, "false", 5);
+}
+
+static void jw_int(JsonWriter *w, const char *key, long long val)
+{
+    char num[24];
+    int k = snprintf(num, sizeof(num), "%lld", val);
+    jw_key(w, key);
+    jw_raw(w, num, (size_t)k);
+}
+
+// ---------- connection state ----------
+
+// The server loop handles one connection at a time, so a single connection
+// object is reused for every request: receive buffer, arena and response
+// buffer are allocated once and reset per request.
+typedef struct {
+    int     fd;
+    char    recv_buf[HTTP_RECV_BUF];
+    size_t  recv_len;
+    Arena   arena;
+    char    resp_buf[HTTP_RESP_BUF];
+} HttpConn;
+
+static HttpConn g_conn;
+
+static void send_response_typed(HttpConn *c, int status_code,
+                                const char *content_type,
+                                const char *body, size_t len)
 {
     char header[256];
-    int len = strlen(body);
     const char *status_text = "OK";
     if (status_code == 401) status_text = "Unauthorized";
     else if (status_code == 400) status_text = "Bad Request";
     else if (status_code == 404) status_text = "Not Found";
+    else if (status_code == 500) status_text = "Internal Server Error";
     int hlen = snprintf(header, sizeof(header),
-                        "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n",
-                        status_code, status_text, len);
-    send(client, header, hlen, 0);
-    send(client, body, len, 0);
+                        "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                        status_code, status_text, content_type, len);
+    struct iovec iov[2] = {
+        { .iov_base = header,       .iov_len = (size_t)hlen },
+        { .iov_base = (void *)body, .iov_len = len }
+    };
+    if (writev(c->fd, iov, 2) < 0) {
+        perror("http_api: writev");
+    }
 }
 
-static void send_response(int client, const char *body)
+static void send_response_status(HttpConn *c, int status_code, const char *body)
 {
-    send_response_status(client, 200, body);
+    send_response_typed(c, status_code, "application/json", body, strlen(body));
 }
 
-// Find a header value (case-insensitive) in the raw request buffer.
-static char *get_header_value_from_request(const char *req, const char *key)
+static void send_response(HttpConn *c, const char *body)
 {
-    const char *p = strstr(req, "\r\n");
-    if (!p) return NULL;
-    p += 2; // skip request-line CRLF
-    while (p && *p && !(p[0] == '\r' && p[1] == '\n')) {
-        const char *line_end = strstr(p, "\r\n");
-        if (!line_end) break;
-        // find ':'
-        const char *col = memchr(p, ':', (size_t)(line_end - p));
-        if (col) {
-            size_t klen = (size_t)(col - p);
-            // trim spaces
-            while (klen > 0 && p[klen-1] == ' ') klen--;
-            if (klen == strlen(key) && strncasecmp(p, key, klen) == 0) {
-                // value starts after ':' possibly space
-                const char *val = col + 1;
-                while (*val == ' ') val++;
-                size_t vlen = (size_t)(line_end - val);
-                char *res = malloc(vlen + 1);
-                if (!res) return NULL;
-                memcpy(res, val, vlen);
-                res[vlen] = '\0';
-                return res;
-            }
-        }
-        p = line_end + 2;
+    send_response_status(c, 200, body);
+}
+
+// Send a JSON object built in the connection's response buffer. A writer
+// that overflowed is reported as a 500 instead of being truncated.
+static void send_json(HttpConn *c, JsonWriter *w)
+{
+    if (w->overflow) {
+        send_response_status(c, 500, "{\"error\":\"response too large\"}");
+        return;
+    }
+    send_response_typed(c, 200, "application/json", w->buf, w->len);
+}
+
+// ---------- static web UI assets ----------
+
+// Files served from the web root. Everything is read (and gzipped) once in
+// http_api_start() and served from memory, so a request never touches the
+// filesystem and an edit on disk can't disagree with the cached
+// Content-Length and ETag.
+static const struct {
+    const char *file;
+    const char *content_type;
+} k_asset_files[] = {
+    { "UI.html",        "text/html; charset=utf-8" },
+    { "web_control.js", "application/javascript; charset=utf-8" },
+    { "style.css",      "text/css; charset=utf-8" },
+};
+
+typedef struct {
+    char        path[64];        // URL path, e.g. "/style.css"
+    const char *content_type;
+    char       *data;            // identity body
+    size_t      len;
+    char       *gz;              // gzip body, NULL if it wouldn't be smaller
+    size_t      gz_len;
+    char        etag[24];        // quoted FNV-1a of the identity body
+    char        gz_etag[28];
+} StaticAsset;
+
+static StaticAsset g_assets[HTTP_MAX_ASSETS];
+static int         g_num_assets = 0;
+static char        g_web_root[256] = {0};
+
+static uint64_t fnv1a64(const char *data, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#ifdef HTTP_API_HAVE_ZLIB
+// gzip `data` into a new buffer. Returns NULL on failure or if the result
+// is not smaller than the input.
+static char *gzip_buffer(const char *data, size_t len, size_t *out_len)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // windowBits 15 + 16 selects the gzip wrapper
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+    uLong bound = deflateBound(&zs, (uLong)len);
+    char *out = malloc(bound);
+    if (!out) { deflateEnd(&zs); return NULL; }
+
+    zs.next_in   = (Bytef *)data;
+    zs.avail_in  = (uInt)len;
+    zs.next_out  = (Bytef *)out;
+    zs.avail_out = (uInt)bound;
+    int rc = deflate(&zs, Z_FINISH);
+    size_t n = zs.total_out;
+    deflateEnd(&zs);
+
+    if (rc != Z_STREAM_END || n >= len) {
+        free(out);
+        return NULL;
+    }
+    *out_len = n;
+    return out;
+}
+#endif
+
+static void free_assets(void)
+{
+    for (int i = 0; i < g_num_assets; i++) {
+        free(g_assets[i].data);
+        free(g_assets[i].gz);
+    }
+    memset(g_assets, 0, sizeof(g_assets));
+    g_num_assets = 0;
+}
+
+static bool load_asset(const char *dir, const char *file, const char *ctype)
+{
+    if (g_num_assets >= HTTP_MAX_ASSETS) return false;
+
+    char full[512];
+    snprintf(full, sizeof(full), "%s/%s", dir, file);
+    int fd = open(full, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "http_api: cannot open %s: %s\n", full, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size > HTTP_ASSET_MAX) {
+        fprintf(stderr, "http_api: skipping %s (not a regular file or too large)\n", full);
+        close(fd);
+        return false;
+    }
+
+    size_t len = (size_t)st.st_size;
+    char *data = malloc(len ? len : 1);
+    size_t got = 0;
+    while (data && got < len) {
+        ssize_t rc = pread(fd, data + got, len - got, (off_t)got);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) break;
+        got += (size_t)rc;
+    }
+    if (!data || got != len) {
+        fprintf(stderr, "http_api: failed to read %s\n", full);
+        free(data);
+        close(fd);
+        return false;
+    }
+
+    StaticAsset *a = &g_assets[g_num_assets++];
+    memset(a, 0, sizeof(*a));
+    snprintf(a->path, sizeof(a->path), "/%s", file);
+    a->content_type = ctype;
+    a->data = data;
+    a->len  = len;
+#ifdef HTTP_API_HAVE_ZLIB
+    a->gz = gzip_buffer(data, len, &a->gz_len);
+#endif
+    uint64_t h = fnv1a64(data, len);
+    snprintf(a->etag, sizeof(a->etag), "\"%016llx\"", (unsigned long long)h);
+    snprintf(a->gz_etag, sizeof(a->gz_etag), "\"%016llx-gz\"", (unsigned long long)h);
+
+    close(fd);
+    fprintf(stderr, "http_api: cached %s (%zu bytes, gzip %zu)\n",
+            a->path, a->len, a->gz ? a->gz_len : a->len);
+    return true;
+}
+
+static int load_assets(const char *dir)
+{
+    free_assets();
+    int n = 0;
+    for (size_t i = 0; i < sizeof(k_asset_files) / sizeof(k_asset_files[0]); i++) {
+        if (load_asset(dir, k_asset_files[i].file, k_asset_files[i].content_type)) n++;
+    }
+    return n;
+}
+
+static const StaticAsset *find_asset(StrView path)
+{
+    // "/" and "/index.html" are the control panel
+    if (sv_eq(path, "/") || sv_eq(path, "/index.html")) path = (StrView){ "/UI.html", 8 };
+    for (int i = 0; i < g_num_assets; i++) {
+        if (sv_eq(path, g_assets[i].path)) return &g_assets[i];
     }
     return NULL;
 }
 
-// parse query param value for key from path like /api/status?module=D1
-static char *get_query_value(const char *path, const char *key)
-{
-    const char *q = strchr(path, '?');
-    if (!q) return NULL;
-    q++; // skip ?
-    char *copy = strdup(q);
-    char *save = NULL;
-    char *tok = strtok_r(copy, "&", &save);
-    while (tok) {
-        char *eq = strchr(tok, '=');
-        if (eq) {
-            *eq = '\0';
-            char *k = tok; char *v = eq + 1;
-            if (strcmp(k, key) == 0) {
-                char *res = strdup(v);
-                free(copy);
-                return res;
-            }
+// True if an Accept-Encoding value allows gzip (present and not q=0).
+static bool accepts_gzip(StrView ae)
+{
+    const char *p = ae.ptr;
+    const char *end = ae.ptr ? ae.ptr + ae.len : NULL;
+    while (p && p < end) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        const char *item_end = comma ? comma : end;
+        while (p < item_end && *p == ' ') p++;
+        const char *semi = memchr(p, ';', (size_t)(item_end - p));
+        const char *tok_end = semi ? semi : item_end;
+        while (tok_end > p && tok_end[-1] == ' ') tok_end--;
+        StrView tok = { p, (size_t)(tok_end - p) };
+        if (sv_ieq(tok, "gzip") || sv_ieq(tok, "*")) {
+            if (!semi) return true;
+            const char *q = find_bytes(semi, (size_t)(item_end - semi), "q=");
+            return !q || strtod(q + 2, NULL) > 0.0;
         }
-        tok = strtok_r(NULL, "&", &save);
+        p = comma ? comma + 1 : NULL;
     }
-    free(copy);
-    return NULL;
+    return false;
 }
 
-static void handle_client(int client)
+// True if If-None-Match lists `etag` (or is "*").
+static bool etag_matches(StrView inm, const char *etag)
 {
-    char buf[8192];
-    ssize_t rc = recv(client, buf, sizeof(buf)-1, 0);
-    if (rc <= 0) { close(client); return; }
-    buf[rc] = '\0';
+    if (!inm.ptr) return false;
+    if (sv_eq(inm, "*")) return true;
+    return find_bytes(inm.ptr, inm.len, etag) != NULL;
+}
 
-    // parse request line
-    char method[8] = {0};
-    char path[1024] = {0};
-    if (sscanf(buf, "%7s %1023s", method, path) < 2) {
-        close(client); return;
+static void send_all(int fd, const char *buf, size_t len, int flags)
+{
+    while (len > 0) {
+        ssize_t rc = send(fd, buf, len, flags | MSG_NOSIGNAL);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) { perror("http_api: send"); return; }
+        buf += rc;
+        len -= (size_t)rc;
     }
+}
 
-    // Simple API token enforcement: if HTTP_API_TOKEN is set, require
-    // header `X-API-TOKEN: <token>` to match. If not set, allow access.
-    const char *expected_token = getenv("HTTP_API_TOKEN");
-    if (expected_token) {
-        char *got = get_header_value_from_request(buf, "X-API-TOKEN");
-        if (!got || strcmp(got, expected_token) != 0) {
-            send_response_status(client, 401, "{\"error\":\"unauthorized\"}");
-            free(got);
-            close(client);
-            return;
-        }
-        free(got);
+static void send_asset(HttpConn *c, const HttpRequest *req, const StaticAsset *a)
+{
+    bool gz = a->gz && accepts_gzip(get_header(req, "Accept-Encoding"));
+    const char *etag = gz ? a->gz_etag : a->etag;
+    const char *body = gz ? a->gz : a->data;
+    size_t len       = gz ? a->gz_len : a->len;
+    bool head_only   = sv_eq(req->method, "HEAD");
+
+    char header[512];
+    if (etag_matches(get_header(req, "If-None-Match"), etag)) {
+        int hlen = snprintf(header, sizeof(header),
+                            "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nVary: Accept-Encoding\r\n"
+                            "Cache-Control: no-cache\r\nConnection: close\r\n\r\n", etag);
+        send_all(c->fd, header, (size_t)hlen, 0);
+        return;
     }
 
-    if (strcmp(method, "GET") == 0 && strncmp(path, "/api/status", 11) == 0) {
-        char *mod = get_query_value(path, "module");
-        if (!mod) {
-            send_response(client, "{\"error\":\"missing module\"}");
-            free(mod);
-            close(client);
-            return;
-        }
-        // prefer hub status; fallback to local status if module == local
-        HubDoorStatus st;
-        if (hub_udp_get_status(mod, &st)) {
-            char out[512];
-            // Include friendly field names for UI: front_door_open and front_lock_locked
-            snprintf(out, sizeof(out), "{\"module\":\"%s\",\"d0_open\":%s,\"d0_locked\":%s,\"d1_open\":%s,\"d1_locked\":%s,\"front_door_open\":%s,\"front_lock_locked\":%s,\"lastHB\":%lld,\"lastHBLine\":\"%s\"}",
-                     st.module_id,
-                     st.d0_open ? "true" : "false",
-                     st.d0_locked ? "true" : "false",
-                     st.d1_open ? "true" : "false",
-                     st.d1_locked ? "true" : "false",
-                     st.d0_open ? "true" : "false",
-                     st.d1_locked ? "true" : "false",
-                     st.last_heartbeat_ms,
-                     st.last_heartbeat_line);
-            send_response(client, out);
-            free(mod);
-            close(client);
-            return;
+    int hlen = snprintf(header, sizeof(header),
+                        "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                        "%sETag: %s\r\nVary: Accept-Encoding\r\nCache-Control: no-cache\r\n"
+                        "Connection: close\r\n\r\n",
+                        a->content_type, len,
+                        gz ? "Content-Encoding: gzip\r\n" : "", etag);
+    if (head_only) {
+        send_all(c->fd, header, (size_t)hlen, 0);
+        return;
+    }
+
+    struct iovec iov[2] = {
+        { .iov_base = header,       .iov_len = (size_t)hlen },
+        { .iov_base = (void *)body, .iov_len = len }
+    };
+    if (writev(c->fd, iov, 2) < 0) {
+        perror("http_api: writev");
+    }
+}
+
+bool http_api_set_web_root(const char *dir)
+{
+    if (server_running) return false;
+    if (!dir) {
+        g_web_root[0] = '\0';
+        return true;
+    }
+    if (strlen(dir) >= sizeof(g_web_root)) return false;
+    snprintf(g_web_root, sizeof(g_web_root), "%s", dir);
+    return true;
+}
+
+// Read until the request head and any Content-Length body are complete.
+static bool recv_request(HttpConn *c)
+{
+    c->recv_len = 0;
+    size_t need = 0;   // total bytes once the head has been seen
+    while (c->recv_len < sizeof(c->recv_buf) - 1) {
+        ssize_t rc = recv(c->fd, c->recv_buf + c->recv_len,
+                          sizeof(c->recv_buf) - 1 - c->recv_len, 0);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) break;
+        c->recv_len += (size_t)rc;
+        c->recv_buf[c->recv_len] = '\0';
+
+        if (need == 0) {
+            HttpRequest head;
+            if (!parse_request(c->recv_buf, c->recv_len, &head)) continue;
+            size_t body_len = 0;
+            StrView cl = get_header(&head, "Content-Length");
+            if (cl.ptr) body_len = (size_t)strtoul(cl.ptr, NULL, 10);
+            need = (size_t)(head.body.ptr - c->recv_buf) + body_len;
         }
+        if (c->recv_len >= need) return true;
+    }
+    return need != 0;
+}
+
+// ---------- routes ----------
+
+// snprintf at *len; *len keeps counting past cap so overflow is detectable.
+static void buf_printf(char *buf, size_t cap, size_t *len, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    size_t room = (*len < cap) ? cap - *len : 0;
+    int n = vsnprintf(room ? buf + *len : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n > 0) *len += (size_t)n;
+}
+
+// Append the system_webhook queue gauges/counters after the hub metrics.
+static size_t render_webhook_metrics(char *buf, size_t cap)
+{
+    static const char *k_class[HUB_WEBHOOK_PRIO_COUNT] = { "security", "connectivity", "info" };
+    HubWebhookStats st;
+    hub_webhook_get_stats(&st);
 
-        // if module equals local, use direct get_door_status
-        if (strcmp(mod, g_module_id) == 0) {
-            Door_t d = { .state = UNKNOWN };
+    size_t len = 0;
+    buf_printf(buf, cap, &len, "# HELP hub_webhook_queue_depth Messages waiting in the system webhook queue\n"
+               "# TYPE hub_webhook_queue_depth gauge\n");
+    for (int c = 0; c < HUB_WEBHOOK_PRIO_COUNT; c++)
+        buf_printf(buf, cap, &len, "hub_webhook_queue_depth{class=\"%s\"} %u\n", k_class[c], (unsigned)st.depth[c]);
+    buf_printf(buf, cap, &len, "# HELP hub_webhook_queue_max_depth Highest system webhook queue depth seen\n"
+               "# TYPE hub_webhook_queue_max_depth gauge\nhub_webhook_queue_max_depth %u\n",
+               (unsigned)st.max_depth);
+    buf_printf(buf, cap, &len, "# HELP hub_webhook_dropped_total System webhook messages dropped, by class and reason\n"
+               "# TYPE hub_webhook_dropped_total counter\n");
+    for (int c = 0; c < HUB_WEBHOOK_PRIO_COUNT; c++) {
+        buf_printf(buf, cap, &len, "hub_webhook_dropped_total{class=\"%s\",reason=\"evicted\"} %llu\n",
+                   k_class[c], (unsigned long long)st.evicted[c]);
+        buf_printf(buf, cap, &len, "hub_webhook_dropped_total{class=\"%s\",reason=\"rejected\"} %llu\n",
+                   k_class[c], (unsigned long long)st.rejected[c]);
+    }
+    buf_printf(buf, cap, &len, "# HELP hub_webhook_collapsed_total Messages merged into a queued duplicate\n"
+               "# TYPE hub_webhook_collapsed_total counter\nhub_webhook_collapsed_total %llu\n",
+               (unsigned long long)st.collapsed);
+    return len;
+}
+
+static void handle_metrics(HttpConn *c)
+{
+    size_t n = hub_metrics_render(c->resp_buf, sizeof(c->resp_buf));
+    if (n < sizeof(c->resp_buf)) {
+        n += render_webhook_metrics(c->resp_buf + n, sizeof(c->resp_buf) - n);
+    }
+    if (n >= sizeof(c->resp_buf)) {
+        send_response_status(c, 500, "{\"error\":\"response too large\"}");
+        return;
+    }
+    send_response_typed(c, 200, "text/plain; version=0.0.4", c->resp_buf, n);
+}
+
+static void handle_status(HttpConn *c, const HttpRequest *req)
+{
+    char *mod = arena_decode(&c->arena, get_form_value(req->query, "module"));
+    if (!mod) {
+        send_response(c, "{\"error\":\"missing module\"}");
+        return;
+    }
+
+    JsonWriter w;
+    jw_init(&w, c->resp_buf, sizeof(c->resp_buf));
+
+    // prefer hub status; fallback to local status if module == local
+    HubDoorStatus st;
+    if (hub_udp_get_status(mod, &st)) {
+        // Include friendly field names for UI: front_door_open and front_lock_locked
+        jw_str(&w, "module", st.module_id);
+        jw_bool(&w, "d0_open", st.d0_open);
+        jw_bool(&w, "d0_locked", st.d0_locked);
+        jw_bool(&w, "d1_open", st.d1_open);
+        jw_bool(&w, "d1_locked", st.d1_locked);
+        jw_bool(&w, "front_door_open", st.d0_open);
+        jw_bool(&w, "front_lock_locked", st.d1_locked);
+        jw_int(&w, "lastHB", st.last_heartbeat_ms);
+        jw_int(&w, "hbIntervalMs", st.heartbeat_interval_ms);
+        jw_str(&w, "lastHBLine", st.last_heartbeat_line);
+        jw_end(&w);
+        send_json(c, &w);
+        return;
+    }
+
+    // if module equals local, use direct get_door_status
+    if (strcmp(mod, g_module_id) == 0) {
+        Door_t d = { .state = UNKNOWN };
+        d = get_door_status(&d);
+        // Map Door_t state to friendly booleans for front door and lock
+        jw_str(&w, "module", mod);
+        jw_int(&w, "state", d.state);
+        jw_bool(&w, "front_door_open", d.state == OPEN);
+        jw_bool(&w, "front_lock_locked", d.state == LOCKED);
+        jw_end(&w);
+        send_json(c, &w);
+        return;
+    }
+
+    send_response(c, "{\"error\":\"no status\"}");
+}
+
+static void handle_command(HttpConn *c, const HttpRequest *req)
+{
+    if (!req->body.ptr || req->body.len == 0) {
+        send_response(c, "{\"error\":\"no body\"}");
+        return;
+    }
+    // expect form-encoded: module=D1&target=D0&action=LOCK
+    char *mod    = arena_decode(&c->arena, get_form_value(req->body, "module"));
+    char *target = arena_decode(&c->arena, get_form_value(req->body, "target"));
+    char *action = arena_decode(&c->arena, get_form_value(req->body, "action"));
+
+    if (!mod || !action) {
+        send_response(c, "{\"error\":\"missing fields\"}");
+        return;
+    }
+
+    JsonWriter w;
+    jw_init(&w, c->resp_buf, sizeof(c->resp_buf));
+
+    // If target module is local, perform directly
+    if (strcmp(mod, g_module_id) == 0) {
+        Door_t d = { .state = UNKNOWN };
+        if (strcmp(action, "LOCK") == 0) {
+            d = lockDoor(&d);
+        } else if (strcmp(action, "UNLOCK") == 0) {
+            d = unlockDoor(&d);
+        } else if (strcmp(action, "STATUS") == 0) {
             d = get_door_status(&d);
-            // Map Door_t state to friendly booleans for front door and lock
-            const char *front_open = (d.state == OPEN) ? "true" : "false";
-            const char *front_locked = (d.state == LOCKED) ? "true" : "false";
-            char out[256];
-            snprintf(out, sizeof(out), "{\"module\":\"%s\",\"state\":%d,\"front_door_open\":%s,\"front_lock_locked\":%s}",
-                     mod, d.state, front_open, front_locked);
-            send_response(client, out);
-            free(mod);
-            close(client);
+        } else {
+            send_response(c, "{\"error\":\"unknown action\"}");
             return;
         }
+        jw_str(&w, "result", "ok");
+        jw_int(&w, "state", d.state);
+        jw_end(&w);
+        send_json(c, &w);
+        return;
+    }
 
-        send_response(client, "{\"error\":\"no status\"}");
-        free(mod);
-        close(client);
+    // Otherwise: forward command to hub which will deliver to the door.
+    // First check that the hub has a route to the module.
+    HubDoorStatus st;
+    if (!hub_udp_get_status(mod, &st)) {
+        send_response(c, "{\"result\":\"failed\",\"reason\":\"unknown_module\"}");
+        return;
+    }
+    if (!st.has_last_addr) {
+        send_response(c, "{\"result\":\"failed\",\"reason\":\"no_route\"}");
         return;
     }
 
-    if (strcmp(method, "POST") == 0 && strcmp(path, "/api/command") == 0) {
-        // find body (very small/simple parser)
-        char *body = strstr(buf, "\r\n\r\n");
-        if (!body) { send_response(client, "{\"error\":\"no body\"}"); close(client); return; }
-        body += 4;
-        // expect form-encoded: module=D1&target=D0&action=LOCK
-        char *mod = NULL; char *target = NULL; char *action = NULL;
-        char *bcopy = strdup(body);
-        char *save = NULL;
-        char *tok = strtok_r(bcopy, "&", &save);
-        while (tok) {
-            char *eq = strchr(tok, '=');
-            if (eq) {
-                *eq = '\0';
-                char *k = tok; char *v = eq + 1;
-                if (strcmp(k, "module") == 0) mod = strdup(v);
-                else if (strcmp(k, "target") == 0) target = strdup(v);
-                else if (strcmp(k, "action") == 0) action = strdup(v);
-            }
-            tok = strtok_r(NULL, "&", &save);
-        }
-        free(bcopy);
+    // Send command and wait for the module's ACCEPTED and then its
+    // COMPLETED/FAILED (blocks for the length of the move)
+    HubCmdResult res;
+    bool ok = hub_udp_send_command_ex(mod, target ? target : "", action, &res);
+    if (res.outcome == HUB_CMD_NO_ACK || res.outcome == HUB_CMD_NO_ROUTE) {
+        jw_str(&w, "result", "failed");
+        jw_str(&w, "reason", hub_cmd_outcome_name(res.outcome));
+        jw_end(&w);
+        send_json(c, &w);
+        return;
+    }
+    jw_str(&w, "result", ok ? "ok" : "failed");
+    if (!ok) jw_str(&w, "reason", hub_cmd_outcome_name(res.outcome));
+    jw_bool(&w, "ack", true);
+    jw_str(&w, "outcome", hub_cmd_outcome_name(res.outcome));
+    jw_int(&w, "cmdid", res.cmdid);
+    jw_str(&w, "state", res.state);
+    jw_int(&w, "duration_ms", res.duration_ms);
+    jw_int(&w, "accepted_ms", res.accepted_ms);
+    jw_int(&w, "total_ms", res.total_ms);
+    // latest FEEDBACK fields, as before
+    if (hub_udp_get_status(mod, &st)) {
+        jw_str(&w, "last_feedback_target", st.last_feedback_target);
+        jw_str(&w, "last_feedback_action", st.last_feedback_action);
+        jw_str(&w, "last_feedback_phase", st.last_feedback_phase);
+        jw_int(&w, "last_feedback_ms", st.last_feedback_ms);
+    }
+    jw_end(&w);
+    send_json(c, &w);
+}
 
-        if (!mod || !action) {
-            send_response(client, "{\"error\":\"missing fields\"}");
-            free(mod); free(target); free(action);
-            close(client); return;
-        }
+static void handle_client(int client)
+{
+    HttpConn *c = &g_conn;
+    c->fd = client;
+    arena_reset(&c->arena);
 
-        // If target module is local, perform directly
-        if (strcmp(mod, g_module_id) == 0) {
-            Door_t d = { .state = UNKNOWN };
-            if (strcmp(action, "LOCK") == 0) {
-                d = lockDoor(&d);
-            } else if (strcmp(action, "UNLOCK") == 0) {
-                d = unlockDoor(&d);
-            } else if (strcmp(action, "STATUS") == 0) {
-                d = get_door_status(&d);
-            } else {
-                send_response(client, "{\"error\":\"unknown action\"}");
-                free(mod); free(target); free(action);
-                close(client); return;
-            }
-            char out[256];
-            snprintf(out, sizeof(out), "{\"result\":\"ok\",\"state\":%d}", d.state);
-            send_response(client, out);
-            free(mod); free(target); free(action);
-            close(client); return;
-        }
+    HttpRequest req;
+    if (!recv_request(c) || !parse_request(c->recv_buf, c->recv_len, &req)) {
+        close(client);
+        return;
+    }
 
-        // Otherwise: forward command to hub which will deliver to the door.
-        // First check that the hub has a route to the module.
-        HubDoorStatus st;
-        if (!hub_udp_get_status(mod, &st)) {
-            send_response(client, "{\"result\":\"failed\",\"reason\":\"unknown_module\"}");
-            free(mod); free(target); free(action);
-            close(client); return;
-        }
-        if (!st.has_last_addr) {
-            send_response(client, "{\"result\":\"failed\",\"reason\":\"no_route\"}");
-            free(mod); free(target); free(action);
-            close(client); return;
+    // Static UI assets are public; the browser can't attach the API token
+    // to <script>/<link> loads.
+    if (sv_eq(req.method, "GET") || sv_eq(req.method, "HEAD")) {
+        const StaticAsset *a = find_asset(req.path);
+        if (a) {
+            send_asset(c, &req, a);
+            close(client);
+            return;
         }
+    }
 
-        // Send command and wait for ACK (hub_udp_send_command blocks until ACK or timeout)
-        bool sent = hub_udp_send_command(mod, target ? target : "", action);
-        if (sent) {
-            // refresh status to include the latest FEEDBACK fields
-            if (!hub_udp_get_status(mod, &st)) {
-                send_response(client, "{\"result\":\"ok\",\"ack\":true}");
-            } else {
-                char out[512];
-                snprintf(out, sizeof(out), "{\"result\":\"ok\",\"ack\":true,\"last_feedback_target\":\"%s\",\"last_feedback_action\":\"%s\",\"last_feedback_ms\":%lld}",
-                         st.last_feedback_target, st.last_feedback_action, st.last_feedback_ms);
-                send_response(client, out);
-            }
-        } else {
-            send_response(client, "{\"result\":\"failed\",\"reason\":\"no_ack\"}");
-        }
-        free(mod); free(target); free(action);
-        close(client); return;
+    // Simple API token enforcement: if HTTP_API_TOKEN is set, require
+    // header `X-API-TOKEN: <token>` to match. If not set, allow access
+    // (only possible on loopback, see http_api_start).
+    const char *expected_token = getenv("HTTP_API_TOKEN");
+    if (expected_token && expected_token[0] && !sv_eq(get_header(&req, "X-API-TOKEN"), expected_token)) {
+        send_response_status(c, 401, "{\"error\":\"unauthorized\"}");
+        close(client);
+        return;
     }
 
-    send_response(client, "{\"error\":\"unknown endpoint\"}");
+    if (sv_eq(req.method, "GET") && sv_eq(req.path, "/metrics")) {
+        // Prometheus scrape endpoint
+        handle_metrics(c);
+    } else if (sv_eq(req.method, "GET") && sv_eq(req.path, "/api/status")) {
+        handle_status(c, &req);
+    } else if (sv_eq(req.method, "POST") && sv_eq(req.path, "/api/command")) {
+        handle_command(c, &req);
+    } else {
+        send_response(c, "{\"error\":\"unknown endpoint\"}");
+    }
     close(client);
 }
 
@@ -275,6 +835,10 @@ static void *server_loop(void *arg)
             if (errno == EINTR) continue;
             break;
         }
+        struct timeval tv = { .tv_sec = HTTP_IO_TIMEOUT_MS / 1000,
+                              .tv_usec = (HTTP_IO_TIMEOUT_MS % 1000) * 1000 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
         handle_client(client);
     }
     return NULL;
@@ -284,6 +848,10 @@ bool http_api_start(const char *bind_addr, unsigned short port, const char *loca
 {
     if (server_running) return false;
     if (local_module_id) strncpy(g_module_id, local_module_id, sizeof(g_module_id)-1);
+    if (g_web_root[0]) {
+        int n = load_assets(g_web_root);
+        fprintf(stderr, "http_api: serving %d web UI file(s) from %s\n", n, g_web_root);
+    }
 
     server_sock = socket(AF_INET, SOCK_STREAM, 0);
     if (server_sock < 0) return false;
@@ -299,6 +867,12 @@ bool http_api_start(const char *bind_addr, unsigned short port, const char *loca
     if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1) {
         close(server_sock); server_sock = -1; return false;
     }
+    // /api can LOCK/UNLOCK doors: beyond loopback it needs a token
+    const char *token = getenv("HTTP_API_TOKEN");
+    if ((ntohl(addr.sin_addr.s_addr) >> 24) != 127 && (!token || !token[0])) {
+        fprintf(stderr, "http_api: refusing to listen on %s without HTTP_API_TOKEN\n", bind_addr);
+        close(server_sock); server_sock = -1; return false;
+    }
 
     if (bind(server_sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         close(server_sock); server_sock = -1; return false;
@@ -325,4 +899,5 @@ void http_api_stop(void)
         server_sock = -1;
     }
     pthread_join(server_thread, NULL);
+    free_assets();
 }
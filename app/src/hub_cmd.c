@@ -0,0 +1,80 @@
+/*
+ * hub_cmd.c
+ * Send one COMMAND to a door module through the hub's local socket and
+ * print its FEEDBACK.
+ * Usage: ./hub_cmd MODULE_ID TARGET ACTION     e.g. ./hub_cmd D1 D0 LOCK
+ *
+ * Runs alongside door_system on the hub (HUB_LOCAL_SOCKET overrides the
+ * socket path). Exits 0 once the module reports COMPLETED, 1 on FAILED,
+ * no_route or no answer within HUB_CMD_TIMEOUT_MS.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "hal/hub_local.h"
+
+#define HUB_CMD_TIMEOUT_MS 20000   // the hub itself gives up after 15 s
+#define HUB_CMD_ID         1       // the hub maps it to a cmdid of its own
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s MODULE_ID TARGET ACTION\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int fd = hub_local_connect(getenv("HUB_LOCAL_SOCKET"));
+    if (fd < 0) {
+        fprintf(stderr, "hub_cmd: can't reach the hub (is door_system running?)\n");
+        return EXIT_FAILURE;
+    }
+
+    char line[256];
+    int n = snprintf(line, sizeof(line), "%s COMMAND %d %s %s\n",
+                     argv[1], HUB_CMD_ID, argv[2], argv[3]);
+    if (n < 0 || (size_t)n >= sizeof(line) || send(fd, line, (size_t)n, 0) != n) {
+        fprintf(stderr, "hub_cmd: failed to send the command\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    // Replies are one line per packet: FEEDBACK ACCEPTED, then the outcome
+    int rc = EXIT_FAILURE;
+    bool done = false;
+    while (!done) {
+        struct pollfd p = { .fd = fd, .events = POLLIN };
+        if (poll(&p, 1, HUB_CMD_TIMEOUT_MS) <= 0) {
+            fprintf(stderr, "hub_cmd: no answer from %s\n", argv[1]);
+            break;
+        }
+        ssize_t len = recv(fd, line, sizeof(line) - 1, 0);
+        if (len <= 0) {
+            fprintf(stderr, "hub_cmd: hub closed the connection\n");
+            break;
+        }
+        line[len] = '\0';
+        fputs(line, stdout);
+
+        // <MOD> FEEDBACK <ID> <TARGET> <WORD> ...  or  <MOD> ERROR <ID> <why>
+        char type[16] = "", word[32] = "";
+        if (sscanf(line, "%*s %15s %*d %*s %31s", type, word) < 1) continue;
+        if (strcmp(type, "ERROR") == 0) {
+            done = true;
+        } else if (strcmp(type, "FEEDBACK") == 0 && strcmp(word, "ACCEPTED") != 0) {
+            // COMPLETED/FAILED, or a single-phase FEEDBACK from an older module
+            rc = strcmp(word, "FAILED") == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+            done = true;
+        }
+    }
+
+    close(fd);
+    return rc;
+}
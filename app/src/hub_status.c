@@ -0,0 +1,69 @@
+/*
+ * hub_status.c
+ * Print the hub's fleet status table straight from shared memory.
+ * Usage: ./hub_status [MODULE_ID]
+ *
+ * Runs alongside door_system on the hub; reads /dev/shm/door_hub_status
+ * without talking to the hub process at all.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hal/hub_shm.h"
+
+static long long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void print_status(const HubDoorStatus *st, long long now)
+{
+    printf("%-4s %-7s D0=%s,%s D1=%s,%s lastHB=%lldms ago HB=%dms lastFB=%s %s %s %s\n",
+           st->module_id,
+           st->offline ? "OFFLINE" : "online",
+           st->d0_open   ? "OPEN" : "CLOSED",
+           st->d0_locked ? "LOCKED" : "UNLOCKED",
+           st->d1_open   ? "OPEN" : "CLOSED",
+           st->d1_locked ? "LOCKED" : "UNLOCKED",
+           st->last_heartbeat_ms ? now - st->last_heartbeat_ms : -1,
+           st->heartbeat_interval_ms,
+           st->last_feedback_target[0] ? st->last_feedback_target : "-",
+           st->last_feedback_action[0] ? st->last_feedback_action : "-",
+           st->last_feedback_phase[0] ? st->last_feedback_phase : "-",
+           st->last_feedback_state[0] ? st->last_feedback_state : "-");
+}
+
+int main(int argc, char *argv[])
+{
+    HubShmReader reader;
+    if (!hub_shm_open(&reader)) {
+        fprintf(stderr, "hub_status: status table not available (is door_system running?)\n");
+        return EXIT_FAILURE;
+    }
+
+    long long now = now_ms();
+    int rc = EXIT_SUCCESS;
+    if (argc > 1) {
+        HubDoorStatus st;
+        if (hub_shm_read(&reader, argv[1], &st)) {
+            print_status(&st, now);
+        } else {
+            printf("No status for %s yet.\n", argv[1]);
+            rc = EXIT_FAILURE;
+        }
+    } else {
+        HubDoorStatus all[HUB_MAX_DOORS];
+        int n = hub_shm_snapshot(&reader, all, HUB_MAX_DOORS);
+        if (n == 0) printf("No modules known yet.\n");
+        for (int i = 0; i < n; i++) print_status(&all[i], now);
+    }
+
+    hub_shm_close(&reader);
+    return rc;
+}
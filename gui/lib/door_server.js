@@ -4,7 +4,9 @@
  *
  * - Sends COMMAND datagrams to hub at HUB_HOST:HUB_PORT (default 192.168.8.108:12345)
  * - Listens for incoming datagrams from hub and forwards to web clients
- * - Emits FEEDBACK messages for matching command ids back to requestor
+ * - Emits FEEDBACK messages for matching command ids back to requestor:
+ *   'command-accepted' when the module has queued the command, then
+ *   'command-feedback' (COMPLETED) or 'command-error' (FAILED / timeout)
  */
 
 const dgram = require('dgram');
@@ -16,11 +18,86 @@ const UDP_FAMILY = 'udp4';
 
 let io = null;
 let udpSocket = null;        // single socket for sending/receiving
-let cmdCounter = 1;          // simple increasing command id
+// Increasing command id, started from the clock so a restarted bridge
+// doesn't reuse ids a module still remembers (it replays the old
+// FEEDBACK for a (source, cmdid, target, action) it has seen recently)
+let cmdCounter = 1 + (Date.now() % 1000000000);
 
-// pending map: cmdid -> { socket, timer }
+// pending map: cmdid -> { socket, timer, onTimeout }
 const pending = new Map();
-const PENDING_TIMEOUT_MS = 5000;
+const PENDING_TIMEOUT_MS = 5000;    // COMMAND -> ACCEPTED (or a single-phase FEEDBACK)
+const COMPLETE_TIMEOUT_MS = 16000;  // ACCEPTED -> COMPLETED/FAILED (the motor is slow)
+
+// Door states a COMPLETED/FAILED FEEDBACK can carry (BUSY/INVALID mean
+// the command never ran and say nothing about the door)
+const DOOR_STATES = ['LOCKED', 'UNLOCKED', 'OPEN', 'UNKNOWN'];
+
+function addPending(cmdid, socket, onTimeout) {
+    const entry = { socket, onTimeout, timer: null };
+    entry.timer = setTimeout(() => {
+        pending.delete(cmdid);
+        onTimeout('No FEEDBACK from hub');
+    }, PENDING_TIMEOUT_MS);
+    pending.set(cmdid, entry);
+}
+
+// The module accepted the command: wait for its outcome instead
+function extendPending(cmdid) {
+    const p = pending.get(cmdid);
+    if (!p) return null;
+    clearTimeout(p.timer);
+    p.timer = setTimeout(() => {
+        pending.delete(cmdid);
+        p.onTimeout('No COMPLETED from module');
+    }, COMPLETE_TIMEOUT_MS);
+    return p;
+}
+
+function takePending(cmdid) {
+    const p = pending.get(cmdid);
+    if (!p) return null;
+    clearTimeout(p.timer);
+    pending.delete(cmdid);
+    return p;
+}
+
+// Single-phase modules answer "<ACTION>" with STATUS_* or legacy
+// "CLOSED,UNLOCKED" style text; return the door state it implies, or null.
+function legacyState(rawAction) {
+    const upper = rawAction.toUpperCase().trim();
+    if (upper.startsWith('STATUS_')) return upper.substring('STATUS_'.length);
+    if (upper.includes('OPEN') || upper.includes('CLOSED')) {
+        const tokens = upper.split(/[,\s]+/).map(s => s && s.trim()).filter(Boolean);
+        // Prefer the lock state for the toggle logic, else the door state
+        if (tokens.includes('LOCKED')) return 'LOCKED';
+        if (tokens.includes('UNLOCKED')) return 'UNLOCKED';
+        if (tokens.includes('OPEN')) return 'OPEN';
+        if (tokens.includes('CLOSED')) return 'CLOSED';
+        return 'UNKNOWN';
+    }
+    return null;
+}
+
+// <CMDID> <TARGET> ACCEPTED <ACTION>
+// <CMDID> <TARGET> COMPLETED|FAILED <ACTION> <STATE> <MS>
+// <CMDID> <TARGET> <ACTION...>                            (single-phase)
+function parseFeedback(parts) {
+    const fb = {
+        cmdid: parseInt(parts[2], 10),
+        target: parts[3],
+        phase: parts[4],
+        action: parts[5] || '',
+        state: parts[6] || null,
+        durationMs: parts[7] !== undefined ? parseInt(parts[7], 10) : null,
+    };
+    if (!['ACCEPTED', 'COMPLETED', 'FAILED'].includes(fb.phase)) {
+        fb.phase = 'COMPLETED';
+        fb.action = parts.slice(4).join(' ');
+        fb.state = legacyState(fb.action);
+        fb.durationMs = null;
+    }
+    return fb;
+}
 
 // ---------- UDP Socket setup ----------
 
@@ -52,92 +129,67 @@ function startUdpSocket() {
         const type = parts[1];
 
         if (type === 'FEEDBACK' && parts.length >= 5) {
-            // <MODULE> FEEDBACK <CMDID> <TARGET> <ACTION...>
-            const cmdid = parseInt(parts[2], 10);
-            const target = parts[3];
-            const rawAction = parts.slice(4).join(' '); // may be STATUS_* or CLOSED,UNLOCKED, etc.
-
-            console.log(`[FEEDBACK] cmdid=${cmdid}, target=${target}, action="${rawAction}", pending.size=${pending.size}`);
-            console.log(`[FEEDBACK] Full parts array:`, parts);
-            console.log(`[FEEDBACK] Raw message: "${msg}"`);
+            const fb = parseFeedback(parts);
+            const { cmdid, target, phase, action, state, durationMs } = fb;
+            console.log(`[FEEDBACK] cmdid=${cmdid}, target=${target}, phase=${phase}, action="${action}", state=${state}, pending.size=${pending.size}`);
+
+            const data = {
+                module: moduleId,
+                cmdid,
+                target,
+                phase,
+                action,
+                state,
+                status: state ? `STATUS_${state}` : null,
+                durationMs,
+                raw: msg,
+            };
+
+            if (phase === 'ACCEPTED') {
+                // Keep the pending entry: the outcome follows once the motor has moved
+                const p = extendPending(cmdid);
+                if (p) {
+                    try {
+                        p.socket.emit('command-accepted', data);
+                    } catch (e) {
+                        console.error('Error emitting accepted to socket:', e);
+                    }
+                }
+                if (io) io.sockets.emit('command-accepted', data);
+                return;
+            }
 
-            // If a pending request exists, emit FEEDBACK directly back to that socket
-            const p = pending.get(cmdid);
+            // If a pending request exists, emit the outcome directly back to that socket
+            const p = takePending(cmdid);
             if (p) {
-                console.log(`[FEEDBACK] Found pending entry for cmdid ${cmdid}, emitting to socket`);
+                console.log(`[FEEDBACK] Found pending entry for cmdid ${cmdid}, emitting ${phase} to socket`);
                 try {
-                    p.socket.emit('command-feedback', {
-                        module: moduleId,
-                        cmdid,
-                        target,
-                        action: rawAction,
-                        raw: msg,
-                    });
+                    if (phase === 'COMPLETED') {
+                        p.socket.emit('command-feedback', data);
+                    } else {
+                        p.socket.emit('command-error', { ...data, error: `${action} failed (${state || 'UNKNOWN'})` });
+                    }
                 } catch (e) {
                     console.error('Error emitting feedback to socket:', e);
                 }
-                clearTimeout(p.timer);
-                pending.delete(cmdid);
             } else {
                 console.log(`[FEEDBACK] NO pending entry for cmdid ${cmdid}. Pending keys: [${Array.from(pending.keys()).join(', ')}]`);
             }
 
             // Broadcast to *all* web clients as well for UI status updates
             if (io) {
-                // Normalize to STATUS_* if needed.
-                // If doormod already sends STATUS_*, just passthrough.
-                let formattedAction = rawAction;
-                const upper = rawAction.toUpperCase().trim();
-
-                if (upper.startsWith('STATUS_')) {
-                    formattedAction = upper; // e.g., STATUS_LOCKED
-                    console.log(`[FEEDBACK] Using STATUS_* directly: ${formattedAction}`);
-                } else if (upper === 'STATUS') {
-                    // Bare STATUS command - we need to query the hub for the actual status
-                    // For now, default to UNKNOWN until the module sends proper STATUS_* responses
-                    formattedAction = 'STATUS_UNKNOWN';
-                    console.log(`[FEEDBACK] Got bare STATUS, defaulting to STATUS_UNKNOWN (module should send STATUS_LOCKED or STATUS_UNLOCKED)`);
-                } else if (upper.includes('OPEN') || upper.includes('CLOSED')) {
-                    // Legacy style, like "CLOSED,UNLOCKED" or "OPEN,LOCKED"
-                    const tokens = upper
-                        .split(/[,\s]+/)
-                        .map(s => s && s.trim())
-                        .filter(Boolean);
-
-                    let doorState = null;
-                    let lockState = null;
-                    for (const tok of tokens) {
-                        if (tok === 'OPEN' || tok === 'CLOSED') doorState = tok;
-                        if (tok === 'LOCKED' || tok === 'UNLOCKED') lockState = tok;
-                    }
-
-                    // Prefer lockState for the toggle logic, else doorState
-                    if (lockState) {
-                        formattedAction = `STATUS_${lockState}`;
-                    } else if (doorState) {
-                        formattedAction = `STATUS_${doorState}`;
-                    } else {
-                        formattedAction = 'STATUS_UNKNOWN';
-                    }
-
-                    console.log(`[FEEDBACK] Converted legacy "${upper}" -> ${formattedAction}`);
+                // Normalized channel for web_control.js: STATUS_<state> with
+                // the door state the module reported, whether or not the
+                // command succeeded. Single-phase LOCK/UNLOCK carry no state
+                // and pass through as before (the UI then polls STATUS).
+                if (!state) {
+                    io.sockets.emit('door-feedback', { module: moduleId, target, action });
+                } else if (DOOR_STATES.includes(state) || state === 'CLOSED') {
+                    io.sockets.emit('door-feedback', { module: moduleId, target, action: `STATUS_${state}` });
                 }
 
-                // New, normalized channel for web_control.js
-                io.sockets.emit('door-feedback', {
-                    module: moduleId,
-                    target,
-                    action: formattedAction,
-                });
-
                 // Also broadcast raw/legacy command-feedback for compatibility
-                io.sockets.emit('command-feedback', {
-                    module: moduleId,
-                    cmdid,
-                    target,
-                    action: rawAction,
-                    raw: msg,
-                });
+                io.sockets.emit('command-feedback', data);
             }
 
             return;
@@ -193,21 +245,14 @@ function sendCommand(moduleId, target, action, socket) {
         // Track pending FEEDBACK if we were given a socket
         if (socket) {
             console.log(`[PENDING] Registering cmdid=${cmdid} for ${moduleId}`);
-            const timer = setTimeout(() => {
-                console.log(`[PENDING] Timeout for cmdid ${cmdid}`);
-                pending.delete(cmdid);
+            addPending(cmdid, socket, (error) => {
+                console.log(`[PENDING] Timeout for cmdid ${cmdid}: ${error}`);
                 try {
-                    socket.emit('command-error', {
-                        module: moduleId,
-                        cmdid,
-                        error: 'No FEEDBACK from hub',
-                    });
+                    socket.emit('command-error', { module: moduleId, cmdid, error });
                 } catch (e) {
                     console.error('Error emitting timeout to socket:', e);
                 }
-            }, PENDING_TIMEOUT_MS);
-
-            pending.set(cmdid, { socket, timer });
+            });
         }
     });
 }
@@ -246,60 +291,32 @@ function handleSocket(ws) {
         const payload = `${mod} COMMAND ${cmdid} D0 STATUS\n`;
         const buf = Buffer.from(payload, 'utf8');
 
-        const timer = setTimeout(() => {
-            pending.delete(cmdid);
-            callback(null); // timeout -> no info
-        }, PENDING_TIMEOUT_MS);
-
         // Fake socket object that only cares about this one FEEDBACK
-        pending.set(cmdid, {
-            socket: {
-                emit: (eventType, data) => {
-                    if (eventType !== 'command-feedback') return;
-                    clearTimeout(timer);
-                    pending.delete(cmdid);
-
-                    const rawAction = data.action || '';
-                    const upper = rawAction.toUpperCase();
-
-                    let frontDoorOpen = null;
-                    let frontLockLocked = null;
-
-                    if (upper.startsWith('STATUS_')) {
-                        // Handle STATUS_* format
-                        const state = upper.substring('STATUS_'.length);
-                        if (state === 'OPEN') frontDoorOpen = true;
-                        if (state === 'CLOSED') frontDoorOpen = false;
-                        if (state === 'LOCKED') frontLockLocked = true;
-                        if (state === 'UNLOCKED') frontLockLocked = false;
-                    } else if (upper.includes('OPEN') || upper.includes('CLOSED')) {
-                        // Legacy "CLOSED,UNLOCKED" etc
-                        const parts = upper.split(/[,\s]+/).map(s => s && s.trim()).filter(Boolean);
-                        if (parts.includes('OPEN')) frontDoorOpen = true;
-                        if (parts.includes('CLOSED')) frontDoorOpen = false;
-                        if (parts.includes('LOCKED')) frontLockLocked = true;
-                        if (parts.includes('UNLOCKED')) frontLockLocked = false;
-                    }
-
-                    callback({
-                        moduleId: data.module,
-                        target: data.target,
-                        status: rawAction,
-                        frontDoorOpen: !!frontDoorOpen,
-                        frontLockLocked: !!frontLockLocked,
-                        success: true,
-                    });
-                },
+        addPending(cmdid, {
+            emit: (eventType, data) => {
+                if (eventType !== 'command-feedback') return;
+
+                const state = data.state || '';
+                let frontDoorOpen = null;
+                let frontLockLocked = null;
+                if (state === 'OPEN') frontDoorOpen = true;
+                if (state === 'CLOSED') frontDoorOpen = false;
+                if (state === 'LOCKED') frontLockLocked = true;
+                if (state === 'UNLOCKED') frontLockLocked = false;
+
+                callback({
+                    moduleId: data.module,
+                    target: data.target,
+                    status: data.status || data.action,
+                    frontDoorOpen: !!frontDoorOpen,
+                    frontLockLocked: !!frontLockLocked,
+                    success: true,
+                });
             },
-            timer,
-        });
+        }, () => callback(null)); // timeout -> no info
 
         udpSocket.send(buf, 0, buf.length, HUB_PORT, HUB_HOST, (err) => {
-            if (err) {
-                clearTimeout(timer);
-                pending.delete(cmdid);
-                callback(null);
-            }
+            if (err && takePending(cmdid)) callback(null);
         });
     });
 
@@ -308,9 +325,10 @@ function handleSocket(ws) {
         sendCommand(moduleId, 'D0', 'LOCK', {
             emit: (eventType, data) => {
                 if (eventType === 'command-feedback') {
-                    callback({ success: true, action: 'LOCK', module: moduleId });
+                    callback({ success: true, action: 'LOCK', module: moduleId,
+                               state: data.state, durationMs: data.durationMs });
                 } else if (eventType === 'command-error') {
-                    callback({ success: false, error: data.error });
+                    callback({ success: false, error: data.error, state: data.state });
                 }
             },
         });
@@ -321,9 +339,10 @@ function handleSocket(ws) {
         sendCommand(moduleId, 'D0', 'UNLOCK', {
             emit: (eventType, data) => {
                 if (eventType === 'command-feedback') {
-                    callback({ success: true, action: 'UNLOCK', module: moduleId });
+                    callback({ success: true, action: 'UNLOCK', module: moduleId,
+                               state: data.state, durationMs: data.durationMs });
                 } else if (eventType === 'command-error') {
-                    callback({ success: false, error: data.error });
+                    callback({ success: false, error: data.error, state: data.state });
                 }
             },
         });
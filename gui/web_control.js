@@ -1,8 +1,71 @@
 // gui/web_control.js
 // Web-based control panel for Central Door System
-// Communicates with server.js via WebSocket to send commands and receive status updates via UDP
+// Communicates with server.js via WebSocket to send commands and receive status updates via UDP.
+// When the page is served by the hub itself (no socket.io), falls back to the hub's /api/* endpoints.
+
+// POST to the hub API with the token it asked for (HTTP_API_TOKEN). The
+// token is asked for once on a 401 and kept in localStorage; the custom
+// header also means other sites can't post here without a CORS preflight.
+function hubApiPost(path, body, retried) {
+    const headers = { 'X-API-TOKEN': localStorage.getItem('hubApiToken') || '' };
+    return fetch(path, { method: 'POST', body, headers }).then(res => {
+        if (res.status !== 401 || retried) return res;
+        const token = window.prompt('Hub API token');
+        if (token === null) return res;
+        localStorage.setItem('hubApiToken', token);
+        return hubApiPost(path, body, true);
+    });
+}
+
+// Minimal stand-in for the socket.io client backed by the hub HTTP API.
+// Only implements what this file uses: on(), emit('send-command') and connected.
+function createHubApiSocket() {
+    const handlers = {};
+    const fire = (event, data) => (handlers[event] || []).forEach(fn => fn(data));
+    const api = {
+        connected: true,
+        on(event, fn) {
+            (handlers[event] = handlers[event] || []).push(fn);
+        },
+        emit(event, data) {
+            if (event !== 'send-command' || !data) return;
+            const { module, target, action } = data;
+            const body = new URLSearchParams({ module, target: target || 'D0', action });
+            hubApiPost('/api/command', body)
+                .then(res => res.json())
+                .then(json => {
+                    // The hub waits for the module's COMPLETED/FAILED and
+                    // reports the door state it ended in, even on failure
+                    const doorState = ['LOCKED', 'UNLOCKED', 'OPEN', 'UNKNOWN'].includes(json.state)
+                        ? json.state : null;
+                    if (doorState) {
+                        fire('door-feedback', {
+                            module,
+                            target: json.last_feedback_target || target,
+                            action: `STATUS_${doorState}`,
+                        });
+                    }
+                    if (json.result !== 'ok') {
+                        fire('command-error', { module, error: json.reason || json.error || 'failed' });
+                        return;
+                    }
+                    if (!doorState) {
+                        // Older hubs report the module's FEEDBACK action (e.g. STATUS_LOCKED)
+                        fire('door-feedback', {
+                            module,
+                            target: json.last_feedback_target || target,
+                            action: json.last_feedback_action || action,
+                        });
+                    }
+                })
+                .catch(err => fire('command-error', { module, error: err.message }));
+        },
+    };
+    setTimeout(() => fire('connect'), 0);
+    return api;
+}
 
-const socket = io();
+const socket = (typeof io === 'function') ? io() : createHubApiSocket();
 
 // Module cache to track door states
 const doorStates = {
@@ -176,6 +239,14 @@ function setupServerMessageHandlers() {
         }
     });
 
+    // The module queued a LOCK/UNLOCK; the outcome follows once the motor has moved
+    socket.on('command-accepted', (data) => {
+        console.log('Received command-accepted:', data);
+        const moduleNum = data.module ? data.module.replace('D', '') : 'unknown';
+        const msg = document.getElementById(`door${moduleNum}_message`);
+        if (msg) msg.textContent = `${data.action === 'UNLOCK' ? 'Unlocking' : 'Locking'}...`;
+    });
+
     // Legacy / generic feedback handler (kept for compatibility)
     socket.on('command-feedback', (data) => {
         console.log('Received command-feedback:', data);
@@ -188,6 +259,14 @@ function setupServerMessageHandlers() {
             return;
         }
 
+        // Two-phase modules report the resulting door state directly
+        if (['LOCKED', 'UNLOCKED', 'OPEN', 'UNKNOWN'].includes(data.state)) {
+            applyStatusStateToDoor(moduleId, data.state);
+            updateUIForModule(moduleId);
+            return;
+        }
+        if (data.phase === 'FAILED') return;
+
         console.log(`Parsing feedback for ${moduleId}: action="${action}", target="${target}"`);
 
         // If it is already STATUS_*, use the same helper
@@ -34,5 +34,62 @@ bool write_pin_value(int chip, int line, int value);
  */
 int read_pin_value(int chip, int line);
 
+/* Edge event delivered by the kernel for a line set up with
+ * export_pin_edges(). timestamp_ns is CLOCK_MONOTONIC, taken in the
+ * interrupt handler, so it doesn't include our scheduling latency. */
+typedef struct {
+    bool rising;
+    unsigned long long timestamp_ns;
+} GpioEdgeEvent;
+
+/* Initialize a GPIO line as an input reporting rising and falling edges
+ * (pull-down, like export_pin(..., "in")). read_pin_value() keeps working.
+ * Returns: true on success, false if the line/driver can't do edge events
+ */
+bool export_pin_edges(int chip, int line);
+
+/* Wait for the next edge on a line from export_pin_edges(). Sleeps in
+ * poll(), no busy waiting.
+ * Returns: 1 with *ev filled, 0 on timeout, -1 on error
+ */
+int wait_pin_edge(int chip, int line, int timeout_ms, GpioEdgeEvent *ev);
+
+/* Discard edge events already queued for the line. */
+void flush_pin_edges(int chip, int line);
+
+/* Several lines of one chip requested together as a single kernel handle,
+ * so they can be set or read with one ioctl. Bit i of a mask/value refers
+ * to lines[i] as passed to export_pin_group(). */
+#define GPIO_GROUP_MAX_LINES 8
+
+typedef struct {
+    int chip;
+    int num_lines;
+    int lines[GPIO_GROUP_MAX_LINES];
+    int line_fd;      /* -1 when not requested */
+    bool is_output;
+} GpioPinGroup;
+
+/* Request num_lines lines of a chip as one group (pull-down for inputs,
+ * like export_pin). The lines must not also be exported individually.
+ * Returns: true on success, false on error
+ */
+bool export_pin_group(GpioPinGroup *group, int chip, const int *lines, int num_lines,
+                      const char* direction);
+
+/* Release the group's lines. Safe on a group that was never requested. */
+void release_pin_group(GpioPinGroup *group);
+
+/* Set the lines selected by mask to the matching bits of values, leaving
+ * the others alone, in one ioctl.
+ * Returns: true on success, false on error
+ */
+bool write_pin_group(const GpioPinGroup *group, unsigned int mask, unsigned int values);
+
+/* Read the lines selected by mask in one ioctl.
+ * Returns: the values as a bit mask (>= 0) on success, -1 on error
+ */
+int read_pin_group(const GpioPinGroup *group, unsigned int mask);
+
 
 #endif // GPIO_H
\ No newline at end of file
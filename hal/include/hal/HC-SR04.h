@@ -4,6 +4,7 @@
 #include <stdlib.h>  // exit, EXIT_FAILURE, EXIT_SUCCESS
 #include <stdbool.h>
 #include <time.h>
+#include "hal/distance_filter.h"
 
 #define TRIG_GPIOCHIP 1  /* GPIO chip number for trigger pin */
 #define TRIG_GPIO_LINE 33 /* GPIO27 - from gpioinfo: gpiochip1 33 "GPIO27" */
@@ -11,9 +12,41 @@
 #define ECHO_GPIO_LINE 8 /* GPIO17 - from gpioinfo: gpiochip2 8 "GPIO17" */
 
 
+#define HC_SR04_DEFAULT_PERIOD_MS 100  /* sampler rate; keep >= 60 ms so echoes die out */
+
 bool init_hc_sr04();
 
+/* One blocking measurement (up to ~120 ms), -1 on error. Fires the
+ * sensor directly: while the sampler runs, use the cached reading
+ * instead so triggers never overlap. */
 long long get_distance();
 
+/* Latest reading published by the sampler thread after every sample.
+ * distance_cm is the filtered distance (see distance_filter.h), -1 if the
+ * sensor has failed too often to have one. state/confidence are the
+ * debounced NEAR/FAR classification. timestamp_ms (getTimeInMs clock) is
+ * when it was taken; seq counts published readings. */
+typedef struct {
+    long long     distance_cm;
+    DistanceClass state;
+    double        confidence;
+    long long     timestamp_ms;
+    unsigned long seq;
+} HcSr04Reading;
+
+/* Start/stop the thread that owns the sensor and samples it every
+ * period_ms (<= 0: HC_SR04_DEFAULT_PERIOD_MS), filtering with `filter`
+ * (NULL: smoothing only, state stays DISTANCE_UNKNOWN). */
+bool hc_sr04_sampler_start(int period_ms, const DistanceFilterConfig *filter);
+void hc_sr04_sampler_stop(void);
+
+/* Copy the latest reading without blocking. Returns false if the sampler
+ * hasn't published one yet. */
+bool hc_sr04_latest(HcSr04Reading *out);
+
+/* Wait up to timeout_ms for a reading taken after after_ms. Returns false
+ * on timeout (out then holds the latest reading, if any). */
+bool hc_sr04_wait_newer(long long after_ms, int timeout_ms, HcSr04Reading *out);
+
 
 #endif // HC_SR04_H
\ No newline at end of file
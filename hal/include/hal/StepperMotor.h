@@ -40,11 +40,63 @@ static const int zero_pattern[4] = {0, 0, 0, 0};
 #define IN3_GPIO_LINE 15 /* GPIO15 - from gpioinfo: gpiochip2 15 "GPIO15" */
 #define IN4_GPIOCHIP 2  /* GPIO chip number for IN4 pin */
 #define IN4_GPIO_LINE 17 /* GPIO17 - from gpioinfo: gpiochip2 17 "GPIO17" */
+// IN1/IN2 and IN3/IN4 are driven as one line group each, so each pair
+// must share a chip.
+#if IN1_GPIOCHIP != IN2_GPIOCHIP || IN3_GPIOCHIP != IN4_GPIOCHIP
+#error "StepperMotor: IN1/IN2 and IN3/IN4 must each be on one gpiochip"
+#endif
+
+// Motion profile defaults (half-steps per second). A 28BYJ-48 stalls if
+// started at full speed, so moves ramp up from the start rate and back
+// down before the target (trapezoidal profile).
+#define STEPPER_DEFAULT_START_RATE 300
+#define STEPPER_DEFAULT_MAX_RATE   800
+#define STEPPER_DEFAULT_ACCEL      1500  /* half-steps per second^2 */
+
+#define STEPPER_MAX_QUEUED_MOVES 8
+
+typedef struct {
+    int start_steps_per_s;   // speed of the first and last step
+    int max_steps_per_s;     // cruise speed
+    int accel_steps_per_s2;  // ramp slope, used for both ramps
+} StepperProfile;
+
+typedef enum {
+    STEPPER_MOVE_DONE = 0,   // reached the target
+    STEPPER_MOVE_CANCELLED,  // cancelled (or engine shut down); stopped early
+    STEPPER_MOVE_FAILED      // GPIO write failed
+} StepperMoveResult;
+
+// Called on the motion thread when a move ends, with the position it ended
+// at. Keep it short; it may queue further moves but must not wait on them.
+typedef void (*StepperMoveCallback)(int move_id, StepperMoveResult result,
+                                    int position_degrees, void *ctx);
 
 // Function declarations
+// Init exports the pins and starts the motion thread.
 bool StepperMotor_Init(void);
+// Stop the motion thread: the current move decelerates to a stop, queued
+// moves are cancelled, then the coils are switched off.
+void StepperMotor_Shutdown(void);
+
+// Queue a move to target_degrees (0..360) along the shorter direction.
+// Moves run in order on the motion thread. Returns the move id (> 0), or
+// -1 if the engine isn't running or the queue is full. cb may be NULL.
+int StepperMotor_MoveAsync(int target_degrees, StepperMoveCallback cb, void *ctx);
+// Cancel a move by id, or every queued and running move with id 0. A
+// running move ramps down rather than stopping dead. Returns false if the
+// id is neither queued nor running.
+bool StepperMotor_Cancel(int move_id);
+// Wait until no move is queued or running (timeout_ms < 0: forever).
+bool StepperMotor_WaitIdle(int timeout_ms);
+bool StepperMotor_IsMoving(void);
+// Applies to moves that start after the call.
+bool StepperMotor_SetProfile(const StepperProfile *profile);
+
+// Blocking move: queues the move and waits for it. True if it got there.
 bool StepperMotor_Rotate(int target_degrees);
 int StepperMotor_GetPosition(void);
+// Fails while a move is queued or running.
 bool StepperMotor_ResetPosition(void);
 
 #endif // STEPPER_MOTOR_H
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef DISTANCE_FILTER_H
+#define DISTANCE_FILTER_H
+
+// Streaming filter for noisy range readings (HC-SR04).
+//
+// Each raw sample goes through a median-of-N window (drops single-sample
+// spikes), then an EMA (smooths jitter). The smoothed value is classified
+// NEAR/FAR against two thresholds with a dead band between them, and the
+// classification only switches after `debounce_samples` consecutive
+// samples agree. Too many failed samples in a row make it UNKNOWN.
+//
+// Pure computation, no locking: feed it from one thread.
+
+#include <stdbool.h>
+
+#define DISTANCE_FILTER_MAX_N 9
+
+typedef enum {
+    DISTANCE_UNKNOWN = 0,
+    DISTANCE_NEAR,       // below near_below_cm (e.g. door closed)
+    DISTANCE_FAR         // above far_above_cm  (e.g. door open)
+} DistanceClass;
+
+typedef struct {
+    int    median_n;          // odd, 1..DISTANCE_FILTER_MAX_N
+    double ema_alpha;         // weight of the newest median, 0 < a <= 1
+    double near_below_cm;     // <= 0 disables classification
+    double far_above_cm;      // >= near_below_cm
+    int    debounce_samples;  // consecutive agreeing samples to switch
+    int    max_failures;      // consecutive failed samples before UNKNOWN
+} DistanceFilterConfig;
+
+typedef struct {
+    DistanceFilterConfig cfg;
+    double        window[DISTANCE_FILTER_MAX_N];
+    int           len, pos;
+    double        ema;
+    bool          ema_valid;
+    DistanceClass state;
+    DistanceClass candidate;
+    int           candidate_count;
+    int           failures;
+} DistanceFilter;
+
+// Defaults around a single threshold: NEAR below threshold - hysteresis,
+// FAR above threshold + hysteresis; median of 5, EMA 0.4, 3-sample
+// debounce, UNKNOWN after 5 failures.
+void distance_filter_config_default(DistanceFilterConfig *cfg, double threshold_cm,
+                                    double hysteresis_cm);
+
+// cfg may be NULL for defaults with classification disabled.
+void distance_filter_init(DistanceFilter *f, const DistanceFilterConfig *cfg);
+
+// Feed one raw sample (< 0 = failed measurement). Returns true if the
+// debounced class changed.
+bool distance_filter_update(DistanceFilter *f, double raw_cm);
+
+// Smoothed distance, or -1 if there is no valid data.
+double distance_filter_value(const DistanceFilter *f);
+
+DistanceClass distance_filter_class(const DistanceFilter *f);
+
+// 0..1: how full the median window is times the share of its samples that
+// agree with the current class (0 while UNKNOWN).
+double distance_filter_confidence(const DistanceFilter *f);
+
+#endif // DISTANCE_FILTER_H
@@ -0,0 +1,53 @@
+// door_state.h
+// The door module's authoritative state: what the ultrasonic sensor says
+// about the door, where the lock motor is, and whether that counts as
+// locked. The HC-SR04 sampler and the stepper motion thread publish into
+// it; the reporter, heartbeat, command handler and CLI read snapshots.
+//
+// The record sits behind a sequence counter: a publish makes it odd,
+// rewrites the record, then makes it even. door_state_read() copies the
+// record and retries if the counter was odd or moved during the copy, so
+// readers never block and never see half an update. The two publishers
+// are serialized by a writer lock that readers don't touch.
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "hal/HC-SR04.h"
+#include "hal/distance_filter.h"
+
+#define DOOR_STATE_DEFAULT_LOCK_DEGREES 180
+
+typedef struct {
+    uint64_t      version;        // bumped by every publish; 0: nothing published yet
+    long long     updated_ms;     // getTimeInMs() of the last publish
+
+    // Sensor side, copied from the sampler's latest HcSr04Reading
+    DistanceClass door;           // debounced: NEAR = closed, FAR = open
+    double        confidence;
+    long long     distance_cm;    // -1: no usable reading
+    long long     sensor_ms;      // when the reading was taken; 0: none yet
+    uint32_t      door_version;   // bumped each time `door` changes
+
+    // Motor side
+    int           motor_degrees;
+    bool          motor_moving;
+    bool          locked;         // at rest at the lock position
+    uint32_t      lock_version;   // bumped each time `locked` changes
+} DoorStateSnapshot;
+
+// Position that counts as locked (default DOOR_STATE_DEFAULT_LOCK_DEGREES).
+void door_state_set_lock_position(int degrees);
+
+// Publishers. The sampler calls door_state_publish_sensor() with each
+// reading before waking hc_sr04_wait_newer() callers; the motion thread
+// calls door_state_publish_motor() as the rotor moves and when it stops.
+void door_state_publish_sensor(const HcSr04Reading *r);
+void door_state_publish_motor(int degrees, bool moving);
+
+// Wait-free copy of the current record.
+void door_state_read(DoorStateSnapshot *out);
+
+// Called from the publishing thread, after the record is updated, whenever
+// `door` or `locked` changes. Keep it short (e.g. post to a reactor).
+typedef void (*DoorStateChangeFn)(void *ctx);
+void door_state_set_change_callback(DoorStateChangeFn fn, void *ctx);
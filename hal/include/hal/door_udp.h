@@ -3,6 +3,7 @@
 #pragma once
 #include <stdbool.h>
 #include <stdint.h>
+#include "hal/door_state.h"
 
 typedef enum {
     DOOR_REPORT_NONE         = 0,
@@ -25,15 +26,79 @@ bool door_udp_init2(const char *host_ip, uint16_t notif_port, uint16_t hb_port,
 void door_udp_update(bool d0_open, bool d0_locked,
                      bool d1_open, bool d1_locked);
 
+// Report a door_state snapshot: D0 from the sensor, D1 from the lock.
+// Snapshots older than the last one reported are ignored, so concurrent
+// callers can't make the EVENTs flap. Safe to call from any thread.
+void door_udp_update_state(const DoorStateSnapshot *s);
+
+// Same, but always sends the HEARTBEAT (if enabled): for callers that
+// keep the heartbeat period on a timer of their own.
+void door_udp_heartbeat(const DoorStateSnapshot *s);
+
+/* Adaptive heartbeat. heartbeat_period_ms from init is the fast rate, used
+ * after an EVENT or COMMAND; each heartbeat with nothing in between doubles
+ * the interval, up to the idle ceiling. Every HEARTBEAT ends with HB=<ms>,
+ * the interval until the next one, so the hub can size its offline timeout
+ * per module. An idle ceiling <= the fast rate keeps a fixed rate.
+ *
+ * The hub can push back with "<MOD> CONFIG RATE <PERIOD_MS> <JITTER_MS>
+ * <PHASE_MS>" on the command socket: both rates are raised to PERIOD_MS,
+ * each interval gets a random 0..JITTER_MS on top, and the next heartbeat
+ * goes out PHASE_MS after the CONFIG. PERIOD_MS 0 lifts the floor. */
+#define DOOR_HB_DEFAULT_IDLE_MS 16000
+void door_udp_set_heartbeat_idle(int idle_ms);
+
+/* Called (with door_udp's reporting lock held, so keep it short) whenever
+ * the heartbeat interval changes; a caller driving door_udp_heartbeat()
+ * from a timer re-arms it here. */
+typedef void (*DoorHeartbeatRateFn)(int interval_ms, void *ctx);
+void door_udp_set_heartbeat_rate_callback(DoorHeartbeatRateFn fn, void *ctx);
+
+/* Current interval until the next heartbeat. */
+int door_udp_heartbeat_interval(void);
+
+/* Reliable EVENTs. With the command listener running (door_udp_init2),
+ * every EVENT ends in SEQ=<EPOCH>.<N> BASE=<B>: EPOCH is fixed per
+ * door_udp_init2(), N counts up from 1 and B is the oldest N not yet
+ * acknowledged, where a hub that lost track of the module starts. The
+ * hub answers "<MOD> ACK <EPOCH>.<N>" once it has applied every EVENT up
+ * to N, in order. Unacknowledged EVENTs are resent as a window (go-back-N)
+ * 250 ms after the last progress, backing off to 8 s. Beyond the window
+ * they wait in a spill file (see event_spool.h); set its path before init,
+ * NULL or "" keeps them in memory only. An EVENT lost from the spill file
+ * goes out as "<MOD> EVENT LOST SEQ=..." so its seq is never skipped.
+ * Without the listener EVENTs go out unnumbered, as before. */
+void door_udp_set_event_spool(const char *path);
+
+/* EVENTs sent or queued but not acknowledged yet. */
+int door_udp_events_pending(void);
+
+/* Batching. With the command listener running, lines sent within the
+ * batch window of the first one go out together as one datagram of
+ * '\n'-terminated records (up to DOOR_UDP_BATCH_MAX bytes). A HEARTBEAT
+ * joins pending notifications on their port rather than going out alone.
+ * The hub must split datagrams on '\n'. Set before init; 0 disables. */
+#define DOOR_UDP_DEFAULT_BATCH_MS 5
+#define DOOR_UDP_BATCH_MAX        1024
+void door_udp_set_batch_window(int window_ms);
+
 void door_udp_close(void);
 
+/* Identifies one received COMMAND: its sender, cmdid, target and action.
+ * Hand it back to the FEEDBACK calls so a retransmit from that sender is
+ * answered with that command's own reply, even when another client used
+ * the same cmdid. 0 means none (the reply is sent but not remembered). */
+typedef uint32_t DoorCmdRef;
+
 /* Command handler callback: invoked when a COMMAND is received for this module.
  * module: module id in the incoming message (should match registered module)
  * cmdid: numeric command id
  * target/action: textual tokens from the COMMAND
+ * ref: the COMMAND, to pass to the FEEDBACK calls below
  * ctx: user-provided context from register call
  */
-typedef void (*DoorCmdHandler)(const char *module, int cmdid, const char *target, const char *action, void *ctx);
+typedef void (*DoorCmdHandler)(const char *module, int cmdid, const char *target, const char *action,
+                               DoorCmdRef ref, void *ctx);
 
 /* Register a command handler callback. Returns true on success. */
 bool door_udp_register_command_handler(DoorCmdHandler handler, void *ctx);
@@ -41,4 +106,19 @@ bool door_udp_register_command_handler(DoorCmdHandler handler, void *ctx);
 /* Send a FEEDBACK message back to the hub (formatted by HAL transport).
  * Returns true if the send succeeded (socket open), false otherwise.
  */
-bool door_udp_send_feedback(const char *module, int cmdid, const char *target, const char *action);
+bool door_udp_send_feedback(const char *module, int cmdid, const char *target, const char *action,
+                            DoorCmdRef ref);
+
+/* Two-phase command feedback. A module acknowledges a COMMAND as soon as
+ * it is queued:
+ *   <MOD> FEEDBACK <ID> <TARGET> ACCEPTED <ACTION>
+ * and reports the outcome once it has run:
+ *   <MOD> FEEDBACK <ID> <TARGET> COMPLETED|FAILED <ACTION> <STATE> <MS>
+ * STATE is the door state afterwards (LOCKED/UNLOCKED/OPEN/UNKNOWN, or
+ * BUSY/INVALID when the command was not run) and MS how long it took.
+ * A single-phase FEEDBACK from older modules reads as COMPLETED.
+ */
+bool door_udp_send_accepted(const char *module, int cmdid, const char *target, const char *action,
+                            DoorCmdRef ref);
+bool door_udp_send_result(const char *module, int cmdid, const char *target, const char *action,
+                          bool ok, const char *state, long long duration_ms, DoorCmdRef ref);
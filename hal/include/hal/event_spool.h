@@ -0,0 +1,50 @@
+// event_spool.h
+// A door module's unacknowledged EVENT lines, oldest first, for door_udp's
+// reliable EVENT delivery.
+//
+// The oldest EVENT_SPOOL_RING lines sit in a ring in memory: that is the
+// window door_udp has on the wire and resends until the hub ACKs it. Lines
+// queued behind a full window go to a spill file (one "<seq> <line>" per
+// line) and move into the ring as ACKs free slots, so a hub that is away
+// for a while costs disk, not memory, and nothing is lost until the file
+// holds EVENT_SPOOL_MAX_SPILLED lines. The file is truncated on open and
+// whenever it has been read back completely. A record that can't be read
+// back comes out of the window with its seq and an empty line; the caller
+// sends a placeholder in its place.
+//
+// Not thread safe: door_udp calls it under its own lock.
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EVENT_SPOOL_RING        16      /* in memory, i.e. in flight */
+#define EVENT_SPOOL_LINE_MAX    256
+#define EVENT_SPOOL_MAX_SPILLED 10000
+
+typedef enum {
+    EVENT_SPOOL_QUEUED = 0,     // in the ring: send it now
+    EVENT_SPOOL_SPILLED,        // behind a full window, in the file
+    EVENT_SPOOL_FULL            // nowhere to put it
+} EventSpoolResult;
+
+typedef struct {
+    uint32_t seq;
+    char     line[EVENT_SPOOL_LINE_MAX];
+} EventSpoolEntry;
+
+// path NULL or "": memory only, so EVENT_SPOOL_FULL once the ring is.
+bool event_spool_open(const char *path);
+void event_spool_close(void);
+
+// Queue a line; seq must be one more than the one queued before.
+EventSpoolResult event_spool_push(uint32_t seq, const char *line);
+
+// Drop every line with a seq <= `seq` and refill the ring from the file.
+// Returns how many were dropped.
+int event_spool_ack(uint32_t seq);
+
+// Copy the ring, oldest first; returns the number of entries.
+int event_spool_window(EventSpoolEntry *out, int max);
+
+// Lines queued in total (ring + file).
+int event_spool_pending(void);
@@ -0,0 +1,48 @@
+// hub_local.h
+// Unix domain socket (SOCK_SEQPACKET) transport for processes running on
+// the hub itself. Speaks the same line protocol as the UDP ports, but each
+// packet is delivered reliably and in order, and a client that stops reading
+// is flow-controlled by the kernel instead of silently losing datagrams.
+//
+// Client -> hub (one line per packet):
+//   <MOD> COMMAND <CMDID> <TARGET> <ACTION>   forward to the module; the
+//                                             matching FEEDBACKs (ACCEPTED,
+//                                             then COMPLETED/FAILED) come
+//                                             back on this connection. The
+//                                             hub sends it on under a cmdid
+//                                             of its own and gives the
+//                                             FEEDBACK back the client's,
+//                                             so clients can't collide with
+//                                             each other or the hub
+//   SUBSCRIBE <TYPE>...                        TYPE: HELLO HEARTBEAT EVENT
+//                                             FEEDBACK or ALL
+//   UNSUBSCRIBE                               stop all subscriptions
+//
+// Hub -> client:
+//   raw module lines (same text as on UDP) for subscribed types
+//   <MOD> ERROR <CMDID> no_route              the module has no known address
+//
+// Backpressure: each client has a bounded send queue. While it is above the
+// high-water mark the hub stops reading that client's commands. When it is
+// full, HEARTBEAT/HELLO lines are dropped for that client; a client that
+// cannot keep up with EVENT/FEEDBACK lines is disconnected so it can
+// reconnect and resync rather than miss state changes silently.
+#pragma once
+#include <stdbool.h>
+
+#define HUB_LOCAL_DEFAULT_PATH "/tmp/door_hub.sock"
+
+// Start listening on `path` (NULL = HUB_LOCAL_DEFAULT_PATH). Returns true
+// on success.
+bool hub_local_init(const char *path);
+
+// Stop the listener thread, disconnect clients and remove the socket file.
+void hub_local_shutdown(void);
+
+// Deliver a raw line received from a module to interested local clients.
+// Called by the UDP listener; no-op if the local transport isn't running.
+void hub_local_publish(const char *raw);
+
+// Convenience for C clients: connect to the hub's local socket.
+// Returns the connected fd, or -1 on error.
+int hub_local_connect(const char *path);
@@ -0,0 +1,74 @@
+// hub_metrics.h
+// Lock-free counters and latency histograms for hub internals.
+//
+// Every thread that records a metric gets its own shard of atomic counters,
+// so the hot path (UDP ingest, command sender, Discord sender) only touches
+// its own cache line with relaxed atomics. hub_metrics_render() sums all
+// shards and emits Prometheus text format for the HTTP API's /metrics.
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Listening port a datagram arrived on
+typedef enum {
+    HUB_METRIC_PORT_NOTIF = 0,   // 12345: HELLO/EVENT/FEEDBACK/COMMAND
+    HUB_METRIC_PORT_HB,          // 12346: HEARTBEAT
+    HUB_METRIC_PORT_COUNT
+} HubMetricPort;
+
+// Message type token of a received datagram
+typedef enum {
+    HUB_METRIC_MSG_HELLO = 0,
+    HUB_METRIC_MSG_HEARTBEAT,
+    HUB_METRIC_MSG_EVENT,
+    HUB_METRIC_MSG_FEEDBACK,
+    HUB_METRIC_MSG_COMMAND,
+    HUB_METRIC_MSG_OTHER,
+    HUB_METRIC_MSG_COUNT
+} HubMetricMsgType;
+
+// Plain counters
+typedef enum {
+    HUB_CTR_PARSE_ERRORS = 0,
+    HUB_CTR_CMD_SENT,
+    HUB_CTR_CMD_RETRIES,
+    HUB_CTR_CMD_ACKED,
+    HUB_CTR_CMD_FAILED,
+    HUB_CTR_DISCORD_SENT,
+    HUB_CTR_DISCORD_FAILED,
+    HUB_CTR_DISCORD_RATE_LIMITED,
+    HUB_CTR_DISCORD_COALESCED,
+    HUB_CTR_HISTORY_WRITES,
+    HUB_CTR_HISTORY_OVERWRITES,
+    HUB_CTR_RATE_CONFIGS_SENT,
+    HUB_CTR_EVENT_DUPLICATES,
+    HUB_CTR_EVENT_GAPS,
+    HUB_CTR_EVENTS_LOST,
+    HUB_CTR_EVENT_ACKS_SENT,
+    HUB_CTR_MULTI_RECORD_DATAGRAMS,
+    HUB_CTR_COUNT
+} HubCounter;
+
+// Latency histograms (all values in microseconds)
+typedef enum {
+    HUB_HIST_INGEST_APPLY_US = 0,  // recvfrom() return -> handle_line() done
+    HUB_HIST_MUTEX_WAIT_US,        // time blocked acquiring g_mutex
+    HUB_HIST_MUTEX_HOLD_US,        // time g_mutex was held
+    HUB_HIST_CMD_RTT_US,           // hub_udp_send_command() first send -> COMPLETED
+    HUB_HIST_DISCORD_LATENCY_US,   // one webhook POST, start -> response
+    HUB_HIST_COUNT
+} HubHistogram;
+
+// Map a message type token ("HEARTBEAT", "EVENT", ...) to its enum value.
+HubMetricMsgType hub_metrics_msg_type(const char *type);
+
+void hub_metrics_count_datagram(HubMetricPort port, HubMetricMsgType type);
+void hub_metrics_inc(HubCounter ctr);
+void hub_metrics_add(HubCounter ctr, uint64_t n);
+void hub_metrics_observe(HubHistogram hist, long long value_us);
+
+// Render all metrics in Prometheus text exposition format into buf.
+// Returns the number of bytes the full output needs (like snprintf); the
+// output was truncated if the return value is >= cap.
+size_t hub_metrics_render(char *buf, size_t cap);
@@ -0,0 +1,107 @@
+// hub_shm.h
+// Fleet status table published by the hub in POSIX shared memory
+// (/dev/shm/door_hub_status), so any process on the hub can read module
+// state without a syscall per read and without touching the hub's mutex.
+//
+// Layout (all integers little-endian, native alignment, version 3):
+//
+//   HubShmHeader   64 bytes
+//     magic        u32  HUB_SHM_MAGIC
+//     version      u32  HUB_SHM_VERSION
+//     header_size  u32  sizeof(HubShmHeader)
+//     record_size  u32  sizeof(HubShmRecord)
+//     max_records  u32  HUB_MAX_DOORS
+//     num_records  u32  records [0, num_records) are valid (only grows)
+//     writer_pid   i32  pid of the hub process
+//   HubShmRecord[max_records], 64-byte aligned, record i == hub slot i
+//
+// Each record is guarded by its own sequence counter: the hub makes `seq`
+// odd, writes the record, then makes it even again. A reader copies the
+// record and retries if `seq` was odd or changed during the copy. The hub
+// is the only writer; readers never block it.
+#pragma once
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "hal/hub_udp.h"
+
+#define HUB_SHM_NAME    "/door_hub_status"
+#define HUB_SHM_MAGIC   0x54534844u   // "DHST"
+#define HUB_SHM_VERSION 3
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t seq;
+    uint8_t  known;
+    uint8_t  offline;
+    uint8_t  d0_open;
+    uint8_t  d0_locked;
+    uint8_t  d1_open;
+    uint8_t  d1_locked;
+    uint8_t  has_last_addr;
+    uint8_t  reserved0;
+    char     module_id[HUB_MODULE_ID_LEN];
+    int64_t  last_heartbeat_ms;
+    int64_t  last_event_ms;
+    int64_t  last_online_ms;
+    int64_t  last_feedback_ms;
+    int32_t  last_feedback_cmdid;
+    uint32_t last_addr_ip;      // network byte order
+    uint16_t last_addr_port;    // network byte order
+    uint16_t reserved1;
+    char     last_feedback_target[32];
+    char     last_feedback_action[32];
+    char     last_feedback_phase[16];
+    char     last_feedback_state[16];
+    int64_t  last_feedback_duration_ms;
+    int32_t  heartbeat_interval_ms;   // advertised HB=<ms>, 0 if none
+    int32_t  reserved2;
+    char     last_heartbeat_line[HUB_LINE_LEN];
+} HubShmRecord;
+
+typedef struct {
+    _Alignas(64) uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t max_records;
+    _Atomic uint32_t num_records;
+    int32_t  writer_pid;
+} HubShmHeader;
+
+// ---------- writer (hub only) ----------
+
+// Create (or recreate) the table. Returns true on success.
+bool hub_shm_create(void);
+
+// Publish hub slot `index`. Caller must serialise writers (the hub calls
+// this with its state mutex held).
+void hub_shm_publish(int index, const HubDoorStatus *st);
+
+// Unmap and unlink the table.
+void hub_shm_destroy(void);
+
+// ---------- reader (any process) ----------
+
+typedef struct {
+    const HubShmHeader *hdr;
+    const HubShmRecord *records;
+    size_t              map_len;
+} HubShmReader;
+
+// Map the table read-only. Returns false if the hub isn't running or the
+// layout doesn't match this build.
+bool hub_shm_open(HubShmReader *r);
+void hub_shm_close(HubShmReader *r);
+
+// A record that stays mid-write this long (the hub died while publishing
+// it) is treated as unavailable instead of being waited on forever.
+#define HUB_SHM_READ_TIMEOUT_MS 100
+
+// Consistent copy of one module's record. Returns true if found (and
+// readable).
+bool hub_shm_read(const HubShmReader *r, const char *module_id, HubDoorStatus *out);
+
+// Consistent copy of every known module (each record individually
+// consistent; unreadable ones are skipped). Returns the number written to
+// out[].
+int hub_shm_snapshot(const HubShmReader *r, HubDoorStatus *out, int max);
@@ -12,11 +12,12 @@
 #define HUB_MAX_HISTORY  256
 #define HUB_MODULE_ID_LEN 16
 #define HUB_LINE_LEN     256
+#define HUB_DGRAM_MAX    1500  // one datagram may carry several '\n'-terminated lines
 
 typedef struct {
     char module_id[HUB_MODULE_ID_LEN];   // e.g., "D1"
     bool known;
-    bool offline;  // true if heartbeat not received for > 10 seconds
+    bool offline;  // no heartbeat for 10 s, or 3 advertised intervals if longer
 
     bool d0_open;
     bool d0_locked;
@@ -24,6 +25,7 @@ typedef struct {
     bool d1_locked;
 
     long long last_heartbeat_ms;
+    int heartbeat_interval_ms;  // advertised HB=<ms>, 0 if the module doesn't
     long long last_event_ms;
     long long last_online_ms;  // timestamp when module went offline (or 0 if online)
 
@@ -36,6 +38,9 @@ typedef struct {
     char last_feedback_target[32];
     char last_feedback_action[32];
     int last_feedback_cmdid;
+    char last_feedback_phase[16];       // ACCEPTED, COMPLETED or FAILED
+    char last_feedback_state[16];       // door state reported with the outcome
+    long long last_feedback_duration_ms;
 } HubDoorStatus;
 
 typedef struct {
@@ -51,6 +56,14 @@ typedef struct {
 void hub_udp_set_webhook_url(const char *url);
 
 
+// Heartbeat backpressure: heartbeats may take up to this share of the
+// listener thread's time. The hub measures its ingest cost and sends each
+// module "<MOD> CONFIG RATE <PERIOD_MS> <JITTER_MS> <PHASE_MS>", the
+// slowest the fleet must beat to stay inside it, with a random phase per
+// module. 0 disables it (floors already sent are lifted).
+#define HUB_HB_DEFAULT_BUDGET_PCT 50
+void hub_udp_set_heartbeat_budget(int pct);
+
 // Start UDP listener thread on two ports. If listen_port2 == 0, only
 // listen on the first port. Returns true on success.
 bool hub_udp_init(uint16_t listen_port1, uint16_t listen_port2);
@@ -66,5 +79,58 @@ bool hub_udp_get_status(const char *module_id, HubDoorStatus *out);
 // Returns number of events copied (<= max_events).
 int hub_udp_get_history(HubEvent *out, int max_events);
 
-// Send a command to a known module (returns true on send success)
+// How long hub_udp_send_command_ex() waits for an ACCEPTED (per attempt)
+// and then for the module's COMPLETED/FAILED.
+#define HUB_CMD_ACK_TIMEOUT_MS      500
+#define HUB_CMD_ACK_RETRIES         2
+#define HUB_CMD_COMPLETE_TIMEOUT_MS 15000
+
+typedef enum {
+    HUB_CMD_COMPLETED = 0,  // module ran the command and reached the wanted state
+    HUB_CMD_FAILED,         // module ran (or refused) it; see state
+    HUB_CMD_NO_ACK,         // no ACCEPTED after all retries
+    HUB_CMD_TIMEOUT,        // accepted, but no outcome within the completion timeout
+    HUB_CMD_NO_ROUTE        // module unknown or no address for it yet
+} HubCmdOutcome;
+
+typedef struct {
+    HubCmdOutcome outcome;
+    int       cmdid;
+    char      state[16];      // door state the module reported ("" if none)
+    long long duration_ms;    // execution time reported by the module
+    long long accepted_ms;    // first send -> ACCEPTED (-1 if never accepted)
+    long long total_ms;       // first send -> outcome
+} HubCmdResult;
+
+// Send a command to a known module and wait for both feedback phases.
+// Returns true if the module reported COMPLETED; *out (may be NULL) gets
+// the details either way.
+bool hub_udp_send_command_ex(const char *module_id, const char *target, const char *action,
+                             HubCmdResult *out);
+
+// hub_udp_send_command_ex() without the details.
 bool hub_udp_send_command(const char *module_id, const char *target, const char *action);
+
+// "completed", "failed", "no_ack", "timeout" or "no_route".
+const char *hub_cmd_outcome_name(HubCmdOutcome outcome);
+
+// Forward a raw COMMAND line unchanged to a module's last-known address.
+// Used by local transports, which put a hub_udp_alloc_cmdid() id in it.
+// Returns false if the module has no known endpoint or the send failed.
+bool hub_udp_forward_raw(const char *module_id, const char *line);
+
+// Take the next cmdid from the counter hub_udp_send_command_ex() uses, so
+// FEEDBACK for it can't be mistaken for another hub-issued command's.
+int hub_udp_alloc_cmdid(void);
+
+// Version counter bumped whenever any module's door/lock/online state
+// changes (heartbeat timestamps alone don't count).
+uint64_t hub_udp_state_version(void);
+
+// Block until the state version differs from `seen`, `timeout_ms` passes
+// (-1 = no timeout) or hub_udp_wake_waiters() is called. Returns the
+// current version; equal to `seen` if nothing changed.
+uint64_t hub_udp_wait_state_change(uint64_t seen, int timeout_ms);
+
+// Wake every hub_udp_wait_state_change() caller (e.g. to let it exit).
+void hub_udp_wake_waiters(void);
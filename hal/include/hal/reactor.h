@@ -0,0 +1,55 @@
+// reactor.h
+// Event loop for the door module: one thread blocks in epoll_wait() and
+// dispatches readable sockets, periodic timers and cross-thread wakeups.
+//
+// Timers are timerfds on CLOCK_MONOTONIC with the kernel keeping the
+// deadlines, so a period never drifts by the time its callback takes.
+// reactor_post() and shutdown go through an eventfd, so the loop sleeps
+// until there is work and stops without waiting out a timeout.
+//
+// Callbacks run on the loop thread and must not block for long. Work that
+// does (motor moves, ultrasonic reads) keeps its own thread.
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#define REACTOR_MAX_SOURCES 16   /* fds + timers registered at once */
+#define REACTOR_POST_QUEUE  32   /* posted callbacks waiting for the loop */
+
+typedef void (*ReactorFdCallback)(int fd, uint32_t events, void *ctx);
+// expirations > 1 means the loop fell behind and periods were missed.
+typedef void (*ReactorTimerCallback)(uint64_t expirations, void *ctx);
+typedef void (*ReactorCallback)(void *ctx);
+
+// Reference counted: the first start spawns the loop thread, the matching
+// last stop wakes and joins it. Don't stop from a callback.
+bool reactor_start(void);
+void reactor_stop(void);
+
+// Watch fd for events (EPOLLIN, ...). The fd stays owned by the caller.
+// Returns a source id > 0, or -1 if the reactor isn't running or is full.
+int reactor_add_fd(int fd, uint32_t events, ReactorFdCallback cb, void *ctx);
+
+// Fire cb every period_ms, the first time one period from now. Period 0
+// adds the timer disarmed, for reactor_arm_timer_once().
+// Returns a source id > 0, or -1.
+int reactor_add_timer(int period_ms, ReactorTimerCallback cb, void *ctx);
+
+// Change a timer's period; the next expiry is one new period from now.
+bool reactor_set_timer_period(int id, int period_ms);
+
+// Fire a timer once, delay_ms from now, and then leave it disarmed until
+// it is armed again. delay_ms 0 disarms it.
+bool reactor_arm_timer_once(int id, int delay_ms);
+
+// Unregister a source. Off the loop thread this also waits for a running
+// callback of it to return, so its ctx can be freed afterwards.
+bool reactor_remove(int id);
+
+// Run cb(ctx) once on the loop thread. Returns false if the reactor isn't
+// running or the queue is full.
+bool reactor_post(ReactorCallback cb, void *ctx);
+
+// True when called from a reactor callback.
+bool reactor_in_loop(void);
@@ -0,0 +1,82 @@
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+// Simulated GPIO/PWM backend (cmake -DHAL_BACKEND=sim).
+//
+// The sim build replaces GPIO.c and PWM.c with an in-memory chip, so the
+// stepper, HC-SR04 and LED code run unchanged on a dev box. Inputs follow
+// scripted waveforms; outputs are recorded as timestamped edges that tests
+// and benchmarks can drain. All timestamps are CLOCK_MONOTONIC ns, the same
+// clock the kernel stamps GPIO edge events with.
+//
+// Out of the box the HC-SR04 echo line answers every trigger with a pulse
+// for HAL_SIM_DISTANCE_CM from the environment (default 100 cm), so
+// doorMod_cli sees an open door.
+
+#include <stdbool.h>
+#include "hal/PWM.h"
+
+#ifdef HAL_SIM
+
+#define SIM_GPIO_MAX_STEPS   32    /* scripted transitions pending per line */
+#define SIM_GPIO_EDGE_LOG    8192  /* recorded output edges kept */
+#define SIM_PWM_WRITE_LOG    1024  /* recorded PWM writes kept */
+
+// One step of an input waveform: after_us after the previous step (or
+// after the call, for the first), the line goes to value.
+typedef struct {
+    long long after_us;
+    int       value;
+} SimGpioStep;
+
+// An output line changing level.
+typedef struct {
+    int       chip;
+    int       line;
+    int       value;
+    long long timestamp_ns;
+} SimGpioEdge;
+
+// A value written to a PWM sysfs file (duty_cycle / period / enable).
+typedef struct {
+    const char *path;
+    long long   value;
+    long long   timestamp_ns;
+} SimPwmWrite;
+
+// Drop pending scripts, queued edge events, the logs and PWM state, and
+// re-arm the default HC-SR04 echo responder. Exported lines stay exported.
+void sim_hal_reset(void);
+
+// Queue a waveform on an input line, appended after anything still pending.
+// Returns false if the line's script is full.
+bool sim_gpio_script(int chip, int line, const SimGpioStep *steps, int num_steps);
+
+// Answer each falling edge on the trigger line with an echo pulse on the
+// echo line: high after delay_us, for pulse_us. pulse_us < 0: no echo.
+void sim_gpio_set_echo(int trig_chip, int trig_line, int echo_chip, int echo_line,
+                       long long delay_us, long long pulse_us);
+
+// Point the HC-SR04 responder at a distance (< 0: no echo, the sensor
+// times out).
+void sim_hc_sr04_set_distance(double distance_cm);
+
+// Move up to max recorded output edges, oldest first, into out. Returns
+// how many. *dropped (may be NULL) gets the number lost to log overflow.
+int sim_gpio_take_edges(SimGpioEdge *out, int max, long long *dropped);
+
+// Same for PWM writes.
+int sim_pwm_take_writes(SimPwmWrite *out, int max, long long *dropped);
+
+// Current PWM settings of an LED channel. Returns false if nothing has
+// been written to it yet.
+bool sim_pwm_state(LEDt led, long long *period_ns, long long *duty_ns, bool *enabled);
+
+// Backend hooks: PWM.c sends its sysfs writes here instead of to the
+// file; sim_hal_reset() clears the PWM side through sim_pwm_reset().
+bool sim_pwm_write(const char *path, const char *value);
+void sim_pwm_reset(void);
+
+#endif // HAL_SIM
+
+#endif // HAL_SIM_H
@@ -1,20 +1,66 @@
 // hub_webhook.h
 // Thin asynchronous wrapper around hal DiscordAlert functions.
+//
+// Messages wait in a fixed pool of preallocated slots (no allocation per
+// message) and are handed to the Discord client highest priority first;
+// security and connectivity messages go to it as urgent alerts, so they
+// overtake routine alerts there as well. When the pool is full the
+// oldest message of the lowest queued class below the new one is evicted;
+// if nothing lower is queued the new message is dropped. An identical
+// message (same URL, no event id) already waiting in the same class is
+// collapsed into it ("... (x3)") instead of taking another slot.
 
 #ifndef HUB_WEBHOOK_H
 #define HUB_WEBHOOK_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
-// Initialize webhook worker. Pass NULL to skip initialization.
-// Returns true on success.
+#define HUB_WEBHOOK_CAPACITY 32    // queued message slots
+#define HUB_WEBHOOK_MSG_LEN  256   // longer messages are truncated
+#define HUB_WEBHOOK_URL_LEN  512
+#define HUB_WEBHOOK_EVENT_ID_LEN 64
+
+typedef enum {
+    HUB_WEBHOOK_PRIO_SECURITY = 0,   // door/lock state changes
+    HUB_WEBHOOK_PRIO_CONNECTIVITY,   // module online/offline
+    HUB_WEBHOOK_PRIO_INFO,           // operator chatter, status replies
+    HUB_WEBHOOK_PRIO_COUNT
+} HubWebhookPriority;
+
+typedef struct {
+    uint32_t depth[HUB_WEBHOOK_PRIO_COUNT];    // currently queued per class
+    uint32_t max_depth;                        // high-water mark, all classes
+    uint64_t enqueued;
+    uint64_t sent;
+    uint64_t collapsed;                        // merged into a queued duplicate
+    uint64_t evicted[HUB_WEBHOOK_PRIO_COUNT];  // dropped to make room
+    uint64_t rejected[HUB_WEBHOOK_PRIO_COUNT]; // dropped on arrival (queue full)
+} HubWebhookStats;
+
+// Initialize webhook worker. `webhook_url` is where hub_webhook_send() and
+// hub_webhook_send_prio() messages go; NULL drops those, while
+// hub_webhook_post() with its own URL still works. Returns true on success.
 bool hub_webhook_init(const char *webhook_url);
 
 // Shutdown worker and cleanup resources.
 void hub_webhook_shutdown(void);
 
-// Enqueue a message to be sent to the webhook (non-blocking).
+// Enqueue an informational message to be sent to the webhook (non-blocking).
 // The message will be copied; caller may free the buffer after return.
 void hub_webhook_send(const char *msg);
 
+// Enqueue with an explicit priority. Returns false if the message was
+// dropped (worker not running, or queue full of equal/higher priority).
+bool hub_webhook_send_prio(HubWebhookPriority prio, const char *msg);
+
+// Enqueue for an explicit URL (NULL: the default one). A message with an
+// event id is never collapsed, and the Discord outbox delivers that id only
+// once. Same return value as hub_webhook_send_prio().
+bool hub_webhook_post(HubWebhookPriority prio, const char *url, const char *event_id,
+                      const char *msg);
+
+// Snapshot of queue counters.
+void hub_webhook_get_stats(HubWebhookStats *out);
+
 #endif // HUB_WEBHOOK_H
@@ -9,5 +9,7 @@
 __attribute__((weak)) bool discordStart(void) { return true; }
 __attribute__((weak)) void discordCleanup(void) { }
 __attribute__((weak)) void sendDiscordAlert(const char *webhook_url, const char *msg) { (void)webhook_url; (void)msg; }
+__attribute__((weak)) void sendDiscordAlertEvent(const char *webhook_url, const char *event_id, const char *msg) { (void)webhook_url; (void)event_id; (void)msg; }
+__attribute__((weak)) void sendDiscordAlertUrgent(const char *webhook_url, const char *event_id, const char *msg) { (void)webhook_url; (void)event_id; (void)msg; }
 __attribute__((weak)) bool startDoorAlertMonitor(char *(*provider)(void *), void *ctx, const char *webhook_url) { (void)provider; (void)ctx; (void)webhook_url; return false; }
 __attribute__((weak)) void stopDoorAlertMonitor(void) { }
\ No newline at end of file
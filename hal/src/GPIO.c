@@ -4,6 +4,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <poll.h>
+#include <errno.h>
 #include <linux/gpio.h>
 #include "hal/GPIO.h"
 
@@ -31,55 +33,67 @@ static struct {
     int line_fd;
     bool is_output;
     bool in_use;
-} gpio_fds[MAX_CHIPS][MAX_LINES_PER_CHIP] = {{{-1, false, false}}};
+    bool edges;
+} gpio_fds[MAX_CHIPS][MAX_LINES_PER_CHIP] = {{{-1, false, false, false}}};
 
-static bool gpio_line_init(int chip, int line, bool is_output) {
+/* Request lines of a chip as one handle. Returns the line fd or -1. */
+static int gpio_request_lines(int chip, const int *lines, int num_lines,
+                              bool is_output, bool edges) {
     char chip_path[32];
     snprintf(chip_path, sizeof(chip_path), "/dev/gpiochip%d", chip);
     
-    DEBUG_PRINT("Initializing GPIO: chip %d, line %d, %s\n", 
-           chip, line, is_output ? "output" : "input");
+    DEBUG_PRINT("Initializing GPIO: chip %d, line %d (%d lines), %s\n", 
+           chip, lines[0], num_lines, is_output ? "output" : "input");
     
     int chip_fd = open(chip_path, O_RDWR);
     if (chip_fd < 0) {
         DEBUG_PRINT("Failed to open %s: ", chip_path);
         perror(NULL);
-        return false;
+        return -1;
     }
 
     struct gpio_v2_line_request req;
     memset(&req, 0, sizeof(req));
-    req.offsets[0] = line;
-    req.num_lines = 1;
+    for (int i = 0; i < num_lines; i++) {
+        req.offsets[i] = lines[i];
+    }
+    req.num_lines = num_lines;
     req.config.flags = is_output ? GPIO_V2_LINE_FLAG_OUTPUT : GPIO_V2_LINE_FLAG_INPUT;
 
     /* For input pins, use pull-down instead of pull-up for HC-SR04 */
     if (!is_output) {
         req.config.flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN;
     }
+    /* Kernel-timestamped edge events (monotonic clock by default) */
+    if (edges) {
+        req.config.flags |= GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+        req.event_buffer_size = 16;
+    }
 
-    /* Try to get line info first to verify it exists */
-    struct gpio_v2_line_info linfo;
-    memset(&linfo, 0, sizeof(linfo));
-    linfo.offset = line;
-    
-    if (ioctl(chip_fd, GPIO_V2_GET_LINEINFO_IOCTL, &linfo) < 0) {
-        DEBUG_PRINT("Failed to get info for line %d: ", line);
-        perror(NULL);
-        close(chip_fd);
-        return false;
+    /* Try to get line info first to verify the lines exist */
+    for (int i = 0; i < num_lines; i++) {
+        struct gpio_v2_line_info linfo;
+        memset(&linfo, 0, sizeof(linfo));
+        linfo.offset = lines[i];
+
+        if (ioctl(chip_fd, GPIO_V2_GET_LINEINFO_IOCTL, &linfo) < 0) {
+            DEBUG_PRINT("Failed to get info for line %d: ", lines[i]);
+            perror(NULL);
+            close(chip_fd);
+            return -1;
+        }
+
+        DEBUG_PRINT("Found GPIO line: chip %d, line %d, name: '%s'\n", 
+               chip, lines[i], linfo.name);
     }
-    
-    DEBUG_PRINT("Found GPIO line: chip %d, line %d, name: '%s'\n", 
-           chip, line, linfo.name);
 
-    /* Request the GPIO line - ioctl fills in req.fd field */
+    /* Request the GPIO lines - ioctl fills in req.fd field */
     DEBUG_PRINT("Requesting GPIO line...\n");
     if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
         DEBUG_PRINT("Failed to get line handle: ");
         perror(NULL);
         close(chip_fd);
-        return false;
+        return -1;
     }
     
     /* Close the chip fd, we only need the line fd now */
@@ -88,22 +102,33 @@ static bool gpio_line_init(int chip, int line, bool is_output) {
     /* Check if we got a valid fd */
     if (req.fd < 0) {
         DEBUG_PRINT("Invalid line fd received: %d\n", req.fd);
-        return false;
+        return -1;
     }
     
     DEBUG_PRINT("GPIO line request successful, fd = %d\n", req.fd);
+    return req.fd;
+}
 
-    /* Store the line file descriptor */
-    if (chip < MAX_CHIPS && line < MAX_LINES_PER_CHIP) {
-        /* Close existing if any */
-        if (gpio_fds[chip][line].line_fd >= 0) {
-            close(gpio_fds[chip][line].line_fd);
-        }
-        gpio_fds[chip][line].line_fd = req.fd;
-        gpio_fds[chip][line].is_output = is_output;
-        gpio_fds[chip][line].in_use = true;
-        DEBUG_PRINT("Stored GPIO fd for chip %d, line %d\n", chip, line);
+static bool gpio_line_init(int chip, int line, bool is_output, bool edges) {
+    /* Release our own handle first so a re-init doesn't find the line busy.
+     * Only entry [0][0] of the table starts with fd -1, so go by in_use. */
+    if (gpio_fds[chip][line].in_use && gpio_fds[chip][line].line_fd >= 0) {
+        close(gpio_fds[chip][line].line_fd);
+        gpio_fds[chip][line].line_fd = -1;
+        gpio_fds[chip][line].in_use = false;
+    }
+
+    int fd = gpio_request_lines(chip, &line, 1, is_output, edges);
+    if (fd < 0) {
+        return false;
     }
+
+    /* Store the line file descriptor */
+    gpio_fds[chip][line].line_fd = fd;
+    gpio_fds[chip][line].is_output = is_output;
+    gpio_fds[chip][line].in_use = true;
+    gpio_fds[chip][line].edges = edges;
+    DEBUG_PRINT("Stored GPIO fd for chip %d, line %d\n", chip, line);
     
     return true;
 }
@@ -111,14 +136,20 @@ static bool gpio_line_init(int chip, int line, bool is_output) {
 bool export_pin(int chip, int line, const char* direction) {
     if (!direction || chip < 0 || chip >= MAX_CHIPS || 
         line < 0 || line >= MAX_LINES_PER_CHIP) return false;
-    return gpio_line_init(chip, line, strcmp(direction, "out") == 0);
+    return gpio_line_init(chip, line, strcmp(direction, "out") == 0, false);
+}
+
+bool export_pin_edges(int chip, int line) {
+    if (chip < 0 || chip >= MAX_CHIPS ||
+        line < 0 || line >= MAX_LINES_PER_CHIP) return false;
+    return gpio_line_init(chip, line, false, true);
 }
 
 bool set_pin_direction(int chip, int line, const char* direction) {
     if (!direction || chip < 0 || chip >= MAX_CHIPS || 
         line < 0 || line >= MAX_LINES_PER_CHIP) return false;
     /* Must re-initialize with new direction */
-    return gpio_line_init(chip, line, strcmp(direction, "out") == 0);
+    return gpio_line_init(chip, line, strcmp(direction, "out") == 0, false);
 }
 
 bool write_pin_value(int chip, int line, int value) {
@@ -176,7 +207,112 @@ int read_pin_value(int chip, int line) {
     return (data.bits & 1ULL) ? 1 : 0;
 }
 
+static int edge_fd(int chip, int line) {
+    if (chip < 0 || chip >= MAX_CHIPS ||
+        line < 0 || line >= MAX_LINES_PER_CHIP) return -1;
+    if (!gpio_fds[chip][line].in_use || !gpio_fds[chip][line].edges) return -1;
+    return gpio_fds[chip][line].line_fd;
+}
 
+int wait_pin_edge(int chip, int line, int timeout_ms, GpioEdgeEvent *ev) {
+    int fd = edge_fd(chip, line);
+    if (fd < 0 || !ev) return -1;
 
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int rc;
+    do {
+        rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    if (rc < 0) {
+        perror("wait_pin_edge: poll");
+        return -1;
+    }
+    if (rc == 0) return 0;
 
+    struct gpio_v2_line_event event;
+    ssize_t n = read(fd, &event, sizeof(event));
+    if (n != (ssize_t)sizeof(event)) {
+        DEBUG_PRINT("wait_pin_edge: short read (%zd) on chip %d, line %d\n", n, chip, line);
+        return -1;
+    }
+    ev->rising = (event.id == GPIO_V2_LINE_EVENT_RISING_EDGE);
+    ev->timestamp_ns = event.timestamp_ns;
+    return 1;
+}
+
+void flush_pin_edges(int chip, int line) {
+    int fd = edge_fd(chip, line);
+    if (fd < 0) return;
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    struct gpio_v2_line_event event;
+    while (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) {
+        if (read(fd, &event, sizeof(event)) != (ssize_t)sizeof(event)) break;
+    }
+}
+
+bool export_pin_group(GpioPinGroup *group, int chip, const int *lines, int num_lines,
+                      const char* direction) {
+    if (!group || !lines || !direction || chip < 0 || chip >= MAX_CHIPS ||
+        num_lines < 1 || num_lines > GPIO_GROUP_MAX_LINES) return false;
+    for (int i = 0; i < num_lines; i++) {
+        if (lines[i] < 0 || lines[i] >= MAX_LINES_PER_CHIP) return false;
+    }
+
+    release_pin_group(group);
+    bool is_output = strcmp(direction, "out") == 0;
+    int fd = gpio_request_lines(chip, lines, num_lines, is_output, false);
+    if (fd < 0) {
+        return false;
+    }
+    group->chip = chip;
+    group->num_lines = num_lines;
+    memcpy(group->lines, lines, (size_t)num_lines * sizeof(lines[0]));
+    group->line_fd = fd;
+    group->is_output = is_output;
+    return true;
+}
+
+void release_pin_group(GpioPinGroup *group) {
+    if (!group) return;
+    /* A zeroed struct has fd 0, which is never ours while num_lines is 0 */
+    if (group->num_lines > 0 && group->line_fd >= 0) {
+        close(group->line_fd);
+    }
+    group->line_fd = -1;
+    group->num_lines = 0;
+}
+
+bool write_pin_group(const GpioPinGroup *group, unsigned int mask, unsigned int values) {
+    if (!group || group->num_lines < 1 || group->line_fd < 0 || !group->is_output) return false;
 
+    struct gpio_v2_line_values data;
+    data.mask = mask & ((1u << group->num_lines) - 1);
+    data.bits = values & data.mask;
+    if (data.mask == 0) return true;
+
+    if (ioctl(group->line_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &data) < 0) {
+        DEBUG_PRINT("Failed to set values for chip %d group (line %d...): ",
+                    group->chip, group->lines[0]);
+        perror(NULL);
+        return false;
+    }
+    return true;
+}
+
+int read_pin_group(const GpioPinGroup *group, unsigned int mask) {
+    if (!group || group->num_lines < 1 || group->line_fd < 0) return -1;
+
+    struct gpio_v2_line_values data;
+    data.mask = mask & ((1u << group->num_lines) - 1);
+    data.bits = 0;
+    if (data.mask == 0) return 0;
+
+    if (ioctl(group->line_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &data) < 0) {
+        DEBUG_PRINT("Failed to read values from chip %d group (line %d...): ",
+                    group->chip, group->lines[0]);
+        perror(NULL);
+        return -1;
+    }
+    return (int)(data.bits & data.mask);
+}
@@ -3,10 +3,13 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <pthread.h>
+#include <errno.h>
 
 #include "hal/HC-SR04.h"
 #include "hal/GPIO.h"
 #include "hal/timing.h"
+#include "hal/door_state.h"
 
 /* Debug output control - set to 0 to disable debug printfs */
 //#define HC_SR04_DEBUG 1
@@ -24,6 +27,9 @@
     #define DEBUG_VERBOSE(...) do {} while(0)
 #endif
 
+/* Echo timed from kernel edge timestamps; false: poll the line instead */
+static bool echo_edges = false;
+
 bool init_hc_sr04(){
     DEBUG_PRINT("Initializing HC-SR04 sensor:\n");
     DEBUG_PRINT("Trigger pin: chip %d, line %d\n", TRIG_GPIOCHIP, TRIG_GPIO_LINE);
@@ -37,9 +43,13 @@ bool init_hc_sr04(){
         return false;
     }
     
-    /* Initialize echo pin as input */
+    /* Initialize echo pin as input, with edge events if the driver has them */
     DEBUG_PRINT("Setting up echo pin...\n");
-    if(!export_pin(ECHO_GPIOCHIP, ECHO_GPIO_LINE, "in")) {
+    echo_edges = export_pin_edges(ECHO_GPIOCHIP, ECHO_GPIO_LINE);
+    if(!echo_edges) {
+        fprintf(stderr, "HC-SR04: echo edge events unavailable, falling back to polling\n");
+    }
+    if(!echo_edges && !export_pin(ECHO_GPIOCHIP, ECHO_GPIO_LINE, "in")) {
         DEBUG_PRINT("Failed to initialize echo pin (chip %d, line %d)\n",
                ECHO_GPIOCHIP, ECHO_GPIO_LINE);
         return false;
@@ -57,26 +67,35 @@ bool init_hc_sr04(){
 }
 
 
-long long get_distance(){
-    /* Trigger pulse sequence */
-    if(!write_pin_value(TRIG_GPIOCHIP, TRIG_GPIO_LINE, 0)) {
-        perror("Failed to set trigger low");
-        return -1;
-    }
-    sleepForUs(2); /* At least 2us */
+/* Echo pulse width from the kernel's edge timestamps. Sleeps in poll()
+ * until each edge arrives. Returns -1 on timeout/error. */
+static long long echo_pulse_edges(long long timeout_us){
+    long long deadline = getTimeInUs() + 2 * timeout_us;
+    unsigned long long rise_ns = 0;
+    bool have_rise = false;
 
-    if(!write_pin_value(TRIG_GPIOCHIP, TRIG_GPIO_LINE, 1)) {
-        perror("Failed to set trigger high");
-        return -1;
-    }
-    sleepForUs(10); /* At least 10us */
-
-    if(!write_pin_value(TRIG_GPIOCHIP, TRIG_GPIO_LINE, 0)) {
-        perror("Failed to set trigger low");
-        return -1;
+    while(true) {
+        long long left_us = deadline - getTimeInUs();
+        if(left_us <= 0) {
+            DEBUG_PRINT("Timeout waiting for echo %s edge\n", have_rise ? "falling" : "rising");
+            return -1;
+        }
+        GpioEdgeEvent ev;
+        int rc = wait_pin_edge(ECHO_GPIOCHIP, ECHO_GPIO_LINE, (int)((left_us + 999) / 1000), &ev);
+        if(rc < 0) return -1;
+        if(rc == 0) continue;   /* loop re-checks the deadline */
+        if(ev.rising) {
+            rise_ns = ev.timestamp_ns;   /* a later rise restarts the pulse */
+            have_rise = true;
+        } else if(have_rise) {
+            return (long long)((ev.timestamp_ns - rise_ns) / 1000ULL);
+        }
     }
+}
 
-    const long long timeout_us = 60000; /* 60 ms timeout */
+/* Echo pulse width by polling the line value every 50 us. Returns -1 on
+ * timeout/error. */
+static long long echo_pulse_polled(long long timeout_us){
     long long wait_start = getTimeInUs();
 
     /* Wait for rising edge */
@@ -126,8 +145,39 @@ long long get_distance(){
         sleepForUs(50); /* Poll every 50us */
     }
 
-    long long t_end = getTimeInUs();
-    long long pulse_us = t_end - t_start;
+    return getTimeInUs() - t_start;
+}
+
+long long get_distance(){
+    /* Edges left over from a previous (timed out) measurement */
+    if(echo_edges) {
+        flush_pin_edges(ECHO_GPIOCHIP, ECHO_GPIO_LINE);
+    }
+
+    /* Trigger pulse sequence */
+    if(!write_pin_value(TRIG_GPIOCHIP, TRIG_GPIO_LINE, 0)) {
+        perror("Failed to set trigger low");
+        return -1;
+    }
+    sleepForUs(2); /* At least 2us */
+
+    if(!write_pin_value(TRIG_GPIOCHIP, TRIG_GPIO_LINE, 1)) {
+        perror("Failed to set trigger high");
+        return -1;
+    }
+    sleepForUs(10); /* At least 10us */
+
+    if(!write_pin_value(TRIG_GPIOCHIP, TRIG_GPIO_LINE, 0)) {
+        perror("Failed to set trigger low");
+        return -1;
+    }
+
+    const long long timeout_us = 60000; /* 60 ms timeout */
+    long long pulse_us = echo_edges ? echo_pulse_edges(timeout_us)
+                                    : echo_pulse_polled(timeout_us);
+    if (pulse_us < 0) {
+        return -1;
+    }
 
     /* Validate pulse width (typical range ~150us to ~30ms) */
     if (pulse_us < 100 || pulse_us > 60000) {
@@ -137,4 +187,135 @@ long long get_distance(){
 
     /* distance_cm = pulse_us * 0.01716 */
     return (long long)(pulse_us * 0.01716);
-}
\ No newline at end of file
+}
+
+/* ---------- sampler thread ---------- */
+
+static pthread_t       sampler_thread;
+static bool            sampler_running = false;
+static int             sampler_period_ms = HC_SR04_DEFAULT_PERIOD_MS;
+static pthread_mutex_t sampler_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sampler_cond;
+static HcSr04Reading   sampler_latest;   /* seq 0: nothing published yet */
+static DistanceFilter  sampler_filter;   /* sampler thread only */
+
+static void publish_reading(const DistanceFilter *f, long long timestamp_ms)
+{
+    double v = distance_filter_value(f);
+    pthread_mutex_lock(&sampler_lock);
+    sampler_latest.distance_cm = v < 0 ? -1 : (long long)(v + 0.5);
+    sampler_latest.state = distance_filter_class(f);
+    sampler_latest.confidence = distance_filter_confidence(f);
+    sampler_latest.timestamp_ms = timestamp_ms;
+    sampler_latest.seq++;
+    // Before the broadcast, so woken waiters find it in door_state too
+    door_state_publish_sensor(&sampler_latest);
+    pthread_cond_broadcast(&sampler_cond);
+    pthread_mutex_unlock(&sampler_lock);
+}
+
+static void *sampler_worker(void *arg){
+    (void)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (true) {
+        pthread_mutex_lock(&sampler_lock);
+        bool running = sampler_running;
+        int period_ms = sampler_period_ms;
+        pthread_mutex_unlock(&sampler_lock);
+        if (!running) break;
+
+        long long d = get_distance();
+        long long taken_ms = getTimeInMs();
+        distance_filter_update(&sampler_filter, (double)d);
+        publish_reading(&sampler_filter, taken_ms);
+
+        /* Fixed-rate schedule; skip ahead if a measurement overran */
+        next.tv_nsec += (long)period_ms * 1000000L;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+            next = now;
+        } else {
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {}
+        }
+    }
+    return NULL;
+}
+
+bool hc_sr04_sampler_start(int period_ms, const DistanceFilterConfig *filter){
+    pthread_mutex_lock(&sampler_lock);
+    if (sampler_running) {
+        pthread_mutex_unlock(&sampler_lock);
+        return true;
+    }
+    static bool cond_ready = false;
+    if (!cond_ready) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&sampler_cond, &attr);
+        pthread_condattr_destroy(&attr);
+        cond_ready = true;
+    }
+    sampler_period_ms = period_ms > 0 ? period_ms : HC_SR04_DEFAULT_PERIOD_MS;
+    memset(&sampler_latest, 0, sizeof(sampler_latest));
+    distance_filter_init(&sampler_filter, filter);
+    sampler_running = true;
+    if (pthread_create(&sampler_thread, NULL, sampler_worker, NULL) != 0) {
+        perror("HC-SR04 sampler pthread_create");
+        sampler_running = false;
+        pthread_mutex_unlock(&sampler_lock);
+        return false;
+    }
+    pthread_mutex_unlock(&sampler_lock);
+    return true;
+}
+
+void hc_sr04_sampler_stop(void){
+    pthread_mutex_lock(&sampler_lock);
+    if (!sampler_running) {
+        pthread_mutex_unlock(&sampler_lock);
+        return;
+    }
+    sampler_running = false;
+    pthread_cond_broadcast(&sampler_cond);   /* release waiters */
+    pthread_mutex_unlock(&sampler_lock);
+    pthread_join(sampler_thread, NULL);
+}
+
+bool hc_sr04_latest(HcSr04Reading *out){
+    if (!out) return false;
+    pthread_mutex_lock(&sampler_lock);
+    *out = sampler_latest;
+    pthread_mutex_unlock(&sampler_lock);
+    return out->seq != 0;
+}
+
+bool hc_sr04_wait_newer(long long after_ms, int timeout_ms, HcSr04Reading *out){
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_nsec -= 1000000000L;
+        deadline.tv_sec++;
+    }
+
+    pthread_mutex_lock(&sampler_lock);
+    bool fresh;
+    while (!(fresh = sampler_latest.seq != 0 && sampler_latest.timestamp_ms > after_ms) &&
+           sampler_running) {
+        if (pthread_cond_timedwait(&sampler_cond, &sampler_lock, &deadline) == ETIMEDOUT) {
+            fresh = sampler_latest.seq != 0 && sampler_latest.timestamp_ms > after_ms;
+            break;
+        }
+    }
+    if (out) *out = sampler_latest;
+    pthread_mutex_unlock(&sampler_lock);
+    return fresh;
+}
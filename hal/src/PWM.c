@@ -4,6 +4,7 @@
 #include <time.h>
 #include "hal/timing.h"
 #include "hal/PWM.h"
+#include "hal/sim.h"
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
@@ -31,6 +32,10 @@ const LEDt GREEN_LED = {
 
 // Helper function to write to a file
 bool PWM_export(void){
+#ifdef HAL_SIM
+    // Simulated channels need no export
+    return true;
+#endif
     // Ensure both GPIO15 and GPIO12 PWM sysfs entries exist. Try exporting any
     // pin whose enable file is not present yet.
     const char *pins[] = { "GPIO13", "GPIO12" };
@@ -73,6 +78,9 @@ bool PWM_export(void){
     return all_ok;
 }
 static bool writeToFile(const char* filename, const char* value) {
+#ifdef HAL_SIM
+    return sim_pwm_write(filename, value);
+#endif
     FILE* file = fopen(filename, "w");
     if (file == NULL) {
         fprintf(stderr, "Error opening file '%s': ", filename);
@@ -143,6 +151,8 @@ bool PWM_setFrequency(LEDt led, int Hz, int dutyCyclePercent)
     
     // disable
     if (!PWM_disable(led)) return false;
+    // duty=0 first: the driver rejects a period shorter than the current duty
+    if (!PWM_setDutyCycle(led, 0)) return false;
 
     // cast to int because helpers take int
     if (!PWM_setPeriod(led, (int)period_ull)) return false;
@@ -1,104 +1,438 @@
 #include "hal/StepperMotor.h"
+#include "hal/door_state.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
 
 // #define DEBUG_STEP_MOTOR
 
 // Global position tracking stored in motor steps (0 .. STEPS_PER_REV-1).
 // Storing steps avoids repeated integer-division rounding when converting
-// between steps and degrees.
+// between steps and degrees. Written by the motion thread only, read under
+// motion_lock; every change is also published to door_state.
 static int current_step_position = 0;
 
+// Motion engine: one thread owns the pins and runs queued moves in order.
+typedef struct {
+    int                 id;
+    int                 target_step;
+    StepperMoveCallback cb;
+    void               *ctx;
+} StepperMove;
+
+static pthread_t       motion_thread;
+static bool            motion_running = false;
+static pthread_mutex_t motion_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  motion_cond;        /* queue changed / move ended */
+static StepperMove     motion_queue[STEPPER_MAX_QUEUED_MOVES];
+static int             queue_head = 0, queue_len = 0;
+static int             active_move_id = 0; /* 0: idle */
+static bool            cancel_active = false;
+static int             next_move_id = 1;
+static StepperProfile  motion_profile = {
+    STEPPER_DEFAULT_START_RATE, STEPPER_DEFAULT_MAX_RATE, STEPPER_DEFAULT_ACCEL
+};
+
+// The coils as two line groups, one per chip: IN1/IN2 on chip 1 and
+// IN3/IN4 on chip 2, so a step is two ioctls. Adjacent half-steps differ
+// in a single coil, so no invalid combination shows between the writes.
+static GpioPinGroup coils_a = { .line_fd = -1 };  /* bit 0 = IN1, bit 1 = IN2 */
+static GpioPinGroup coils_b = { .line_fd = -1 };  /* bit 0 = IN3, bit 1 = IN4 */
+
 // Function to set a single step pattern
 static bool set_motor_pins(const int* pattern) {
-    if (!write_pin_value(IN1_GPIOCHIP, IN1_GPIO_LINE, pattern[0])) return false;
-    if (!write_pin_value(IN2_GPIOCHIP, IN2_GPIO_LINE, pattern[1])) return false;
-    if (!write_pin_value(IN3_GPIOCHIP, IN3_GPIO_LINE, pattern[2])) return false;
-    if (!write_pin_value(IN4_GPIOCHIP, IN4_GPIO_LINE, pattern[3])) return false;
-    return true;
+    unsigned int a = (pattern[0] ? 1u : 0u) | (pattern[1] ? 2u : 0u);
+    unsigned int b = (pattern[2] ? 1u : 0u) | (pattern[3] ? 2u : 0u);
+    return write_pin_group(&coils_a, 3u, a) && write_pin_group(&coils_b, 3u, b);
+}
+
+static int steps_to_degrees(int steps) {
+    return (int)((steps * 360L) / STEPS_PER_REV);
+}
+
+// Signed step count from `from` to `to` along the shorter way round. Exactly
+// half a turn goes in the direction of plain subtraction, so 0 -> 180 turns
+// forward and 180 -> 0 turns back.
+static int shortest_delta(int from, int to) {
+    int fwd = (to - from + STEPS_PER_REV) % STEPS_PER_REV;
+    if (fwd < STEPS_PER_REV / 2) return fwd;
+    if (fwd > STEPS_PER_REV / 2) return fwd - STEPS_PER_REV;
+    return to > from ? fwd : -fwd;
+}
+
+// Speed for step i of a move that stops after step stop_at - 1: the lowest
+// of the acceleration ramp, the cruise speed and the deceleration ramp.
+static double step_rate(const StepperProfile *p, int i, int stop_at) {
+    double v0 = p->start_steps_per_s;
+    double a2 = 2.0 * p->accel_steps_per_s2;
+    double up = sqrt(v0 * v0 + a2 * i);
+    double down = sqrt(v0 * v0 + a2 * (stop_at - 1 - i));
+    double v = up < down ? up : down;
+    return v < p->max_steps_per_s ? v : p->max_steps_per_s;
+}
+
+static void timespec_add_ns(struct timespec *ts, long long ns) {
+    ts->tv_sec += ns / 1000000000LL;
+    ts->tv_nsec += ns % 1000000000LL;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static StepperMoveResult run_move(const StepperMove *m) {
+    pthread_mutex_lock(&motion_lock);
+    int pos = current_step_position;
+    StepperProfile p = motion_profile;
+    pthread_mutex_unlock(&motion_lock);
+    door_state_publish_motor(steps_to_degrees(pos), true);
+
+    int delta = shortest_delta(pos, m->target_step);
+    int dir = delta < 0 ? -1 : 1;
+    int stop_at = abs(delta);
+    bool cancelled = false;
+
+#ifdef DEBUG_STEP_MOTOR
+    printf("Move %d: %d -> %d degrees, %d steps\n", m->id,
+           steps_to_degrees(pos), steps_to_degrees(m->target_step), delta);
+#endif
+
+    // Each step has an absolute deadline, so time spent writing the pins
+    // doesn't stretch the profile.
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (int i = 0; i < stop_at; i++) {
+        if (!cancelled) {
+            pthread_mutex_lock(&motion_lock);
+            cancelled = cancel_active;
+            pthread_mutex_unlock(&motion_lock);
+            if (cancelled) {
+                // Ramp down from the current speed instead of stopping dead
+                double v = i > 0 ? step_rate(&p, i - 1, stop_at) : p.start_steps_per_s;
+                double v0 = p.start_steps_per_s;
+                int decel = (int)ceil((v * v - v0 * v0) / (2.0 * p.accel_steps_per_s2));
+                if (i + decel < stop_at) stop_at = i + decel;
+                if (i >= stop_at) break;
+            }
+        }
+
+        int new_pos = (pos + dir + STEPS_PER_REV) % STEPS_PER_REV;
+        // The coil pattern follows the absolute position, so moves in
+        // either direction pick up where the last one left the rotor.
+        if (!set_motor_pins(halfstep_sequence[new_pos % 8])) {
+            printf("Failed to set motor pins at step %d\n", i);
+            return STEPPER_MOVE_FAILED;
+        }
+        pos = new_pos;
+        pthread_mutex_lock(&motion_lock);
+        current_step_position = pos;
+        pthread_mutex_unlock(&motion_lock);
+        door_state_publish_motor(steps_to_degrees(pos), true);
+
+        long long interval_ns = (long long)(1e9 / step_rate(&p, i, stop_at));
+        timespec_add_ns(&next, interval_ns);
+
+        // After a stall (e.g. preempted), restart the schedule from now
+        // rather than firing a burst of late steps the rotor can't follow.
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long late_ns = (now.tv_sec - next.tv_sec) * 1000000000LL + (now.tv_nsec - next.tv_nsec);
+        if (late_ns > interval_ns) {
+            next = now;
+            timespec_add_ns(&next, interval_ns);
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {}
+    }
+
+    if (cancelled) return STEPPER_MOVE_CANCELLED;
+    return STEPPER_MOVE_DONE;
+}
+
+static void *motion_worker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&motion_lock);
+    while (motion_running) {
+        if (queue_len == 0) {
+            pthread_cond_wait(&motion_cond, &motion_lock);
+            continue;
+        }
+        StepperMove m = motion_queue[queue_head];
+        queue_head = (queue_head + 1) % STEPPER_MAX_QUEUED_MOVES;
+        queue_len--;
+        active_move_id = m.id;
+        cancel_active = false;
+        pthread_mutex_unlock(&motion_lock);
+
+        StepperMoveResult result = run_move(&m);
+
+        pthread_mutex_lock(&motion_lock);
+        int deg = steps_to_degrees(current_step_position);
+        pthread_mutex_unlock(&motion_lock);
+        door_state_publish_motor(deg, false);
+
+        if (m.cb) m.cb(m.id, result, deg, m.ctx);
+
+        // Only report idle once the callback has run, so WaitIdle callers
+        // see its effects.
+        pthread_mutex_lock(&motion_lock);
+        active_move_id = 0;
+        cancel_active = false;
+        pthread_cond_broadcast(&motion_cond);
+    }
+    pthread_mutex_unlock(&motion_lock);
+    return NULL;
+}
+
+// Remove queued moves matching id (0: all) into out; returns how many.
+// Caller holds motion_lock.
+static int take_queued(int move_id, StepperMove *out) {
+    int kept = 0, taken = 0;
+    StepperMove keep[STEPPER_MAX_QUEUED_MOVES];
+    for (int i = 0; i < queue_len; i++) {
+        StepperMove *m = &motion_queue[(queue_head + i) % STEPPER_MAX_QUEUED_MOVES];
+        if (move_id == 0 || m->id == move_id) out[taken++] = *m;
+        else keep[kept++] = *m;
+    }
+    memcpy(motion_queue, keep, (size_t)kept * sizeof(keep[0]));
+    queue_head = 0;
+    queue_len = kept;
+    return taken;
+}
+
+static void report_cancelled(const StepperMove *moves, int n) {
+    int deg = StepperMotor_GetPosition();
+    for (int i = 0; i < n; i++) {
+        if (moves[i].cb) moves[i].cb(moves[i].id, STEPPER_MOVE_CANCELLED, deg, moves[i].ctx);
+    }
 }
 
 bool StepperMotor_Init(void) {
     printf("Initializing Stepper Motor...\n");
-    
-    // Initialize all pins as outputs
-    if (!export_pin(IN1_GPIOCHIP, IN1_GPIO_LINE, "out") ||
-        !export_pin(IN2_GPIOCHIP, IN2_GPIO_LINE, "out") ||
-        !export_pin(IN3_GPIOCHIP, IN3_GPIO_LINE, "out") ||
-        !export_pin(IN4_GPIOCHIP, IN4_GPIO_LINE, "out")) {
+
+    pthread_mutex_lock(&motion_lock);
+    if (motion_running) {
+        pthread_mutex_unlock(&motion_lock);
+        printf("Stepper Motor already initialized\n");
+        return true;
+    }
+
+    // Initialize all pins as outputs, one group per chip
+    static const int lines_a[2] = { IN1_GPIO_LINE, IN2_GPIO_LINE };
+    static const int lines_b[2] = { IN3_GPIO_LINE, IN4_GPIO_LINE };
+    if (!export_pin_group(&coils_a, IN1_GPIOCHIP, lines_a, 2, "out") ||
+        !export_pin_group(&coils_b, IN3_GPIOCHIP, lines_b, 2, "out")) {
+        pthread_mutex_unlock(&motion_lock);
         printf("Failed to initialize motor pins\n");
         return false;
     }
 
     // Set initial position to 0
     current_step_position = 0;
-    
+    door_state_publish_motor(0, false);
+
     // Set all pins low initially
     if (!set_motor_pins(zero_pattern)) {
+        pthread_mutex_unlock(&motion_lock);
         printf("Failed to set initial pin states\n");
         return false;
     }
-    
+
+    static bool cond_ready = false;
+    if (!cond_ready) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&motion_cond, &attr);
+        pthread_condattr_destroy(&attr);
+        cond_ready = true;
+    }
+    queue_head = queue_len = 0;
+    active_move_id = 0;
+    motion_running = true;
+    if (pthread_create(&motion_thread, NULL, motion_worker, NULL) != 0) {
+        perror("Stepper motion pthread_create");
+        motion_running = false;
+        pthread_mutex_unlock(&motion_lock);
+        return false;
+    }
+    pthread_mutex_unlock(&motion_lock);
+
     printf("Stepper Motor initialized successfully\n");
     return true;
 }
 
-bool StepperMotor_Rotate(int target_degrees) {
+void StepperMotor_Shutdown(void) {
+    StepperMove dropped[STEPPER_MAX_QUEUED_MOVES];
+    int n;
+
+    pthread_mutex_lock(&motion_lock);
+    if (!motion_running) {
+        pthread_mutex_unlock(&motion_lock);
+        return;
+    }
+    n = take_queued(0, dropped);
+    cancel_active = true;
+    pthread_mutex_unlock(&motion_lock);
+
+    report_cancelled(dropped, n);
+
+    // Let the running move ramp down before stopping the thread
+    StepperMotor_WaitIdle(-1);
+
+    pthread_mutex_lock(&motion_lock);
+    motion_running = false;
+    pthread_cond_broadcast(&motion_cond);
+    pthread_mutex_unlock(&motion_lock);
+    pthread_join(motion_thread, NULL);
+
+    set_motor_pins(zero_pattern);
+}
+
+int StepperMotor_MoveAsync(int target_degrees, StepperMoveCallback cb, void *ctx) {
     if (target_degrees < 0 || target_degrees > 360) {
         printf("Invalid target degrees: %d\n", target_degrees);
-        return false;
+        return -1;
     }
 
     // Calculate target position in steps
-    int target_step_position = (int)((target_degrees * (long)STEPS_PER_REV + 180) / 360);
-    
-    // Calculate steps needed to reach target by rotating forward only
-    // Use modulo arithmetic to handle wraparound
-    int steps_needed = (target_step_position - current_step_position + STEPS_PER_REV) % STEPS_PER_REV;
-    
-    int current_step = 0;
-    int sequence_index = 0;
-
-    printf("Rotating motor to %d degrees (from current %d, need %d steps)...\n", 
-        target_degrees, StepperMotor_GetPosition(), steps_needed);
-
-    // Perform rotation forward only
-    while (current_step < steps_needed) {
-        // Set the current step pattern
-        if (!set_motor_pins(halfstep_sequence[sequence_index])) {
-            printf("Failed to set motor pins at step %d\n", current_step);
-            return false;
-        }
+    int target_step_position = (int)((target_degrees * (long)STEPS_PER_REV + 180) / 360) % STEPS_PER_REV;
 
-        // Move to next sequence pattern
-        sequence_index = (sequence_index + 1) % 8;
-        current_step++;
+    pthread_mutex_lock(&motion_lock);
+    if (!motion_running || queue_len == STEPPER_MAX_QUEUED_MOVES) {
+        bool running = motion_running;
+        pthread_mutex_unlock(&motion_lock);
+        printf(running ? "Stepper move queue full\n" : "Stepper Motor not initialized\n");
+        return -1;
+    }
+    int id = next_move_id++;
+    if (next_move_id <= 0) next_move_id = 1;
+    motion_queue[(queue_head + queue_len) % STEPPER_MAX_QUEUED_MOVES] =
+        (StepperMove){ id, target_step_position, cb, ctx };
+    queue_len++;
+    pthread_cond_broadcast(&motion_cond);
+    pthread_mutex_unlock(&motion_lock);
+    return id;
+}
 
-        // Update position in steps
-        current_step_position = (current_step_position + 1) % STEPS_PER_REV;
+bool StepperMotor_Cancel(int move_id) {
+    StepperMove dropped[STEPPER_MAX_QUEUED_MOVES];
+    bool found = false;
 
-        // Small delay between steps (adjust for speed)
-        sleepForMs(2);
+    pthread_mutex_lock(&motion_lock);
+    int n = take_queued(move_id, dropped);
+    if (active_move_id != 0 && (move_id == 0 || move_id == active_move_id)) {
+        cancel_active = true;
+        found = true;
     }
+    pthread_mutex_unlock(&motion_lock);
 
-    // Hold final position — print converted degrees (not raw steps)
-    {
-        int deg = (int)((current_step_position * 360L) / STEPS_PER_REV);
-        printf("Rotation complete. Current position: %d degrees\n", deg);
+    report_cancelled(dropped, n);
+    return found || n > 0;
+}
+
+bool StepperMotor_WaitIdle(int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout_ms > 0) timespec_add_ns(&deadline, timeout_ms * 1000000LL);
+
+    bool idle = true;
+    pthread_mutex_lock(&motion_lock);
+    while (queue_len > 0 || active_move_id != 0) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&motion_cond, &motion_lock);
+        } else if (timeout_ms == 0 ||
+                   pthread_cond_timedwait(&motion_cond, &motion_lock, &deadline) == ETIMEDOUT) {
+            idle = queue_len == 0 && active_move_id == 0;
+            break;
+        }
     }
+    pthread_mutex_unlock(&motion_lock);
+    return idle;
+}
+
+bool StepperMotor_IsMoving(void) {
+    pthread_mutex_lock(&motion_lock);
+    bool moving = queue_len > 0 || active_move_id != 0;
+    pthread_mutex_unlock(&motion_lock);
+    return moving;
+}
+
+bool StepperMotor_SetProfile(const StepperProfile *profile) {
+    if (!profile || profile->start_steps_per_s <= 0 || profile->accel_steps_per_s2 <= 0 ||
+        profile->max_steps_per_s < profile->start_steps_per_s) {
+        return false;
+    }
+    pthread_mutex_lock(&motion_lock);
+    motion_profile = *profile;
+    pthread_mutex_unlock(&motion_lock);
     return true;
 }
 
+typedef struct {
+    bool              done;
+    StepperMoveResult result;
+} RotateWait;
+
+static void rotate_done(int move_id, StepperMoveResult result, int position_degrees, void *ctx) {
+    (void)move_id;
+    (void)position_degrees;
+    RotateWait *w = ctx;
+    pthread_mutex_lock(&motion_lock);
+    w->result = result;
+    w->done = true;
+    pthread_cond_broadcast(&motion_cond);
+    pthread_mutex_unlock(&motion_lock);
+}
+
+bool StepperMotor_Rotate(int target_degrees) {
+    RotateWait w = { false, STEPPER_MOVE_FAILED };
+
+    printf("Rotating motor to %d degrees (from current %d)...\n",
+        target_degrees, StepperMotor_GetPosition());
+
+    if (StepperMotor_MoveAsync(target_degrees, rotate_done, &w) < 0) {
+        return false;
+    }
+    pthread_mutex_lock(&motion_lock);
+    while (!w.done) {
+        pthread_cond_wait(&motion_cond, &motion_lock);
+    }
+    pthread_mutex_unlock(&motion_lock);
+
+    // Hold final position — print converted degrees (not raw steps)
+    printf("Rotation %s. Current position: %d degrees\n",
+           w.result == STEPPER_MOVE_DONE ? "complete" :
+           w.result == STEPPER_MOVE_CANCELLED ? "cancelled" : "failed",
+           StepperMotor_GetPosition());
+    return w.result == STEPPER_MOVE_DONE;
+}
+
 int StepperMotor_GetPosition(void) {
     /* Convert current step position to degrees (integer degrees). Use
      * integer math: degrees = floor(current_step_position * 360 / STEPS_PER_REV)
      */
-    return (int)((current_step_position * 360L) / STEPS_PER_REV);
+    pthread_mutex_lock(&motion_lock);
+    int steps = current_step_position;
+    pthread_mutex_unlock(&motion_lock);
+    return steps_to_degrees(steps);
 }
 
 bool StepperMotor_ResetPosition(void) {
+    pthread_mutex_lock(&motion_lock);
+    if (queue_len > 0 || active_move_id != 0) {
+        pthread_mutex_unlock(&motion_lock);
+        return false;
+    }
     // Reset position to 0 degrees
     if (!set_motor_pins(zero_pattern)) {
+        pthread_mutex_unlock(&motion_lock);
         return false;
     }
     current_step_position = 0;
+    door_state_publish_motor(0, false);
+    pthread_mutex_unlock(&motion_lock);
     return true;
-}
\ No newline at end of file
+}
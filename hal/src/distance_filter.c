@@ -0,0 +1,122 @@
+// distance_filter.c
+#include "hal/distance_filter.h"
+
+#include <string.h>
+
+void distance_filter_config_default(DistanceFilterConfig *cfg, double threshold_cm,
+                                    double hysteresis_cm)
+{
+    if (!cfg) return;
+    cfg->median_n         = 5;
+    cfg->ema_alpha        = 0.4;
+    cfg->near_below_cm    = threshold_cm - hysteresis_cm;
+    cfg->far_above_cm     = threshold_cm + hysteresis_cm;
+    cfg->debounce_samples = 3;
+    cfg->max_failures     = 5;
+}
+
+void distance_filter_init(DistanceFilter *f, const DistanceFilterConfig *cfg)
+{
+    if (!f) return;
+    memset(f, 0, sizeof(*f));
+    if (cfg) {
+        f->cfg = *cfg;
+    } else {
+        distance_filter_config_default(&f->cfg, 0, 0);
+    }
+    if (f->cfg.median_n < 1) f->cfg.median_n = 1;
+    if (f->cfg.median_n > DISTANCE_FILTER_MAX_N) f->cfg.median_n = DISTANCE_FILTER_MAX_N;
+    if (f->cfg.median_n % 2 == 0) f->cfg.median_n--;
+    if (f->cfg.ema_alpha <= 0 || f->cfg.ema_alpha > 1) f->cfg.ema_alpha = 1;
+    if (f->cfg.far_above_cm < f->cfg.near_below_cm) f->cfg.far_above_cm = f->cfg.near_below_cm;
+    if (f->cfg.debounce_samples < 1) f->cfg.debounce_samples = 1;
+    if (f->cfg.max_failures < 1) f->cfg.max_failures = 1;
+}
+
+static double window_median(const DistanceFilter *f)
+{
+    double s[DISTANCE_FILTER_MAX_N];
+    memcpy(s, f->window, (size_t)f->len * sizeof(s[0]));
+    for (int i = 1; i < f->len; i++) {
+        for (int j = i; j > 0 && s[j - 1] > s[j]; j--) {
+            double t = s[j]; s[j] = s[j - 1]; s[j - 1] = t;
+        }
+    }
+    return s[f->len / 2];
+}
+
+// Class of a smoothed value; UNKNOWN inside the dead band.
+static DistanceClass classify(const DistanceFilter *f, double v)
+{
+    if (f->cfg.near_below_cm <= 0) return DISTANCE_UNKNOWN;
+    if (v < f->cfg.near_below_cm) return DISTANCE_NEAR;
+    if (v > f->cfg.far_above_cm) return DISTANCE_FAR;
+    return DISTANCE_UNKNOWN;
+}
+
+bool distance_filter_update(DistanceFilter *f, double raw_cm)
+{
+    if (!f) return false;
+
+    if (raw_cm < 0) {
+        if (++f->failures < f->cfg.max_failures) return false;
+        // Sensor gone: forget everything, the next reading starts fresh
+        DistanceClass before = f->state;
+        f->len = f->pos = 0;
+        f->ema_valid = false;
+        f->state = f->candidate = DISTANCE_UNKNOWN;
+        f->candidate_count = 0;
+        return before != DISTANCE_UNKNOWN;
+    }
+    f->failures = 0;
+
+    f->window[f->pos] = raw_cm;
+    f->pos = (f->pos + 1) % f->cfg.median_n;
+    if (f->len < f->cfg.median_n) f->len++;
+
+    double m = window_median(f);
+    f->ema = f->ema_valid ? f->cfg.ema_alpha * m + (1 - f->cfg.ema_alpha) * f->ema : m;
+    f->ema_valid = true;
+
+    // Inside the dead band the current class holds
+    DistanceClass c = classify(f, f->ema);
+    if (c == DISTANCE_UNKNOWN || c == f->state) {
+        f->candidate = DISTANCE_UNKNOWN;
+        f->candidate_count = 0;
+        return false;
+    }
+    if (c != f->candidate) {
+        f->candidate = c;
+        f->candidate_count = 0;
+    }
+    if (++f->candidate_count < f->cfg.debounce_samples) return false;
+
+    f->state = c;
+    f->candidate = DISTANCE_UNKNOWN;
+    f->candidate_count = 0;
+    return true;
+}
+
+double distance_filter_value(const DistanceFilter *f)
+{
+    return (f && f->ema_valid) ? f->ema : -1;
+}
+
+DistanceClass distance_filter_class(const DistanceFilter *f)
+{
+    return f ? f->state : DISTANCE_UNKNOWN;
+}
+
+double distance_filter_confidence(const DistanceFilter *f)
+{
+    if (!f || f->state == DISTANCE_UNKNOWN || f->len == 0) return 0;
+
+    // Raw samples on the state's side of the band midpoint
+    double mid = (f->cfg.near_below_cm + f->cfg.far_above_cm) / 2;
+    int agree = 0;
+    for (int i = 0; i < f->len; i++) {
+        bool near = f->window[i] < mid;
+        if (near == (f->state == DISTANCE_NEAR)) agree++;
+    }
+    return ((double)f->len / f->cfg.median_n) * ((double)agree / f->len);
+}
@@ -0,0 +1,122 @@
+// door_state.c
+// Seqlock around the door module's state record; see door_state.h.
+//
+// The record is stored as atomic words so that a reader racing a publish
+// only ever sees a torn copy it is about to throw away, never undefined
+// behaviour. Publishers keep the full record in `g_current` under
+// g_write_lock and copy it out word by word.
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "hal/door_state.h"
+#include "hal/timing.h"
+
+#define STATE_WORDS ((sizeof(DoorStateSnapshot) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+typedef union {
+    DoorStateSnapshot s;
+    uint64_t          w[STATE_WORDS];
+} StateWords;
+
+static _Atomic uint64_t g_seq = 0;                 // odd while a publish is in progress
+static _Atomic uint64_t g_words[STATE_WORDS];
+
+static pthread_mutex_t g_write_lock = PTHREAD_MUTEX_INITIALIZER;
+static StateWords      g_current;                  // publishers' copy, under g_write_lock
+static int             g_lock_degrees = DOOR_STATE_DEFAULT_LOCK_DEGREES;
+static DoorStateChangeFn g_change_cb = NULL;
+static void             *g_change_ctx = NULL;
+
+// Caller holds g_write_lock and has updated g_current.
+static void publish_locked(void)
+{
+    DoorStateSnapshot *s = &g_current.s;
+    bool locked = !s->motor_moving && s->motor_degrees == g_lock_degrees;
+    if (locked != s->locked) {
+        s->locked = locked;
+        s->lock_version++;
+    }
+    s->version++;
+    s->updated_ms = getTimeInMs();
+
+    uint64_t seq = atomic_load_explicit(&g_seq, memory_order_relaxed);
+    atomic_store_explicit(&g_seq, seq + 1, memory_order_relaxed);   // odd: writing
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < STATE_WORDS; i++)
+        atomic_store_explicit(&g_words[i], g_current.w[i], memory_order_relaxed);
+    atomic_store_explicit(&g_seq, seq + 2, memory_order_release);   // even: stable
+}
+
+static void write_begin(uint32_t *versions)
+{
+    pthread_mutex_lock(&g_write_lock);
+    *versions = g_current.s.door_version + g_current.s.lock_version;
+}
+
+// Publish and, if door or lock changed, tell the listener (outside the lock).
+static void write_end(uint32_t versions)
+{
+    publish_locked();
+    bool changed = g_current.s.door_version + g_current.s.lock_version != versions;
+    DoorStateChangeFn cb = g_change_cb;
+    void *ctx = g_change_ctx;
+    pthread_mutex_unlock(&g_write_lock);
+    if (changed && cb) cb(ctx);
+}
+
+void door_state_set_lock_position(int degrees)
+{
+    uint32_t v;
+    write_begin(&v);
+    g_lock_degrees = degrees;
+    write_end(v);
+}
+
+void door_state_set_change_callback(DoorStateChangeFn fn, void *ctx)
+{
+    pthread_mutex_lock(&g_write_lock);
+    g_change_cb = fn;
+    g_change_ctx = ctx;
+    pthread_mutex_unlock(&g_write_lock);
+}
+
+void door_state_publish_sensor(const HcSr04Reading *r)
+{
+    if (!r) return;
+    uint32_t v;
+    write_begin(&v);
+    DoorStateSnapshot *s = &g_current.s;
+    if (r->state != s->door) {
+        s->door = r->state;
+        s->door_version++;
+    }
+    s->confidence = r->confidence;
+    s->distance_cm = r->distance_cm;
+    s->sensor_ms = r->timestamp_ms;
+    write_end(v);
+}
+
+void door_state_publish_motor(int degrees, bool moving)
+{
+    uint32_t v;
+    write_begin(&v);
+    g_current.s.motor_degrees = degrees;
+    g_current.s.motor_moving = moving;
+    write_end(v);
+}
+
+void door_state_read(DoorStateSnapshot *out)
+{
+    if (!out) return;
+    StateWords copy;
+    for (;;) {
+        uint64_t s1 = atomic_load_explicit(&g_seq, memory_order_acquire);
+        if (s1 & 1) continue;
+        for (size_t i = 0; i < STATE_WORDS; i++)
+            copy.w[i] = atomic_load_explicit(&g_words[i], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&g_seq, memory_order_relaxed) == s1) break;
+    }
+    memcpy(out, &copy.s, sizeof(*out));
+}
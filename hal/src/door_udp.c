@@ -7,13 +7,15 @@
 #include <netinet/in.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <time.h>
-#include <sys/time.h>
 #include <unistd.h>
 #include <pthread.h>
 #include "hal/timing.h"
+#include "hal/reactor.h"
+#include "hal/event_spool.h"
 
 #define BUF_MAX 256
 
@@ -22,14 +24,16 @@ static int g_sock = -1;
 static struct sockaddr_in g_dest_notif;
 static struct sockaddr_in g_dest_hb;
 static socklen_t g_dest_len = 0;
-// Command listener
-static pthread_t g_cmd_thread;
-static volatile int g_cmd_running = 0;
+// Command listener: g_sock registered with the reactor
+static int g_cmd_source = 0;
 static uint16_t g_bound_notif_port = 0;
 
 // Forward declarations for helpers used before their definitions
 static void send_line_notif(const char *line);
 static void send_line_hb(const char *line);
+static void note_activity_locked(void);
+static int hb_fast_ms_locked(void);
+static int hb_jitter_locked(int base_ms);
 
 // Module identity + reporting settings
 static char           g_module_id[16]       = "M?";
@@ -46,6 +50,79 @@ static bool g_prev_d1_locked= false;
 // Heartbeat timer
 static long long g_last_heartbeat_ms = 0;
 
+// The reporter and the heartbeat thread both call door_udp_update*(); this
+// serializes them over the previous-state tracking and heartbeat timer.
+static pthread_mutex_t g_report_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t        g_prev_version = 0;   // door_state version last reported
+
+// Adaptive heartbeat, under g_report_lock: g_heartbeat_period_ms after a
+// state change or COMMAND, doubling with each quiet heartbeat up to
+// g_heartbeat_idle_ms. A hub CONFIG RATE raises both to its floor and
+// adds up to g_hub_jitter_ms to every interval.
+static int                 g_heartbeat_idle_ms = DOOR_HB_DEFAULT_IDLE_MS;
+static int                 g_hub_period_ms     = 0;      // hub's floor, 0: none
+static int                 g_hub_jitter_ms     = 0;
+static unsigned            g_hb_seed           = 1;      // rand_r() state for the jitter
+static int                 g_hb_base_ms        = 1000;   // g_hb_interval_ms before jitter
+static int                 g_hb_interval_ms    = 1000;   // until the next heartbeat
+static bool                g_hb_activity       = false;  // since the last heartbeat
+static DoorHeartbeatRateFn g_hb_rate_cb        = NULL;
+static void               *g_hb_rate_ctx       = NULL;
+
+// Reliable EVENTs, only while the command listener runs (ACKs come in on
+// it). Each EVENT carries SEQ=<epoch>.<n>; unacknowledged ones stay in
+// event_spool and the whole window is resent, go-back-N, with backoff
+// until the hub ACKs it cumulatively.
+#define EVENT_TICK_MS     100
+#define EVENT_RETX_MIN_MS 250
+#define EVENT_RETX_MAX_MS 8000
+static pthread_mutex_t g_event_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool      g_event_reliable  = false;
+static uint32_t  g_event_epoch     = 0;     // this session; the hub restarts at 1 on a new one
+static uint32_t  g_event_next_seq  = 1;
+static uint32_t  g_event_sent_seq  = 0;     // highest seq sent at least once
+static int       g_event_backoff_ms = EVENT_RETX_MIN_MS;
+static long long g_event_retx_ms   = 0;     // when the window is resent next
+static int       g_event_timer     = 0;
+static char      g_event_spool_path[256] = "";
+
+// Outgoing batches: lines written within g_batch_window_ms of the first
+// one share a datagram, flushed by a one-shot reactor timer. A heartbeat
+// rides along with pending notifications instead of going out on its own.
+typedef struct {
+    const struct sockaddr_in *dest;
+    char   buf[DOOR_UDP_BATCH_MAX];
+    size_t len;
+} SendBatch;
+static pthread_mutex_t g_batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static SendBatch g_batch_notif = { .dest = &g_dest_notif };
+static SendBatch g_batch_hb    = { .dest = &g_dest_hb };
+static int       g_batch_window_ms = DOOR_UDP_DEFAULT_BATCH_MS;
+static int       g_batch_timer = 0;      // 0: no batching, lines go out at once
+static bool      g_batch_armed = false;
+
+// Recently received COMMANDs. A retransmit (same source, cmdid, target and
+// action) is answered with the FEEDBACK already sent for it instead of
+// running the command again.
+#define CMD_CACHE_SIZE   16
+#define CMD_CACHE_TTL_MS 10000
+typedef struct {
+    bool               used;
+    bool               final;          // reply is COMPLETED/FAILED (or single-phase)
+    DoorCmdRef         ref;            // handed to the handler, names this entry
+    struct sockaddr_in src;
+    int                cmdid;
+    char               target[32];
+    char               action[32];
+    long long          seen_ms;
+    char               reply[BUF_MAX]; // last FEEDBACK sent, "" while none yet
+} CmdCacheEntry;
+static CmdCacheEntry   g_cmd_cache[CMD_CACHE_SIZE];
+static DoorCmdRef      g_cmd_next_ref = 1;
+static pthread_mutex_t g_cmd_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static long long now_ms(void);
+
 /* Registered command handler (set by the app layer) */
 static DoorCmdHandler g_cmd_handler = NULL;
 static void *g_cmd_handler_ctx = NULL;
@@ -57,11 +134,102 @@ bool door_udp_register_command_handler(DoorCmdHandler handler, void *ctx)
     return true;
 }
 
-bool door_udp_send_feedback(const char *module, int cmdid, const char *target, const char *action)
+// ---------------- command cache ----------------
+
+// Returns true if this COMMAND was already seen; *reply then holds the
+// FEEDBACK to replay ("" if the first copy hasn't been answered yet).
+// Otherwise remembers it, evicting an expired or the oldest entry, and
+// sets *ref to the new entry.
+static bool cmd_cache_check(const struct sockaddr_in *src, int cmdid,
+                            const char *target, const char *action,
+                            char *reply, size_t reply_len, DoorCmdRef *ref)
+{
+    long long now = now_ms();
+    CmdCacheEntry *slot = NULL;
+    bool dup = false;
+
+    pthread_mutex_lock(&g_cmd_cache_lock);
+    for (int i = 0; i < CMD_CACHE_SIZE; i++) {
+        CmdCacheEntry *e = &g_cmd_cache[i];
+        if (e->used && now - e->seen_ms > CMD_CACHE_TTL_MS) e->used = false;
+        if (!e->used) {
+            if (!slot || slot->used) slot = e;
+            continue;
+        }
+        if (e->cmdid == cmdid &&
+            e->src.sin_addr.s_addr == src->sin_addr.s_addr &&
+            e->src.sin_port == src->sin_port &&
+            strcmp(e->target, target) == 0 && strcmp(e->action, action) == 0) {
+            snprintf(reply, reply_len, "%s", e->reply);
+            dup = true;
+            break;
+        }
+        if (!slot || (slot->used && e->seen_ms < slot->seen_ms)) slot = e;
+    }
+    if (!dup) {
+        memset(slot, 0, sizeof(*slot));
+        slot->used  = true;
+        slot->src   = *src;
+        slot->cmdid = cmdid;
+        snprintf(slot->target, sizeof(slot->target), "%s", target);
+        snprintf(slot->action, sizeof(slot->action), "%s", action);
+        slot->seen_ms = now;
+        slot->ref   = g_cmd_next_ref++;
+        if (g_cmd_next_ref == 0) g_cmd_next_ref = 1;
+        *ref = slot->ref;
+    }
+    pthread_mutex_unlock(&g_cmd_cache_lock);
+    return dup;
+}
+
+// Remember a FEEDBACK line against the cached COMMAND it answers. An
+// ACCEPTED never replaces a final reply.
+static void cmd_cache_store(DoorCmdRef ref, const char *line, bool final)
+{
+    if (ref == 0) return;
+    pthread_mutex_lock(&g_cmd_cache_lock);
+    for (int i = 0; i < CMD_CACHE_SIZE; i++) {
+        CmdCacheEntry *e = &g_cmd_cache[i];
+        if (!e->used || e->ref != ref) continue;
+        if (final || !e->final) {
+            snprintf(e->reply, sizeof(e->reply), "%s", line);
+            e->final = final;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&g_cmd_cache_lock);
+}
+
+bool door_udp_send_feedback(const char *module, int cmdid, const char *target, const char *action,
+                            DoorCmdRef ref)
 {
     if (g_sock < 0) return false;
     char out[BUF_MAX];
     snprintf(out, sizeof(out), "%s FEEDBACK %d %s %s\n", module, cmdid, target, action);
+    cmd_cache_store(ref, out, true);
+    send_line_notif(out);
+    return true;
+}
+
+bool door_udp_send_accepted(const char *module, int cmdid, const char *target, const char *action,
+                            DoorCmdRef ref)
+{
+    if (g_sock < 0) return false;
+    char out[BUF_MAX];
+    snprintf(out, sizeof(out), "%s FEEDBACK %d %s ACCEPTED %s\n", module, cmdid, target, action);
+    cmd_cache_store(ref, out, false);
+    send_line_notif(out);
+    return true;
+}
+
+bool door_udp_send_result(const char *module, int cmdid, const char *target, const char *action,
+                          bool ok, const char *state, long long duration_ms, DoorCmdRef ref)
+{
+    if (g_sock < 0) return false;
+    char out[BUF_MAX];
+    snprintf(out, sizeof(out), "%s FEEDBACK %d %s %s %s %s %lld\n", module, cmdid, target,
+             ok ? "COMPLETED" : "FAILED", action, state ? state : "UNKNOWN", duration_ms);
+    cmd_cache_store(ref, out, true);
     send_line_notif(out);
     return true;
 }
@@ -75,43 +243,218 @@ static long long now_ms(void)
 }
 
 // ---------------- UDP send helper ----------------
-static void send_line_notif(const char *line)
+
+// Caller holds g_batch_lock.
+static void batch_flush_locked(SendBatch *b)
+{
+    if (b->len == 0) return;
+    if (g_sock >= 0)
+        sendto(g_sock, b->buf, b->len, 0, (const struct sockaddr *)b->dest, g_dest_len);
+    b->len = 0;
+}
+
+// Reactor timer: the batch window is up.
+static void batch_flush_tick(uint64_t expirations, void *ctx)
+{
+    (void)expirations;
+    (void)ctx;
+    pthread_mutex_lock(&g_batch_lock);
+    g_batch_armed = false;
+    batch_flush_locked(&g_batch_hb);
+    batch_flush_locked(&g_batch_notif);
+    pthread_mutex_unlock(&g_batch_lock);
+}
+
+// Add a line (which ends in '\n') to a batch. Caller holds g_batch_lock.
+static void batch_add_locked(SendBatch *b, const char *line, size_t n)
+{
+    if (b->len + n > sizeof(b->buf)) batch_flush_locked(b);
+    memcpy(b->buf + b->len, line, n);
+    b->len += n;
+    if (!g_batch_armed) {
+        g_batch_armed = reactor_arm_timer_once(g_batch_timer, g_batch_window_ms);
+        if (!g_batch_armed) batch_flush_locked(b);
+    }
+}
+
+static void send_line(SendBatch *b, const char *line)
 {
     if (g_sock < 0) return;
-    sendto(g_sock, line, strlen(line), 0,
-           (struct sockaddr *)&g_dest_notif, g_dest_len);
+    size_t n = strlen(line);
+    pthread_mutex_lock(&g_batch_lock);
+    if (g_batch_timer <= 0 || n == 0 || line[n - 1] != '\n' || n > sizeof(b->buf)) {
+        pthread_mutex_unlock(&g_batch_lock);
+        sendto(g_sock, line, n, 0, (const struct sockaddr *)b->dest, g_dest_len);
+        return;
+    }
+    if (b == &g_batch_notif && g_batch_hb.len > 0 &&
+        g_batch_hb.len + g_batch_notif.len <= sizeof(g_batch_notif.buf)) {
+        // The hub reads HEARTBEATs on either port; keep one datagram, in order
+        memcpy(g_batch_notif.buf + g_batch_notif.len, g_batch_hb.buf, g_batch_hb.len);
+        g_batch_notif.len += g_batch_hb.len;
+        g_batch_hb.len = 0;
+    } else if (b == &g_batch_hb && g_batch_notif.len > 0) {
+        b = &g_batch_notif;   // piggyback on pending notifications
+    }
+    batch_add_locked(b, line, n);
+    pthread_mutex_unlock(&g_batch_lock);
+}
+
+static void send_line_notif(const char *line)
+{
+    send_line(&g_batch_notif, line);
 }
 
 static void send_line_hb(const char *line)
 {
-    if (g_sock < 0) return;
-    sendto(g_sock, line, strlen(line), 0,
-           (struct sockaddr *)&g_dest_hb, g_dest_len);
+    send_line(&g_batch_hb, line);
+}
+
+// <MOD> CONFIG RATE <PERIOD_MS> <JITTER_MS> <PHASE_MS> from the hub: keep
+// heartbeats at least PERIOD_MS apart, add up to JITTER_MS to each, and
+// send the next one PHASE_MS from now. PERIOD_MS 0 lifts the floor.
+static void apply_rate_config(int period_ms, int jitter_ms, int phase_ms)
+{
+    if (period_ms < 0) period_ms = 0;
+    if (jitter_ms < 0 || period_ms == 0) jitter_ms = 0;
+    if (jitter_ms > period_ms) jitter_ms = period_ms;
+    if (phase_ms < 0 || phase_ms >= period_ms) phase_ms = 0;
+
+    pthread_mutex_lock(&g_report_lock);
+    bool slower = period_ms > g_hub_period_ms;
+    g_hub_period_ms = period_ms;
+    g_hub_jitter_ms = jitter_ms;
+    int fast = hb_fast_ms_locked();
+    int idle = g_heartbeat_idle_ms > fast ? g_heartbeat_idle_ms : fast;
+    if (g_hb_base_ms < fast) g_hb_base_ms = fast;
+    if (g_hb_base_ms > idle) g_hb_base_ms = idle;
+
+    // Slowed down: move to the hub's phase. Otherwise keep a heartbeat
+    // that is due sooner, so a run of CONFIGs can't keep postponing it.
+    long long t = now_ms();
+    int next;
+    if (slower && phase_ms > 0) {
+        next = phase_ms;
+    } else {
+        long long left = g_last_heartbeat_ms + g_hb_interval_ms - t;
+        next = hb_jitter_locked(g_hb_base_ms);
+        if (left < next) next = left > 0 ? (int)left : 1;
+    }
+    // Restart the interval from now; always re-arm, even if it is unchanged
+    g_hb_interval_ms = next;
+    g_last_heartbeat_ms = t;
+    if (g_hb_rate_cb) g_hb_rate_cb(next, g_hb_rate_ctx);
+    pthread_mutex_unlock(&g_report_lock);
+
+    fprintf(stderr, "[door_cmd] hub heartbeat floor %d ms, jitter %d ms, phase %d ms\n",
+            period_ms, jitter_ms, phase_ms);
+}
+
+// ---------------- reliable EVENTs ----------------
+
+// Send the window's entries from `from` onwards, each with BASE=<oldest
+// unacknowledged seq> so a hub without a record of this module knows
+// where to start. Caller holds g_event_lock.
+static void event_send_window_locked(uint32_t from)
+{
+    EventSpoolEntry win[EVENT_SPOOL_RING];
+    char out[BUF_MAX + 16];
+    int n = event_spool_window(win, EVENT_SPOOL_RING);
+    for (int i = 0; i < n; i++) {
+        if (win[i].seq < from) continue;
+        if (!win[i].line[0]) {
+            // Lost from the spill file: the hub still needs the seq
+            snprintf(win[i].line, sizeof(win[i].line), "%s EVENT LOST SEQ=%u.%u\n",
+                     g_module_id, g_event_epoch, win[i].seq);
+        }
+        snprintf(out, sizeof(out), "%.*s BASE=%u\n",
+                 (int)strcspn(win[i].line, "\n"), win[i].line, win[0].seq);
+        send_line_notif(out);
+        if (win[i].seq > g_event_sent_seq) g_event_sent_seq = win[i].seq;
+    }
+}
+
+// body: "D0 DOOR OPEN" etc.
+static void send_event(const char *body)
+{
+    char line[BUF_MAX];
+    pthread_mutex_lock(&g_event_lock);
+    if (g_event_reliable) {
+        uint32_t seq = g_event_next_seq;
+        snprintf(line, sizeof(line), "%s EVENT %s SEQ=%u.%u\n",
+                 g_module_id, body, g_event_epoch, seq);
+        bool was_idle = event_spool_pending() == 0;
+        EventSpoolResult r = event_spool_push(seq, line);
+        if (r != EVENT_SPOOL_FULL) {
+            g_event_next_seq++;
+            if (r == EVENT_SPOOL_QUEUED) event_send_window_locked(seq);
+            if (was_idle) g_event_retx_ms = now_ms() + g_event_backoff_ms;
+            pthread_mutex_unlock(&g_event_lock);
+            return;
+        }
+        // No room even on disk: send it unnumbered rather than leave a gap
+        // the hub would wait on forever
+        fprintf(stderr, "[door_udp] EVENT spool full, sending '%s' unsequenced\n", body);
+    }
+    pthread_mutex_unlock(&g_event_lock);
+    snprintf(line, sizeof(line), "%s EVENT %s\n", g_module_id, body);
+    send_line_notif(line);
 }
 
-static void *door_cmd_thread(void *arg)
+// <MOD> ACK <epoch>.<n>: the hub has every EVENT up to n.
+static void handle_event_ack(const char *seq_s)
 {
-    (void)arg;
-    fprintf(stderr, "[door_cmd_thread] Listener thread started, waiting for incoming datagrams...\n");
+    unsigned long epoch = 0, seq = 0;
+    if (!seq_s || sscanf(seq_s, "%lu.%lu", &epoch, &seq) != 2) return;
+
+    pthread_mutex_lock(&g_event_lock);
+    if (g_event_reliable && epoch == g_event_epoch && event_spool_ack((uint32_t)seq) > 0) {
+        g_event_backoff_ms = EVENT_RETX_MIN_MS;
+        g_event_retx_ms = now_ms() + g_event_backoff_ms;
+        // Lines refilled from the spill file haven't been out yet
+        event_send_window_locked(g_event_sent_seq + 1);
+    }
+    pthread_mutex_unlock(&g_event_lock);
+}
+
+// Reactor timer: resend the whole window once its ACK is overdue.
+static void event_retx_tick(uint64_t expirations, void *ctx)
+{
+    (void)expirations;
+    (void)ctx;
+    pthread_mutex_lock(&g_event_lock);
+    long long t = now_ms();
+    if (event_spool_pending() > 0 && t >= g_event_retx_ms) {
+        event_send_window_locked(0);
+        g_event_backoff_ms *= 2;
+        if (g_event_backoff_ms > EVENT_RETX_MAX_MS) g_event_backoff_ms = EVENT_RETX_MAX_MS;
+        g_event_retx_ms = t + g_event_backoff_ms;
+    }
+    pthread_mutex_unlock(&g_event_lock);
+}
+
+// Reactor callback: drain every queued datagram, then go back to sleep.
+static void door_cmd_readable(int fd, uint32_t events, void *ctx)
+{
+    (void)events;
+    (void)ctx;
     char buf[BUF_MAX];
     struct sockaddr_in src;
-    socklen_t srclen = sizeof(src);
 
-    while (g_cmd_running) {
-        ssize_t n = recvfrom(g_sock, buf, sizeof(buf)-1, 0,
+    for (;;) {
+        socklen_t srclen = sizeof(src);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf)-1, MSG_DONTWAIT,
                              (struct sockaddr *)&src, &srclen);
         if (n < 0) {
             if (errno == EINTR) continue;
-            /* Timeout or no data; re-check the running flag to exit cleanly. */
-            if (errno == EAGAIN || errno == EWOULDBLOCK) continue;
-            fprintf(stderr, "[door_cmd_thread] recvfrom error: %s\n", strerror(errno));
-            sleepForMs(1);
-            continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                fprintf(stderr, "[door_cmd] recvfrom error: %s\n", strerror(errno));
+            return;
         }
         buf[n] = '\0';
         char src_ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &src.sin_addr, src_ip, INET_ADDRSTRLEN);
-        fprintf(stderr, "[door_cmd_thread] RECEIVED: %zd bytes from %s:%u: '%s'\n", n, src_ip, ntohs(src.sin_port), buf);
+        fprintf(stderr, "[door_cmd] RECEIVED: %zd bytes from %s:%u: '%s'\n", n, src_ip, ntohs(src.sin_port), buf);
 
         // parse: <MODULE> COMMAND <CMDID> <TARGET> <ACTION>
         char *save = NULL;
@@ -119,6 +462,21 @@ static void *door_cmd_thread(void *arg)
         if (!mod) continue;
         char *type = strtok_r(NULL, " \t\r\n", &save);
         if (!type) continue;
+        if (strcmp(type, "ACK") == 0) {
+            char *seq_s = strtok_r(NULL, " \t\r\n", &save);
+            if (strcmp(mod, g_module_id) == 0) handle_event_ack(seq_s);
+            continue;
+        }
+        if (strcmp(type, "CONFIG") == 0) {
+            char *what = strtok_r(NULL, " \t\r\n", &save);
+            char *period_s = strtok_r(NULL, " \t\r\n", &save);
+            char *jitter_s = strtok_r(NULL, " \t\r\n", &save);
+            char *phase_s = strtok_r(NULL, " \t\r\n", &save);
+            if (strcmp(mod, g_module_id) == 0 && what && strcmp(what, "RATE") == 0 && period_s)
+                apply_rate_config(atoi(period_s), jitter_s ? atoi(jitter_s) : 0,
+                                  phase_s ? atoi(phase_s) : 0);
+            continue;
+        }
         if (strcmp(type, "COMMAND") != 0) continue;
         char *cmdid_s = strtok_r(NULL, " \t\r\n", &save);
         char *target = strtok_r(NULL, " \t\r\n", &save);
@@ -129,17 +487,24 @@ static void *door_cmd_thread(void *arg)
 
         // Only act on commands addressed to this module
         if (strcmp(mod, g_module_id) == 0) {
-            if (g_cmd_handler) {
-                g_cmd_handler(mod, cmdid, target, action, g_cmd_handler_ctx);
+            char reply[BUF_MAX];
+            DoorCmdRef ref = 0;
+            if (cmd_cache_check(&src, cmdid, target, action, reply, sizeof(reply), &ref)) {
+                // Retransmit: answer with what we already said, don't run it again
+                fprintf(stderr, "[door_cmd] duplicate COMMAND %d %s %s, %s\n", cmdid,
+                        target, action, reply[0] ? "replaying FEEDBACK" : "still running");
+                if (reply[0]) send_line_notif(reply);
+            } else if (g_cmd_handler) {
+                pthread_mutex_lock(&g_report_lock);
+                note_activity_locked();
+                pthread_mutex_unlock(&g_report_lock);
+                g_cmd_handler(mod, cmdid, target, action, ref, g_cmd_handler_ctx);
             } else {
                 // No handler registered: keep legacy behavior and send basic FEEDBACK
-                char out[BUF_MAX];
-                snprintf(out, sizeof(out), "%s FEEDBACK %d %s %s\n", g_module_id, cmdid, target, action);
-                send_line_notif(out);
+                door_udp_send_feedback(g_module_id, cmdid, target, action, ref);
             }
         }
     }
-    return NULL;
 }
 
 // ---------------- Public API ----------------
@@ -158,8 +523,14 @@ bool door_udp_init(const char *host_ip, uint16_t port,
     g_mode = mode;
     g_heartbeat_period_ms = heartbeat_period_ms > 0 ? heartbeat_period_ms : 1000;
 
+    pthread_mutex_lock(&g_report_lock);
     g_prev_valid = false;
     g_last_heartbeat_ms = now_ms();
+    g_hub_period_ms = g_hub_jitter_ms = 0;   // the hub resends it after our HELLO
+    g_hb_seed = (unsigned)g_last_heartbeat_ms ^ ((unsigned)getpid() << 16);
+    g_hb_base_ms = g_hb_interval_ms = g_heartbeat_period_ms;
+    g_hb_activity = false;
+    pthread_mutex_unlock(&g_report_lock);
 
     // Create UDP socket
     int s = socket(AF_INET, SOCK_DGRAM, 0);
@@ -168,18 +539,6 @@ bool door_udp_init(const char *host_ip, uint16_t port,
         return false;
     }
 
-    /* Make recvfrom() time out periodically so the command listener
-     * thread can observe `g_cmd_running` and exit cleanly on shutdown. */
-    struct timeval tv2;
-    tv2.tv_sec = 1; tv2.tv_usec = 0; /* 1s */
-    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv2, sizeof(tv2));
-
-    /* Make recvfrom() time out periodically so the command listener
-     * thread can observe `g_cmd_running` and exit cleanly on shutdown. */
-    struct timeval tv;
-    tv.tv_sec = 1; tv.tv_usec = 0; /* 1s */
-    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-
     // Destination addresses (the HUB) - notifications and heartbeats
     memset(&g_dest_notif, 0, sizeof(g_dest_notif));
     g_dest_notif.sin_family = AF_INET;
@@ -231,8 +590,14 @@ bool door_udp_init2(const char *host_ip, uint16_t notif_port, uint16_t hb_port,
     g_mode = mode;
     g_heartbeat_period_ms = heartbeat_period_ms > 0 ? heartbeat_period_ms : 1000;
 
+    pthread_mutex_lock(&g_report_lock);
     g_prev_valid = false;
     g_last_heartbeat_ms = now_ms();
+    g_hub_period_ms = g_hub_jitter_ms = 0;   // the hub resends it after our HELLO
+    g_hb_seed = (unsigned)g_last_heartbeat_ms ^ ((unsigned)getpid() << 16);
+    g_hb_base_ms = g_hb_interval_ms = g_heartbeat_period_ms;
+    g_hb_activity = false;
+    pthread_mutex_unlock(&g_report_lock);
 
     int s = socket(AF_INET, SOCK_DGRAM, 0);
     if (s < 0) {
@@ -291,28 +656,126 @@ bool door_udp_init2(const char *host_ip, uint16_t notif_port, uint16_t hb_port,
         fprintf(stderr, "[door_udp_init2] HELLO sent: %zd bytes\n", sent);
     }
 
-    // Start command listener
-    g_cmd_running = 1;
-    fprintf(stderr, "[door_udp_init2] Creating command listener thread...\n");
-    if (pthread_create(&g_cmd_thread, NULL, door_cmd_thread, NULL) != 0) {
-        perror("[door_udp_init2] pthread_create FAILED");
-        fprintf(stderr, "[door_udp_init2] ERROR: Failed to spawn listener thread\n");
-        g_cmd_running = 0;
+    // Listen for COMMANDs on the reactor loop
+    if (!reactor_start()) {
+        fprintf(stderr, "[door_udp_init2] ERROR: Failed to start the reactor\n");
+        return false;
+    }
+    g_cmd_source = reactor_add_fd(g_sock, EPOLLIN, door_cmd_readable, NULL);
+    if (g_cmd_source < 0) {
+        fprintf(stderr, "[door_udp_init2] ERROR: Failed to register the command listener\n");
+        g_cmd_source = 0;
+        reactor_stop();
         return false;
     }
-    fprintf(stderr, "[door_udp_init2] Command listener thread created successfully\n");
+    fprintf(stderr, "[door_udp_init2] Command listener registered with the reactor\n");
+
+    // EVENTs can be acknowledged now; number them and keep them until they are
+    pthread_mutex_lock(&g_event_lock);
+    if (!event_spool_open(g_event_spool_path))
+        fprintf(stderr, "[door_udp_init2] WARNING: EVENT spool '%s' unavailable, memory only\n",
+                g_event_spool_path);
+    g_event_epoch = ((uint32_t)time(NULL) ^ ((uint32_t)getpid() << 16)) | 1u;
+    g_event_next_seq = 1;
+    g_event_sent_seq = 0;
+    g_event_backoff_ms = EVENT_RETX_MIN_MS;
+    g_event_reliable = true;
+    pthread_mutex_unlock(&g_event_lock);
+    g_event_timer = reactor_add_timer(EVENT_TICK_MS, event_retx_tick, NULL);
+    if (g_event_timer < 0) {
+        fprintf(stderr, "[door_udp_init2] WARNING: no EVENT retransmit timer\n");
+        g_event_timer = 0;
+    }
+
+    // Batch outgoing lines from here on
+    if (g_batch_window_ms > 0) {
+        int id = reactor_add_timer(0, batch_flush_tick, NULL);
+        pthread_mutex_lock(&g_batch_lock);
+        g_batch_timer = id > 0 ? id : 0;
+        g_batch_armed = false;
+        pthread_mutex_unlock(&g_batch_lock);
+        if (id < 0) fprintf(stderr, "[door_udp_init2] WARNING: no batch timer, sending unbatched\n");
+    }
     fprintf(stderr, "[door_udp_init2] INIT COMPLETE: Module listening on port %u\n", notif_port);
 
     return true;
 }
 
-void door_udp_update(bool d0_open, bool d0_locked,
-                     bool d1_open, bool d1_locked)
+// Caller holds g_report_lock.
+static void set_hb_interval_locked(int interval_ms)
+{
+    if (interval_ms == g_hb_interval_ms) return;
+    g_hb_interval_ms = interval_ms;
+    if (g_hb_rate_cb) g_hb_rate_cb(interval_ms, g_hb_rate_ctx);
+}
+
+// Fast rate, never below the hub's floor. Caller holds g_report_lock.
+static int hb_fast_ms_locked(void)
+{
+    return g_hub_period_ms > g_heartbeat_period_ms ? g_hub_period_ms : g_heartbeat_period_ms;
+}
+
+// base_ms plus up to the hub's jitter. Caller holds g_report_lock.
+static int hb_jitter_locked(int base_ms)
+{
+    if (g_hub_jitter_ms <= 0) return base_ms;
+    return base_ms + rand_r(&g_hb_seed) % (g_hub_jitter_ms + 1);
+}
+
+// Something happened: heartbeats go back to the fast rate. Caller holds
+// g_report_lock.
+static void note_activity_locked(void)
+{
+    g_hb_activity = true;
+    int fast = hb_fast_ms_locked();
+    if (g_hb_base_ms == fast) return;   // already there; don't re-jitter the timer
+    g_hb_base_ms = fast;
+    set_hb_interval_locked(hb_jitter_locked(fast));
+}
+
+// Send a HEARTBEAT advertising the interval until the next one, backing
+// off if nothing happened since the last. Caller holds g_report_lock.
+static void send_heartbeat_locked(bool d0_open, bool d1_locked, long long t)
+{
+    int fast = hb_fast_ms_locked();
+    int idle = g_heartbeat_idle_ms > fast ? g_heartbeat_idle_ms : fast;
+    int base = fast;
+    if (!g_hb_activity && idle > fast) {
+        base = g_hb_base_ms * 2;
+        if (base < fast) base = fast;
+        if (base > idle) base = idle;
+    }
+    g_hb_activity = false;
+    g_hb_base_ms = base;
+    int next = hb_jitter_locked(base);
+    set_hb_interval_locked(next);
+
+    /* Keep backwards-compatible comma-separated states so the hub's
+     * parser (which expects "D0=OPEN,LOCKED") continues to work.
+     * Map D0 -> door sensor, D1 -> lock state. For a single-door
+     * module we populate both tokens with the same logical door
+     * + lock pair so existing consumers see both values. */
+    char buf[BUF_MAX];
+    snprintf(buf, sizeof(buf),
+             "%s HEARTBEAT D0=%s,%s D1=%s,%s HB=%d\n",
+             g_module_id,
+             d0_open   ? "OPEN" : "CLOSED",
+             d1_locked ? "LOCKED" : "UNLOCKED",
+             d0_open   ? "OPEN" : "CLOSED",
+             d1_locked ? "LOCKED" : "UNLOCKED",
+             next);
+    send_line_hb(buf);
+    g_last_heartbeat_ms = t;
+}
+
+// Caller holds g_report_lock. force_hb sends the HEARTBEAT now instead
+// of when the interval is up.
+static void update_locked(bool d0_open, bool d0_locked,
+                          bool d1_open, bool d1_locked, bool force_hb)
 {
     if (g_sock < 0) return;
 
     long long t = now_ms();
-    char buf[BUF_MAX];
 
     // First update → send initial heartbeat
     if (!g_prev_valid) {
@@ -325,19 +788,8 @@ void door_udp_update(bool d0_open, bool d0_locked,
         g_last_heartbeat_ms = t;
 
         if (g_mode & DOOR_REPORT_HEARTBEAT) {
-            /* Keep backwards-compatible comma-separated states so the hub's
-             * parser (which expects "D0=OPEN,LOCKED") continues to work.
-             * Map D0 -> door sensor, D1 -> lock state. For a single-door
-             * module we populate both tokens with the same logical door
-             * + lock pair so existing consumers see both values. */
-            snprintf(buf, sizeof(buf),
-                     "%s HEARTBEAT D0=%s,%s D1=%s,%s\n",
-                     g_module_id,
-                     d0_open   ? "OPEN" : "CLOSED",
-                     d1_locked ? "LOCKED" : "UNLOCKED",
-                     d0_open   ? "OPEN" : "CLOSED",
-                     d1_locked ? "LOCKED" : "UNLOCKED");
-            send_line_hb(buf);
+            g_hb_activity = true;   // stay fast while the hub learns our state
+            send_heartbeat_locked(d0_open, d1_locked, t);
         }
         return;
     }
@@ -345,37 +797,21 @@ void door_udp_update(bool d0_open, bool d0_locked,
     // -------- Notifications (state change only) --------
     if (g_mode & DOOR_REPORT_NOTIFICATION) {
         if (d0_open != g_prev_d0_open) {
-            snprintf(buf, sizeof(buf),
-                     "%s EVENT D0 DOOR %s\n",
-                     g_module_id,
-                     d0_open ? "OPEN" : "CLOSED");
-            send_line_notif(buf);
+            send_event(d0_open ? "D0 DOOR OPEN" : "D0 DOOR CLOSED");
+            note_activity_locked();
         }
         /* D0 is sensor-only (door state). D1 is lock-only (lock state).
          * Only emit D0 DOOR events and D1 LOCK events. */
         if (d1_locked != g_prev_d1_locked) {
-            snprintf(buf, sizeof(buf),
-                     "%s EVENT D1 LOCK %s\n",
-                     g_module_id,
-                     d1_locked ? "LOCKED" : "UNLOCKED");
-            send_line_notif(buf);
+            send_event(d1_locked ? "D1 LOCK LOCKED" : "D1 LOCK UNLOCKED");
+            note_activity_locked();
         }
     }
 
     // -------- Periodic heartbeat --------
     if (g_mode & DOOR_REPORT_HEARTBEAT) {
-        if (t - g_last_heartbeat_ms >= g_heartbeat_period_ms) {
-            /* Emit combined D0/D1 tokens for compatibility. Use d0_open
-             * for the door state and d1_locked for the lock state. */
-            snprintf(buf, sizeof(buf),
-                     "%s HEARTBEAT D0=%s,%s D1=%s,%s\n",
-                     g_module_id,
-                     d0_open   ? "OPEN" : "CLOSED",
-                     d1_locked ? "LOCKED" : "UNLOCKED",
-                     d0_open   ? "OPEN" : "CLOSED",
-                     d1_locked ? "LOCKED" : "UNLOCKED");
-            send_line_hb(buf);
-            g_last_heartbeat_ms = t;
+        if (force_hb || t - g_last_heartbeat_ms >= g_hb_interval_ms) {
+            send_heartbeat_locked(d0_open, d1_locked, t);
         }
     }
 
@@ -386,12 +822,117 @@ void door_udp_update(bool d0_open, bool d0_locked,
     g_prev_d1_locked = d1_locked;
 }
 
+void door_udp_update(bool d0_open, bool d0_locked,
+                     bool d1_open, bool d1_locked)
+{
+    pthread_mutex_lock(&g_report_lock);
+    update_locked(d0_open, d0_locked, d1_open, d1_locked, false);
+    pthread_mutex_unlock(&g_report_lock);
+}
+
+static void report_state(const DoorStateSnapshot *s, bool force_hb)
+{
+    pthread_mutex_lock(&g_report_lock);
+    bool open = g_prev_valid && g_prev_d0_open;
+    bool locked = g_prev_valid && g_prev_d1_locked;
+    // Callers read the record and get here in either order; reporting an
+    // older snapshot after a newer one would send its EVENTs backwards,
+    // so that one only gets the previous state's HEARTBEAT.
+    if (!g_prev_valid || s->version >= g_prev_version) {
+        // An unsettled sensor keeps the last reported door state
+        if (s->door != DISTANCE_UNKNOWN) open = s->door == DISTANCE_FAR;
+        locked = s->locked;
+        g_prev_version = s->version;
+    }
+    update_locked(open, false, false, locked, force_hb);
+    pthread_mutex_unlock(&g_report_lock);
+}
+
+void door_udp_set_heartbeat_idle(int idle_ms)
+{
+    pthread_mutex_lock(&g_report_lock);
+    g_heartbeat_idle_ms = idle_ms;
+    pthread_mutex_unlock(&g_report_lock);
+}
+
+void door_udp_set_heartbeat_rate_callback(DoorHeartbeatRateFn fn, void *ctx)
+{
+    pthread_mutex_lock(&g_report_lock);
+    g_hb_rate_cb = fn;
+    g_hb_rate_ctx = ctx;
+    pthread_mutex_unlock(&g_report_lock);
+}
+
+int door_udp_heartbeat_interval(void)
+{
+    pthread_mutex_lock(&g_report_lock);
+    int ms = g_hb_interval_ms;
+    pthread_mutex_unlock(&g_report_lock);
+    return ms;
+}
+
+void door_udp_update_state(const DoorStateSnapshot *s)
+{
+    if (s) report_state(s, false);
+}
+
+void door_udp_heartbeat(const DoorStateSnapshot *s)
+{
+    if (s) report_state(s, true);
+}
+
+void door_udp_set_event_spool(const char *path)
+{
+    pthread_mutex_lock(&g_event_lock);
+    snprintf(g_event_spool_path, sizeof(g_event_spool_path), "%s", path ? path : "");
+    pthread_mutex_unlock(&g_event_lock);
+}
+
+int door_udp_events_pending(void)
+{
+    pthread_mutex_lock(&g_event_lock);
+    int n = g_event_reliable ? event_spool_pending() : 0;
+    pthread_mutex_unlock(&g_event_lock);
+    return n;
+}
+
+void door_udp_set_batch_window(int window_ms)
+{
+    pthread_mutex_lock(&g_batch_lock);
+    g_batch_window_ms = window_ms > 0 ? window_ms : 0;
+    pthread_mutex_unlock(&g_batch_lock);
+}
+
 void door_udp_close(void)
 {
-    // Stop command listener first so the thread can exit on its recv timeout.
-    if (g_cmd_running) {
-        g_cmd_running = 0;
-        pthread_join(g_cmd_thread, NULL);
+    // Stop batching and send whatever is still waiting
+    pthread_mutex_lock(&g_batch_lock);
+    int batch_timer = g_batch_timer;
+    g_batch_timer = 0;
+    g_batch_armed = false;
+    batch_flush_locked(&g_batch_hb);
+    batch_flush_locked(&g_batch_notif);
+    pthread_mutex_unlock(&g_batch_lock);
+    if (batch_timer > 0) reactor_remove(batch_timer);
+
+    if (g_event_timer > 0) {
+        reactor_remove(g_event_timer);
+        g_event_timer = 0;
+    }
+    pthread_mutex_lock(&g_event_lock);
+    if (g_event_reliable) {
+        int left = event_spool_pending();
+        if (left > 0) fprintf(stderr, "[door_udp] closing with %d unacknowledged EVENTs\n", left);
+        event_spool_close();
+        g_event_reliable = false;
+    }
+    pthread_mutex_unlock(&g_event_lock);
+
+    // Unregister the command listener before the socket goes away
+    if (g_cmd_source > 0) {
+        reactor_remove(g_cmd_source);
+        g_cmd_source = 0;
+        reactor_stop();
     }
 
     if (g_sock >= 0) {
@@ -400,5 +941,11 @@ void door_udp_close(void)
     }
 
     g_dest_len = 0;
+    pthread_mutex_lock(&g_report_lock);
     g_prev_valid = false;
+    pthread_mutex_unlock(&g_report_lock);
+
+    pthread_mutex_lock(&g_cmd_cache_lock);
+    memset(g_cmd_cache, 0, sizeof(g_cmd_cache));
+    pthread_mutex_unlock(&g_cmd_cache_lock);
 }
@@ -0,0 +1,134 @@
+// event_spool.c
+// Ring of in-flight EVENT lines with a spill file behind it; see
+// event_spool.h.
+#define _POSIX_C_SOURCE 200809L
+#include "hal/event_spool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static EventSpoolEntry g_ring[EVENT_SPOOL_RING];
+static int   g_head = 0, g_len = 0;
+static FILE *g_file = NULL;        // NULL: memory only
+static char *g_path = NULL;
+static long  g_read_off = 0;       // next spilled line to read back
+static int   g_spilled = 0;        // lines in the file not read back yet
+static uint32_t g_last_seq = 0;    // newest seq in the ring
+
+bool event_spool_open(const char *path)
+{
+    event_spool_close();
+    if (!path || !path[0]) return true;
+
+    g_file = fopen(path, "w+");
+    if (!g_file) {
+        perror("event_spool: fopen");
+        return false;
+    }
+    g_path = strdup(path);
+    return true;
+}
+
+void event_spool_close(void)
+{
+    if (g_file) {
+        fclose(g_file);
+        g_file = NULL;
+        if (g_path) unlink(g_path);
+    }
+    free(g_path);
+    g_path = NULL;
+    g_head = g_len = 0;
+    g_read_off = 0;
+    g_spilled = 0;
+    g_last_seq = 0;
+}
+
+static void ring_push(uint32_t seq, const char *line)
+{
+    EventSpoolEntry *e = &g_ring[(g_head + g_len) % EVENT_SPOOL_RING];
+    e->seq = seq;
+    snprintf(e->line, sizeof(e->line), "%s", line);
+    g_len++;
+    g_last_seq = seq;
+}
+
+EventSpoolResult event_spool_push(uint32_t seq, const char *line)
+{
+    if (!line) return EVENT_SPOOL_FULL;
+    // Keep order: nothing jumps ahead of what is already in the file
+    if (g_len < EVENT_SPOOL_RING && g_spilled == 0) {
+        ring_push(seq, line);
+        return EVENT_SPOOL_QUEUED;
+    }
+    if (!g_file || g_spilled >= EVENT_SPOOL_MAX_SPILLED) return EVENT_SPOOL_FULL;
+
+    // Lines end in '\n' already; the file needs exactly one per record
+    size_t n = strcspn(line, "\n");
+    long end = fseek(g_file, 0, SEEK_END) == 0 ? ftell(g_file) : -1;
+    if (end < 0 || fprintf(g_file, "%u %.*s\n", seq, (int)n, line) < 0 || fflush(g_file) != 0) {
+        perror("event_spool: write");
+        // Don't leave half a record for the next one to be appended to
+        if (end >= 0 && ftruncate(fileno(g_file), end) != 0) perror("event_spool: truncate");
+        clearerr(g_file);
+        return EVENT_SPOOL_FULL;
+    }
+    g_spilled++;
+    return EVENT_SPOOL_SPILLED;
+}
+
+// Move spilled lines into free ring slots. Spilled seqs follow on from the
+// ring's one by one, so a record that doesn't read back whole still takes
+// its seq, as an empty placeholder: skipping it would leave a gap the hub
+// waits on forever.
+static void refill(void)
+{
+    if (!g_file || g_spilled == 0 || g_len == EVENT_SPOOL_RING) return;
+    if (fseek(g_file, g_read_off, SEEK_SET) != 0) return;
+
+    char buf[EVENT_SPOOL_LINE_MAX + 16];
+    while (g_len < EVENT_SPOOL_RING && g_spilled > 0 && fgets(buf, sizeof(buf), g_file)) {
+        g_spilled--;
+        char *end = NULL;
+        unsigned long seq = strtoul(buf, &end, 10);
+        if (end == buf || *end != ' ' || !strchr(end, '\n') || seq != g_last_seq + 1) {
+            fprintf(stderr, "event_spool: torn record, placeholder for seq %u\n", g_last_seq + 1);
+            ring_push(g_last_seq + 1, "");
+            continue;
+        }
+        ring_push((uint32_t)seq, end + 1);
+    }
+    g_read_off = ftell(g_file);
+
+    if (g_spilled == 0) {
+        // All read back: start the file over
+        if (ftruncate(fileno(g_file), 0) == 0) g_read_off = 0;
+        rewind(g_file);
+    }
+}
+
+int event_spool_ack(uint32_t seq)
+{
+    int dropped = 0;
+    while (g_len > 0 && g_ring[g_head].seq <= seq) {
+        g_head = (g_head + 1) % EVENT_SPOOL_RING;
+        g_len--;
+        dropped++;
+    }
+    if (dropped > 0) refill();
+    return dropped;
+}
+
+int event_spool_window(EventSpoolEntry *out, int max)
+{
+    int n = g_len < max ? g_len : max;
+    for (int i = 0; i < n; i++) out[i] = g_ring[(g_head + i) % EVENT_SPOOL_RING];
+    return n;
+}
+
+int event_spool_pending(void)
+{
+    return g_len + g_spilled;
+}
@@ -0,0 +1,476 @@
+// hub_local.c
+#define _POSIX_C_SOURCE 200809L
+#include "hal/hub_local.h"
+#include "hal/hub_udp.h"
+#include "hal/timing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define LOCAL_MAX_CLIENTS   8
+#define LOCAL_QUEUE_LEN     64
+#define LOCAL_HIGH_WATER    (LOCAL_QUEUE_LEN / 2)
+#define LOCAL_MAX_PENDING   64
+#define LOCAL_PENDING_TTL_MS 30000
+
+// Subscription bits
+enum {
+    SUB_HELLO     = 1 << 0,
+    SUB_HEARTBEAT = 1 << 1,
+    SUB_EVENT     = 1 << 2,
+    SUB_FEEDBACK  = 1 << 3,
+    SUB_OTHER     = 1 << 4,
+    SUB_ALL       = 0x1f
+};
+
+typedef struct {
+    int      fd;            // -1 if slot unused
+    unsigned gen;           // bumped every time the slot is reused
+    unsigned subs;
+    bool     kill;          // disconnect requested by publisher
+    char     q[LOCAL_QUEUE_LEN][HUB_LINE_LEN];
+    uint16_t q_len[LOCAL_QUEUE_LEN];
+    int      q_head;
+    int      q_count;
+    unsigned long dropped;
+} LocalClient;
+
+// Clients number their commands themselves; on the wire they carry a
+// hub-issued cmdid instead, and FEEDBACK is renumbered on the way back.
+typedef struct {
+    char      module_id[HUB_MODULE_ID_LEN];
+    int       cmdid;        // hub-side id; 0 = free
+    int       client_cmdid; // the client's own id for it
+    int       client;
+    unsigned  gen;
+    long long issued_ms;
+} LocalPending;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static LocalClient  g_clients[LOCAL_MAX_CLIENTS];
+static LocalPending g_pending[LOCAL_MAX_PENDING];
+static int          g_listen_fd = -1;
+static int          g_wake_fd   = -1;
+static pthread_t    g_thread;
+static volatile int g_running   = 0;
+static char         g_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+// ---------- helpers ----------
+
+static unsigned sub_bit_for(const char *type)
+{
+    if (strcmp(type, "HELLO") == 0)     return SUB_HELLO;
+    if (strcmp(type, "HEARTBEAT") == 0) return SUB_HEARTBEAT;
+    if (strcmp(type, "EVENT") == 0)     return SUB_EVENT;
+    if (strcmp(type, "FEEDBACK") == 0)  return SUB_FEEDBACK;
+    if (strcmp(type, "ALL") == 0)       return SUB_ALL;
+    return SUB_OTHER;
+}
+
+static void wake_thread(void)
+{
+    uint64_t one = 1;
+    if (g_wake_fd >= 0 && write(g_wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("[hub_local] eventfd write");
+    }
+}
+
+// Try to push queued lines to the client. Caller holds g_lock.
+static void flush_client(LocalClient *c)
+{
+    while (c->q_count > 0) {
+        ssize_t n = send(c->fd, c->q[c->q_head], c->q_len[c->q_head],
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return;
+            c->kill = true;
+            return;
+        }
+        c->q_head = (c->q_head + 1) % LOCAL_QUEUE_LEN;
+        c->q_count--;
+    }
+}
+
+// Queue one line for a client. Caller holds g_lock.
+// Lossy lines are dropped when the queue is full; for reliable lines the
+// client is disconnected instead.
+static void enqueue_line(LocalClient *c, const char *line, size_t len, bool reliable)
+{
+    if (c->fd < 0 || c->kill) return;
+    if (len >= HUB_LINE_LEN) len = HUB_LINE_LEN - 1;
+
+    if (c->q_count == 0) {
+        ssize_t n = send(c->fd, line, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n >= 0) return;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) { c->kill = true; return; }
+    }
+
+    if (c->q_count == LOCAL_QUEUE_LEN) {
+        c->dropped++;
+        if (reliable) {
+            fprintf(stderr, "[hub_local] client fd=%d too slow; disconnecting\n", c->fd);
+            c->kill = true;
+        }
+        return;
+    }
+    int slot = (c->q_head + c->q_count) % LOCAL_QUEUE_LEN;
+    memcpy(c->q[slot], line, len);
+    c->q_len[slot] = (uint16_t)len;
+    c->q_count++;
+}
+
+static void close_client(int idx)
+{
+    LocalClient *c = &g_clients[idx];
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+    c->kill = false;
+    c->q_count = 0;
+    c->subs = 0;
+    for (int i = 0; i < LOCAL_MAX_PENDING; i++) {
+        if (g_pending[i].cmdid != 0 && g_pending[i].client == idx) g_pending[i].cmdid = 0;
+    }
+}
+
+static void register_pending(const char *module_id, int cmdid, int client_cmdid,
+                             int client)
+{
+    long long now = getTimeInMs();
+    int slot = -1;
+    for (int i = 0; i < LOCAL_MAX_PENDING; i++) {
+        if (g_pending[i].cmdid == 0 || now - g_pending[i].issued_ms > LOCAL_PENDING_TTL_MS) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || g_pending[i].issued_ms < g_pending[slot].issued_ms) slot = i;
+    }
+    LocalPending *p = &g_pending[slot];
+    snprintf(p->module_id, sizeof(p->module_id), "%s", module_id);
+    p->cmdid = cmdid;
+    p->client_cmdid = client_cmdid;
+    p->client = client;
+    p->gen = g_clients[client].gen;
+    p->issued_ms = now;
+}
+
+// ---------- client requests ----------
+
+static void handle_client_packet(int idx, char *pkt)
+{
+    char raw[HUB_LINE_LEN];
+    snprintf(raw, sizeof(raw), "%s", pkt);
+
+    char *save = NULL;
+    char *first = strtok_r(pkt, " \t\r\n", &save);
+    if (!first) return;
+
+    if (strcmp(first, "SUBSCRIBE") == 0) {
+        char *tok;
+        pthread_mutex_lock(&g_lock);
+        while ((tok = strtok_r(NULL, " \t\r\n,", &save)) != NULL) {
+            g_clients[idx].subs |= sub_bit_for(tok);
+        }
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+    if (strcmp(first, "UNSUBSCRIBE") == 0) {
+        pthread_mutex_lock(&g_lock);
+        g_clients[idx].subs = 0;
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+
+    char *type    = strtok_r(NULL, " \t\r\n", &save);
+    char *cmdid_s = strtok_r(NULL, " \t\r\n", &save);
+    if (!type || strcmp(type, "COMMAND") != 0 || !cmdid_s) {
+        fprintf(stderr, "[hub_local] ignoring packet from client: '%s'\n", raw);
+        return;
+    }
+    int cmdid = atoi(cmdid_s);
+    int hub_cmdid = hub_udp_alloc_cmdid();
+
+    // Same line with the hub's cmdid; it must end in a newline like the
+    // UDP protocol
+    const char *rest = raw + (cmdid_s - pkt) + strlen(cmdid_s);
+    char fwd[HUB_LINE_LEN];
+    int len = snprintf(fwd, sizeof(fwd), "%s COMMAND %d%s", first, hub_cmdid, rest);
+    if (len > 0 && (size_t)len < sizeof(fwd) - 1 && fwd[len - 1] != '\n') {
+        fwd[len] = '\n';
+        fwd[len + 1] = '\0';
+    }
+
+    pthread_mutex_lock(&g_lock);
+    register_pending(first, hub_cmdid, cmdid, idx);
+    pthread_mutex_unlock(&g_lock);
+
+    if (!hub_udp_forward_raw(first, fwd)) {
+        char err[HUB_LINE_LEN];
+        int n = snprintf(err, sizeof(err), "%s ERROR %d no_route\n", first, cmdid);
+        pthread_mutex_lock(&g_lock);
+        for (int i = 0; i < LOCAL_MAX_PENDING; i++) {
+            if (g_pending[i].cmdid == hub_cmdid) g_pending[i].cmdid = 0;
+        }
+        enqueue_line(&g_clients[idx], err, (size_t)n, true);
+        pthread_mutex_unlock(&g_lock);
+    }
+}
+
+// ---------- listener thread ----------
+
+static void accept_client(void)
+{
+    int fd = accept(g_listen_fd, NULL, NULL);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < LOCAL_MAX_CLIENTS; i++) {
+        if (g_clients[i].fd < 0) {
+            g_clients[i].fd = fd;
+            g_clients[i].gen++;
+            g_clients[i].subs = 0;
+            g_clients[i].q_head = g_clients[i].q_count = 0;
+            g_clients[i].dropped = 0;
+            g_clients[i].kill = false;
+            pthread_mutex_unlock(&g_lock);
+            fprintf(stderr, "[hub_local] client connected (slot %d)\n", i);
+            return;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    fprintf(stderr, "[hub_local] too many clients; rejecting connection\n");
+    close(fd);
+}
+
+static void *local_thread(void *arg)
+{
+    (void)arg;
+    struct pollfd pfds[2 + LOCAL_MAX_CLIENTS];
+    int client_of[2 + LOCAL_MAX_CLIENTS];
+
+    while (g_running) {
+        int n = 0;
+        pfds[n] = (struct pollfd){ .fd = g_listen_fd, .events = POLLIN };
+        client_of[n++] = -1;
+        pfds[n] = (struct pollfd){ .fd = g_wake_fd, .events = POLLIN };
+        client_of[n++] = -1;
+
+        pthread_mutex_lock(&g_lock);
+        for (int i = 0; i < LOCAL_MAX_CLIENTS; i++) {
+            LocalClient *c = &g_clients[i];
+            if (c->fd < 0) continue;
+            if (c->kill) { close_client(i); continue; }
+            short ev = 0;
+            if (c->q_count < LOCAL_HIGH_WATER) ev |= POLLIN;  // backpressure
+            if (c->q_count > 0) ev |= POLLOUT;
+            pfds[n] = (struct pollfd){ .fd = c->fd, .events = ev };
+            client_of[n++] = i;
+        }
+        pthread_mutex_unlock(&g_lock);
+
+        int r = poll(pfds, (nfds_t)n, 1000);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            perror("[hub_local] poll");
+            sleepForMs(10);
+            continue;
+        }
+        if (r == 0) continue;
+
+        if (pfds[1].revents & POLLIN) {
+            uint64_t v;
+            if (read(g_wake_fd, &v, sizeof(v)) < 0 && errno != EAGAIN) perror("[hub_local] eventfd read");
+        }
+        if (pfds[0].revents & POLLIN) accept_client();
+
+        for (int k = 2; k < n; k++) {
+            int idx = client_of[k];
+            short rev = pfds[k].revents;
+            if (!rev) continue;
+
+            if (rev & POLLOUT) {
+                pthread_mutex_lock(&g_lock);
+                flush_client(&g_clients[idx]);
+                pthread_mutex_unlock(&g_lock);
+            }
+            if (rev & POLLIN) {
+                char pkt[HUB_LINE_LEN];
+                ssize_t len = recv(pfds[k].fd, pkt, sizeof(pkt) - 1, MSG_DONTWAIT);
+                if (len > 0) {
+                    pkt[len] = '\0';
+                    handle_client_packet(idx, pkt);
+                } else if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    rev |= POLLHUP;
+                }
+            }
+            if (rev & (POLLHUP | POLLERR | POLLNVAL)) {
+                pthread_mutex_lock(&g_lock);
+                fprintf(stderr, "[hub_local] client disconnected (slot %d, %lu dropped)\n",
+                        idx, g_clients[idx].dropped);
+                close_client(idx);
+                pthread_mutex_unlock(&g_lock);
+            }
+        }
+    }
+    return NULL;
+}
+
+// ---------- public API ----------
+
+void hub_local_publish(const char *raw)
+{
+    if (!g_running || !raw) return;
+
+    char tmp[HUB_LINE_LEN];
+    snprintf(tmp, sizeof(tmp), "%s", raw);
+    char *save = NULL;
+    char *mod  = strtok_r(tmp, " \t\r\n", &save);
+    char *type = mod ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+    if (!type || strcmp(type, "COMMAND") == 0) return;
+
+    unsigned bit = sub_bit_for(type);
+    bool reliable = (bit == SUB_EVENT || bit == SUB_FEEDBACK);
+    size_t len = strlen(raw);
+
+    int owner = -1;
+    char owned[HUB_LINE_LEN];   // the FEEDBACK under the owner's cmdid
+    size_t owned_len = 0;
+    pthread_mutex_lock(&g_lock);
+    if (bit == SUB_FEEDBACK) {
+        char *cmdid_s = strtok_r(NULL, " \t\r\n", &save);
+        int cmdid = cmdid_s ? atoi(cmdid_s) : 0;
+        const char *rest = cmdid_s ? raw + (cmdid_s - tmp) + strlen(cmdid_s) : "";
+        // ACCEPTED is routed but keeps the entry for COMPLETED/FAILED
+        char *target = strtok_r(NULL, " \t\r\n", &save);
+        char *phase  = target ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+        bool accepted = phase && strcmp(phase, "ACCEPTED") == 0;
+        for (int i = 0; i < LOCAL_MAX_PENDING; i++) {
+            LocalPending *p = &g_pending[i];
+            if (p->cmdid == cmdid && cmdid != 0 &&
+                strncmp(p->module_id, mod, HUB_MODULE_ID_LEN) == 0) {
+                if (g_clients[p->client].fd >= 0 && g_clients[p->client].gen == p->gen) {
+                    owner = p->client;
+                    int n = snprintf(owned, sizeof(owned), "%s FEEDBACK %d%s",
+                                     mod, p->client_cmdid, rest);
+                    owned_len = n < 0 ? 0 : (size_t)n;
+                }
+                if (!accepted) p->cmdid = 0;
+                break;
+            }
+        }
+    }
+
+    bool need_wake = false;
+    for (int i = 0; i < LOCAL_MAX_CLIENTS; i++) {
+        LocalClient *c = &g_clients[i];
+        if (c->fd < 0) continue;
+        if (i == owner) enqueue_line(c, owned, owned_len, reliable);
+        else if (c->subs & bit) enqueue_line(c, raw, len, reliable);
+        else continue;
+        if (c->q_count > 0 || c->kill) need_wake = true;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (need_wake) wake_thread();
+}
+
+bool hub_local_init(const char *path)
+{
+    if (g_running) return false;
+    if (!path) path = HUB_LOCAL_DEFAULT_PATH;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[hub_local] socket path too long: %s\n", path);
+        return false;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        perror("[hub_local] socket");
+        return false;
+    }
+    unlink(path);  // stale socket from a previous run
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        perror("[hub_local] bind/listen");
+        close(fd);
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    g_wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (g_wake_fd < 0) {
+        perror("[hub_local] eventfd");
+        close(fd);
+        unlink(path);
+        return false;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < LOCAL_MAX_CLIENTS; i++) g_clients[i].fd = -1;
+    memset(g_pending, 0, sizeof(g_pending));
+    pthread_mutex_unlock(&g_lock);
+
+    g_listen_fd = fd;
+    snprintf(g_path, sizeof(g_path), "%s", path);
+    g_running = 1;
+    if (pthread_create(&g_thread, NULL, local_thread, NULL) != 0) {
+        perror("[hub_local] pthread_create");
+        g_running = 0;
+        close(g_wake_fd); g_wake_fd = -1;
+        close(g_listen_fd); g_listen_fd = -1;
+        unlink(path);
+        return false;
+    }
+    fprintf(stderr, "[hub_local] listening on %s (SOCK_SEQPACKET)\n", path);
+    return true;
+}
+
+void hub_local_shutdown(void)
+{
+    if (!g_running) return;
+    g_running = 0;
+    wake_thread();
+    pthread_join(g_thread, NULL);
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < LOCAL_MAX_CLIENTS; i++) {
+        if (g_clients[i].fd >= 0) close_client(i);
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    close(g_listen_fd); g_listen_fd = -1;
+    close(g_wake_fd);   g_wake_fd = -1;
+    unlink(g_path);
+}
+
+int hub_local_connect(const char *path)
+{
+    if (!path) path = HUB_LOCAL_DEFAULT_PATH;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
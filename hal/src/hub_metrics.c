@@ -0,0 +1,213 @@
+// hub_metrics.c
+#include "hal/hub_metrics.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// Max threads with a private shard. Threads beyond this share the last
+// shard (still correct, just contended).
+#define HUB_METRICS_MAX_SHARDS 16
+
+// Histogram upper bounds in microseconds; one extra bucket for +Inf.
+static const long long k_bucket_le_us[] = {
+    10, 50, 100, 500, 1000, 5000, 10000, 50000,
+    100000, 500000, 1000000, 5000000
+};
+#define HUB_HIST_BUCKETS ((int)(sizeof(k_bucket_le_us) / sizeof(k_bucket_le_us[0])) + 1)
+
+typedef struct {
+    atomic_uint_fast64_t buckets[HUB_HIST_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t sum_us;
+} HistShard;
+
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t datagrams[HUB_METRIC_PORT_COUNT][HUB_METRIC_MSG_COUNT];
+    atomic_uint_fast64_t counters[HUB_CTR_COUNT];
+    HistShard hists[HUB_HIST_COUNT];
+} MetricShard;
+
+static MetricShard       g_shards[HUB_METRICS_MAX_SHARDS];
+static atomic_int        g_num_shards = 0;
+static _Thread_local MetricShard *t_shard = NULL;
+
+static const char *k_port_names[HUB_METRIC_PORT_COUNT] = { "notif", "heartbeat" };
+static const char *k_msg_names[HUB_METRIC_MSG_COUNT] = {
+    "HELLO", "HEARTBEAT", "EVENT", "FEEDBACK", "COMMAND", "OTHER"
+};
+
+static const struct { const char *name; const char *help; } k_counters[HUB_CTR_COUNT] = {
+    { "hub_parse_errors_total",          "Datagrams that could not be parsed" },
+    { "hub_commands_sent_total",         "Commands issued by hub_udp_send_command()" },
+    { "hub_command_retries_total",       "Command retransmissions after an ACK timeout" },
+    { "hub_commands_acked_total",        "Commands acknowledged by an ACCEPTED (or outcome) FEEDBACK" },
+    { "hub_commands_failed_total",       "Commands that were not acknowledged, failed or timed out" },
+    { "hub_discord_sent_total",          "Discord webhook deliveries that succeeded" },
+    { "hub_discord_failures_total",      "Discord webhook deliveries that failed" },
+    { "hub_discord_rate_limited_total",  "Discord webhook requests answered with 429 and requeued" },
+    { "hub_discord_coalesced_total",     "Alerts merged into an already pending webhook message" },
+    { "hub_history_writes_total",        "Entries written to the history ring" },
+    { "hub_history_overwrites_total",    "History entries overwritten before being read out" },
+    { "hub_rate_configs_sent_total",     "CONFIG RATE heartbeat floors sent to modules" },
+    { "hub_event_duplicates_total",      "Sequenced EVENTs dropped as already applied" },
+    { "hub_event_gaps_total",            "Sequenced EVENTs dropped because an earlier one is missing" },
+    { "hub_events_lost_total",           "EVENT LOST placeholders for records a module's spool lost" },
+    { "hub_event_acks_sent_total",       "Cumulative EVENT ACKs sent to modules" },
+    { "hub_multi_record_datagrams_total", "Datagrams that carried more than one line" },
+};
+
+static const struct { const char *name; const char *help; } k_hists[HUB_HIST_COUNT] = {
+    { "hub_ingest_apply_seconds",        "Datagram receive to state applied" },
+    { "hub_mutex_wait_seconds",          "Time spent waiting to acquire the hub state mutex" },
+    { "hub_mutex_hold_seconds",          "Time the hub state mutex was held" },
+    { "hub_command_rtt_seconds",         "Command send to COMPLETED feedback" },
+    { "hub_discord_latency_seconds",     "Discord webhook request latency" },
+};
+
+static MetricShard *my_shard(void)
+{
+    if (!t_shard) {
+        int idx = atomic_fetch_add(&g_num_shards, 1);
+        if (idx >= HUB_METRICS_MAX_SHARDS) idx = HUB_METRICS_MAX_SHARDS - 1;
+        t_shard = &g_shards[idx];
+    }
+    return t_shard;
+}
+
+static int shard_count(void)
+{
+    int n = atomic_load(&g_num_shards);
+    return n > HUB_METRICS_MAX_SHARDS ? HUB_METRICS_MAX_SHARDS : n;
+}
+
+// ---------- recording (hot path) ----------
+
+HubMetricMsgType hub_metrics_msg_type(const char *type)
+{
+    if (!type) return HUB_METRIC_MSG_OTHER;
+    for (int i = 0; i < HUB_METRIC_MSG_OTHER; i++) {
+        if (strcmp(type, k_msg_names[i]) == 0) return (HubMetricMsgType)i;
+    }
+    return HUB_METRIC_MSG_OTHER;
+}
+
+void hub_metrics_count_datagram(HubMetricPort port, HubMetricMsgType type)
+{
+    if (port >= HUB_METRIC_PORT_COUNT || type >= HUB_METRIC_MSG_COUNT) return;
+    atomic_fetch_add_explicit(&my_shard()->datagrams[port][type], 1, memory_order_relaxed);
+}
+
+void hub_metrics_add(HubCounter ctr, uint64_t n)
+{
+    if (ctr >= HUB_CTR_COUNT) return;
+    atomic_fetch_add_explicit(&my_shard()->counters[ctr], n, memory_order_relaxed);
+}
+
+void hub_metrics_inc(HubCounter ctr)
+{
+    hub_metrics_add(ctr, 1);
+}
+
+void hub_metrics_observe(HubHistogram hist, long long value_us)
+{
+    if (hist >= HUB_HIST_COUNT) return;
+    if (value_us < 0) value_us = 0;
+
+    int b = 0;
+    while (b < HUB_HIST_BUCKETS - 1 && value_us > k_bucket_le_us[b]) b++;
+
+    HistShard *h = &my_shard()->hists[hist];
+    atomic_fetch_add_explicit(&h->buckets[b], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_us, (uint64_t)value_us, memory_order_relaxed);
+}
+
+// ---------- rendering (scrape path) ----------
+
+typedef struct {
+    char  *buf;
+    size_t cap;
+    size_t len;   // bytes needed so far (may exceed cap)
+} Out;
+
+static void out_printf(Out *o, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    size_t room = (o->len < o->cap) ? o->cap - o->len : 0;
+    int n = vsnprintf(room ? o->buf + o->len : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n > 0) o->len += (size_t)n;
+}
+
+static uint64_t sum_datagrams(int port, int type)
+{
+    uint64_t v = 0;
+    for (int s = 0; s < shard_count(); s++)
+        v += atomic_load_explicit(&g_shards[s].datagrams[port][type], memory_order_relaxed);
+    return v;
+}
+
+static uint64_t sum_counter(int ctr)
+{
+    uint64_t v = 0;
+    for (int s = 0; s < shard_count(); s++)
+        v += atomic_load_explicit(&g_shards[s].counters[ctr], memory_order_relaxed);
+    return v;
+}
+
+static void render_histogram(Out *o, int hist)
+{
+    uint64_t buckets[HUB_HIST_BUCKETS] = {0};
+    uint64_t count = 0, sum_us = 0;
+    for (int s = 0; s < shard_count(); s++) {
+        HistShard *h = &g_shards[s].hists[hist];
+        for (int b = 0; b < HUB_HIST_BUCKETS; b++)
+            buckets[b] += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+        count  += atomic_load_explicit(&h->count, memory_order_relaxed);
+        sum_us += atomic_load_explicit(&h->sum_us, memory_order_relaxed);
+    }
+
+    const char *name = k_hists[hist].name;
+    out_printf(o, "# HELP %s %s\n# TYPE %s histogram\n", name, k_hists[hist].help, name);
+    uint64_t cumulative = 0;
+    for (int b = 0; b < HUB_HIST_BUCKETS - 1; b++) {
+        cumulative += buckets[b];
+        out_printf(o, "%s_bucket{le=\"%g\"} %llu\n", name,
+                   (double)k_bucket_le_us[b] / 1e6, (unsigned long long)cumulative);
+    }
+    cumulative += buckets[HUB_HIST_BUCKETS - 1];
+    out_printf(o, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+    out_printf(o, "%s_sum %.6f\n", name, (double)sum_us / 1e6);
+    out_printf(o, "%s_count %llu\n", name, (unsigned long long)count);
+}
+
+size_t hub_metrics_render(char *buf, size_t cap)
+{
+    Out o = { .buf = buf, .cap = cap, .len = 0 };
+
+    out_printf(&o, "# HELP hub_datagrams_received_total Datagrams received by port and message type\n"
+                   "# TYPE hub_datagrams_received_total counter\n");
+    for (int p = 0; p < HUB_METRIC_PORT_COUNT; p++) {
+        for (int t = 0; t < HUB_METRIC_MSG_COUNT; t++) {
+            out_printf(&o, "hub_datagrams_received_total{port=\"%s\",type=\"%s\"} %llu\n",
+                       k_port_names[p], k_msg_names[t],
+                       (unsigned long long)sum_datagrams(p, t));
+        }
+    }
+
+    for (int c = 0; c < HUB_CTR_COUNT; c++) {
+        out_printf(&o, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                   k_counters[c].name, k_counters[c].help, k_counters[c].name,
+                   k_counters[c].name, (unsigned long long)sum_counter(c));
+    }
+
+    for (int h = 0; h < HUB_HIST_COUNT; h++) {
+        render_histogram(&o, h);
+    }
+
+    if (cap > 0) buf[(o.len < cap) ? o.len : cap - 1] = '\0';
+    return o.len;
+}
@@ -0,0 +1,250 @@
+// hub_shm.c
+#define _POSIX_C_SOURCE 200809L
+#include "hal/hub_shm.h"
+#include "hal/timing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HUB_SHM_SIZE (sizeof(HubShmHeader) + HUB_MAX_DOORS * sizeof(HubShmRecord))
+#define HUB_SHM_READ_SPINS 1000   // busy retries before backing off
+
+_Static_assert(sizeof(HubShmHeader) == 64, "HubShmHeader layout changed");
+_Static_assert(sizeof(HubShmRecord) % 64 == 0, "HubShmRecord must be cache-line sized");
+
+static HubShmHeader *g_hdr = NULL;
+static HubShmRecord *g_records = NULL;
+
+// ---------- writer ----------
+
+bool hub_shm_create(void)
+{
+    if (g_hdr) return true;
+
+    shm_unlink(HUB_SHM_NAME);  // stale table from a previous run
+    int fd = shm_open(HUB_SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("[hub_shm] shm_open");
+        return false;
+    }
+    if (ftruncate(fd, (off_t)HUB_SHM_SIZE) < 0) {
+        perror("[hub_shm] ftruncate");
+        close(fd);
+        shm_unlink(HUB_SHM_NAME);
+        return false;
+    }
+    void *p = mmap(NULL, HUB_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror("[hub_shm] mmap");
+        shm_unlink(HUB_SHM_NAME);
+        return false;
+    }
+
+    // ftruncate zero-fills, so every record starts at seq 0 / unknown
+    g_hdr = p;
+    g_records = (HubShmRecord *)((char *)p + sizeof(HubShmHeader));
+    g_hdr->version     = HUB_SHM_VERSION;
+    g_hdr->header_size = sizeof(HubShmHeader);
+    g_hdr->record_size = sizeof(HubShmRecord);
+    g_hdr->max_records = HUB_MAX_DOORS;
+    g_hdr->writer_pid  = (int32_t)getpid();
+    atomic_store_explicit(&g_hdr->num_records, 0, memory_order_relaxed);
+    // magic last: a reader that sees it sees a complete header
+    atomic_thread_fence(memory_order_release);
+    g_hdr->magic = HUB_SHM_MAGIC;
+
+    fprintf(stderr, "[hub_shm] status table at /dev/shm%s (%zu bytes)\n",
+            HUB_SHM_NAME, (size_t)HUB_SHM_SIZE);
+    return true;
+}
+
+void hub_shm_publish(int index, const HubDoorStatus *st)
+{
+    if (!g_hdr || !st || index < 0 || index >= HUB_MAX_DOORS) return;
+
+    HubShmRecord *r = &g_records[index];
+    uint32_t seq = atomic_load_explicit(&r->seq, memory_order_relaxed);
+    atomic_store_explicit(&r->seq, seq + 1, memory_order_relaxed);  // odd: writing
+    atomic_thread_fence(memory_order_release);
+
+    r->known     = st->known;
+    r->offline   = st->offline;
+    r->d0_open   = st->d0_open;
+    r->d0_locked = st->d0_locked;
+    r->d1_open   = st->d1_open;
+    r->d1_locked = st->d1_locked;
+    r->has_last_addr = st->has_last_addr ? 1 : 0;
+    memcpy(r->module_id, st->module_id, sizeof(r->module_id));
+    r->last_heartbeat_ms   = st->last_heartbeat_ms;
+    r->last_event_ms       = st->last_event_ms;
+    r->last_online_ms      = st->last_online_ms;
+    r->last_feedback_ms    = st->last_feedback_ms;
+    r->last_feedback_cmdid = st->last_feedback_cmdid;
+    r->last_addr_ip        = st->last_addr.sin_addr.s_addr;
+    r->last_addr_port      = st->last_addr.sin_port;
+    memcpy(r->last_feedback_target, st->last_feedback_target, sizeof(r->last_feedback_target));
+    memcpy(r->last_feedback_action, st->last_feedback_action, sizeof(r->last_feedback_action));
+    memcpy(r->last_feedback_phase, st->last_feedback_phase, sizeof(r->last_feedback_phase));
+    memcpy(r->last_feedback_state, st->last_feedback_state, sizeof(r->last_feedback_state));
+    r->last_feedback_duration_ms = st->last_feedback_duration_ms;
+    r->heartbeat_interval_ms     = st->heartbeat_interval_ms;
+    memcpy(r->last_heartbeat_line, st->last_heartbeat_line, sizeof(r->last_heartbeat_line));
+
+    atomic_store_explicit(&r->seq, seq + 2, memory_order_release);   // even: stable
+
+    uint32_t n = atomic_load_explicit(&g_hdr->num_records, memory_order_relaxed);
+    if ((uint32_t)index >= n) {
+        atomic_store_explicit(&g_hdr->num_records, (uint32_t)index + 1, memory_order_release);
+    }
+}
+
+void hub_shm_destroy(void)
+{
+    if (!g_hdr) return;
+    munmap(g_hdr, HUB_SHM_SIZE);
+    g_hdr = NULL;
+    g_records = NULL;
+    shm_unlink(HUB_SHM_NAME);
+}
+
+// ---------- reader ----------
+
+bool hub_shm_open(HubShmReader *r)
+{
+    if (!r) return false;
+    memset(r, 0, sizeof(*r));
+
+    int fd = shm_open(HUB_SHM_NAME, O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < HUB_SHM_SIZE) {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(NULL, HUB_SHM_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+
+    const HubShmHeader *hdr = p;
+    if (hdr->magic != HUB_SHM_MAGIC || hdr->version != HUB_SHM_VERSION ||
+        hdr->header_size != sizeof(HubShmHeader) ||
+        hdr->record_size != sizeof(HubShmRecord) ||
+        hdr->max_records != HUB_MAX_DOORS) {
+        fprintf(stderr, "[hub_shm] status table layout mismatch\n");
+        munmap(p, HUB_SHM_SIZE);
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    r->hdr = hdr;
+    r->records = (const HubShmRecord *)((const char *)p + sizeof(HubShmHeader));
+    r->map_len = HUB_SHM_SIZE;
+    return true;
+}
+
+void hub_shm_close(HubShmReader *r)
+{
+    if (!r || !r->hdr) return;
+    munmap((void *)r->hdr, r->map_len);
+    memset(r, 0, sizeof(*r));
+}
+
+// Copy record i with the seqlock retry loop. A publish takes microseconds;
+// a record still odd after HUB_SHM_READ_TIMEOUT_MS was left mid-write by a
+// hub that died, so give up and return false.
+static bool read_record(const HubShmRecord *src, HubShmRecord *copy)
+{
+    long long deadline = 0;
+    for (int tries = 0;; tries++) {
+        uint32_t s1 = atomic_load_explicit(&src->seq, memory_order_acquire);
+        if (!(s1 & 1)) {
+            memcpy((char *)copy + sizeof(copy->seq), (const char *)src + sizeof(src->seq),
+                   sizeof(*copy) - sizeof(copy->seq));
+            atomic_thread_fence(memory_order_acquire);
+            uint32_t s2 = atomic_load_explicit(&src->seq, memory_order_relaxed);
+            if (s1 == s2) return true;
+        }
+        if (tries < HUB_SHM_READ_SPINS) continue;
+        // Writer in progress for a while: back off, up to the deadline
+        long long now = getTimeInMs();
+        if (deadline == 0) deadline = now + HUB_SHM_READ_TIMEOUT_MS;
+        else if (now >= deadline) return false;
+        sleepForUs(100);
+    }
+}
+
+static void record_to_status(const HubShmRecord *r, HubDoorStatus *out)
+{
+    memset(out, 0, sizeof(*out));
+    memcpy(out->module_id, r->module_id, sizeof(out->module_id));
+    out->module_id[sizeof(out->module_id) - 1] = '\0';
+    out->known     = r->known;
+    out->offline   = r->offline;
+    out->d0_open   = r->d0_open;
+    out->d0_locked = r->d0_locked;
+    out->d1_open   = r->d1_open;
+    out->d1_locked = r->d1_locked;
+    out->last_heartbeat_ms = r->last_heartbeat_ms;
+    out->last_event_ms     = r->last_event_ms;
+    out->last_online_ms    = r->last_online_ms;
+    out->has_last_addr     = r->has_last_addr;
+    out->last_addr.sin_family      = AF_INET;
+    out->last_addr.sin_addr.s_addr = r->last_addr_ip;
+    out->last_addr.sin_port        = r->last_addr_port;
+    out->last_feedback_ms    = r->last_feedback_ms;
+    out->last_feedback_cmdid = r->last_feedback_cmdid;
+    memcpy(out->last_feedback_target, r->last_feedback_target, sizeof(out->last_feedback_target));
+    memcpy(out->last_feedback_action, r->last_feedback_action, sizeof(out->last_feedback_action));
+    memcpy(out->last_feedback_phase, r->last_feedback_phase, sizeof(out->last_feedback_phase));
+    memcpy(out->last_feedback_state, r->last_feedback_state, sizeof(out->last_feedback_state));
+    out->last_feedback_duration_ms = r->last_feedback_duration_ms;
+    out->heartbeat_interval_ms     = r->heartbeat_interval_ms;
+    memcpy(out->last_heartbeat_line, r->last_heartbeat_line, sizeof(out->last_heartbeat_line));
+    out->last_feedback_target[sizeof(out->last_feedback_target) - 1] = '\0';
+    out->last_feedback_action[sizeof(out->last_feedback_action) - 1] = '\0';
+    out->last_feedback_phase[sizeof(out->last_feedback_phase) - 1] = '\0';
+    out->last_feedback_state[sizeof(out->last_feedback_state) - 1] = '\0';
+    out->last_heartbeat_line[sizeof(out->last_heartbeat_line) - 1] = '\0';
+}
+
+static uint32_t record_count(const HubShmReader *r)
+{
+    uint32_t n = atomic_load_explicit(&r->hdr->num_records, memory_order_acquire);
+    return n > HUB_MAX_DOORS ? HUB_MAX_DOORS : n;
+}
+
+bool hub_shm_read(const HubShmReader *r, const char *module_id, HubDoorStatus *out)
+{
+    if (!r || !r->hdr || !module_id || !out) return false;
+
+    uint32_t n = record_count(r);
+    for (uint32_t i = 0; i < n; i++) {
+        HubShmRecord copy;
+        if (!read_record(&r->records[i], &copy)) continue;
+        if (copy.known && strncmp(copy.module_id, module_id, HUB_MODULE_ID_LEN) == 0) {
+            record_to_status(&copy, out);
+            return true;
+        }
+    }
+    return false;
+}
+
+int hub_shm_snapshot(const HubShmReader *r, HubDoorStatus *out, int max)
+{
+    if (!r || !r->hdr || !out || max <= 0) return 0;
+
+    int count = 0;
+    uint32_t n = record_count(r);
+    for (uint32_t i = 0; i < n && count < max; i++) {
+        HubShmRecord copy;
+        if (!read_record(&r->records[i], &copy) || !copy.known) continue;
+        record_to_status(&copy, &out[count++]);
+    }
+    return count;
+}
@@ -1,6 +1,10 @@
 // hub_udp.c
 #define _POSIX_C_SOURCE 200809L
 #include "hal/hub_udp.h"
+#include "hal/hub_local.h"
+#include "hal/hub_metrics.h"
+#include "hal/hub_shm.h"
+#include "hal/system_webhook.h"
 #include "hal/timing.h"
 #include <curl/curl.h>
 #include <arpa/inet.h>
@@ -10,6 +14,7 @@
 #include <netinet/in.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <time.h>
@@ -17,14 +22,31 @@
 #include "discord_alert.h"
 
 #define HUB_OFFLINE_TIMEOUT_MS 10000  // 10 seconds without heartbeat = offline
+#define HUB_OFFLINE_MISSED_HB  3      // ...or this many advertised intervals, if longer
 #define HUB_MAX_MODULES 16           // max distinct door modules to track
 
+// Heartbeat backpressure (see "heartbeat backpressure" below)
+#define HUB_RATE_WINDOW_MS     1000   // ingest cost is measured over this
+#define HUB_RATE_MIN_MS        250    // smaller floors aren't sent
+#define HUB_RATE_MAX_MS        30000
+#define HUB_RATE_STEP_MS       100    // floors are rounded up to this
+#define HUB_RATE_SATURATED_PCT 80     // listener busier than this: double the floor
+#define HUB_RATE_JITTER_DIV    4      // jitter window = floor / 4
+#define HUB_RATE_RESEND_MS     1000   // min gap between CONFIGs to one module
+#define HUB_RATE_REFRESH_MS    30000  // resend a floor in case a CONFIG got lost
+
 // ---------- Endpoint table (door module -> last known IP:port) ----------
 
 typedef struct {
     char module_id[16];
     struct sockaddr_in addr;
     bool has_addr;
+    int rate_period_ms;       // heartbeat floor the module was last sent
+    long long rate_sent_ms;   // when (0: never)
+    long long rate_grace_ms;  // not offline before this: it may be re-phasing
+    uint32_t ev_epoch;        // sequenced EVENTs: module session, 0 if none seen
+    uint32_t ev_next;         // next SEQ expected in it
+    bool ack_pending;         // owe the module a cumulative ACK
 } HubEndpoint;
 
 static HubEndpoint g_endpoints[HUB_MAX_MODULES];
@@ -43,7 +65,22 @@ static char         g_webhook_url[512] =
 
 static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  g_feedback_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  g_state_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t        g_state_version = 0;  // bumped on door/lock/online changes
+static uint64_t        g_wake_gen = 0;       // bumped by hub_udp_wake_waiters()
 static int             g_next_cmdid = 1;
+static long long       g_mutex_acquired_us = 0; // written only by the holder
+
+// Heartbeat floor currently asked of modules (under g_mutex; 0: none)
+static int             g_rate_period_ms = 0;
+static int             g_rate_jitter_ms = 0;
+static int             g_hb_budget_pct  = HUB_HB_DEFAULT_BUDGET_PCT;
+static unsigned        g_rate_seed      = 1;     // rand_r() state for phases
+// Ingest accounting, listener thread only
+static long long       g_rate_window_start_us = 0;
+static long long       g_rate_busy_us   = 0;
+static long long       g_rate_lines = 0;
+static double          g_rate_cost_us   = 0;     // smoothed cost of one line
 
 // Per-door status
 static HubDoorStatus g_doors[HUB_MAX_DOORS];
@@ -63,6 +100,25 @@ typedef struct {
 } PendingClientCmd;
 static PendingClientCmd g_pending_cmds[HUB_MAX_PENDING_CMDS];
 
+// Latest feedback phase of recent hub-issued commands, looked up by
+// hub_udp_send_command_ex() waiters (slots are reused oldest first)
+#define HUB_CMD_FEEDBACK_SLOTS 32
+typedef enum {
+    CMD_PHASE_NONE = 0,
+    CMD_PHASE_ACCEPTED,
+    CMD_PHASE_COMPLETED,
+    CMD_PHASE_FAILED
+} CmdPhase;
+typedef struct {
+    char      module_id[HUB_MODULE_ID_LEN];
+    int       cmdid;
+    CmdPhase  phase;
+    char      state[16];
+    long long duration_ms;
+} CmdFeedback;
+static CmdFeedback g_cmd_feedback[HUB_CMD_FEEDBACK_SLOTS];
+static int         g_cmd_feedback_next = 0;
+
 // ---------- time helper ----------
 
 static long long now_ms(void)
@@ -72,35 +128,89 @@ static long long now_ms(void)
     return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
 }
 
+// ---------- g_mutex wrappers (record wait/hold time) ----------
+
+static void hub_lock(void)
+{
+    long long t0 = getTimeInUs();
+    pthread_mutex_lock(&g_mutex);
+    g_mutex_acquired_us = getTimeInUs();
+    hub_metrics_observe(HUB_HIST_MUTEX_WAIT_US, g_mutex_acquired_us - t0);
+}
+
+static void hub_unlock(void)
+{
+    hub_metrics_observe(HUB_HIST_MUTEX_HOLD_US, getTimeInUs() - g_mutex_acquired_us);
+    pthread_mutex_unlock(&g_mutex);
+}
+
+// pthread_cond_timedwait() releases g_mutex while blocked; close the hold
+// interval before waiting and reopen it once the mutex is reacquired.
+// A NULL ts waits without a timeout.
+static int hub_cond_timedwait(pthread_cond_t *cond, const struct timespec *ts)
+{
+    hub_metrics_observe(HUB_HIST_MUTEX_HOLD_US, getTimeInUs() - g_mutex_acquired_us);
+    int rc = ts ? pthread_cond_timedwait(cond, &g_mutex, ts)
+                : pthread_cond_wait(cond, &g_mutex);
+    g_mutex_acquired_us = getTimeInUs();
+    return rc;
+}
+
 // ---------- webhook / Discord helpers ----------
 
 void hub_udp_set_webhook_url(const char *url)
 {
     if (!url) return;
-    pthread_mutex_lock(&g_mutex);
+    hub_lock();
     size_t len = strlen(url);
     if (len >= sizeof(g_webhook_url)) len = sizeof(g_webhook_url) - 1;
     memmove(g_webhook_url, url, len);
     g_webhook_url[len] = '\0';
-    pthread_mutex_unlock(&g_mutex);
+    hub_unlock();
 }
 
-static void trigger_discord_alert(const char* module_id, const char* event_type, 
-                                  const char* door, const char* state)
+// Door and online/offline alerts go through the system webhook queue in
+// their own priority class, ahead of operator chatter. They are built under
+// g_mutex and posted once it is released.
+typedef struct {
+    bool               set;
+    HubWebhookPriority prio;
+    char               url[HUB_WEBHOOK_URL_LEN];
+    char               event_id[HUB_WEBHOOK_EVENT_ID_LEN];  // "": none
+    char               msg[256];
+} HubAlert;
+
+// Caller holds g_mutex. `event_id` (may be NULL) lets the Discord outbox
+// drop a repeat of the same module EVENT, e.g. one resent after a restart.
+static void trigger_discord_alert(HubAlert *a, HubWebhookPriority prio, const char* module_id,
+                                  const char* event_type, const char* door, const char* state,
+                                  const char *event_id)
 {
     if (g_webhook_url[0] == '\0') {
         return; // No webhook URL set
     }
-    char alert_msg[256];
-    snprintf(alert_msg, sizeof(alert_msg), 
+    a->set = true;
+    a->prio = prio;
+    snprintf(a->url, sizeof(a->url), "%s", g_webhook_url);
+    snprintf(a->event_id, sizeof(a->event_id), "%s", event_id ? event_id : "");
+    snprintf(a->msg, sizeof(a->msg),
              "[%s] %s %s is now %s", module_id, door, event_type, state);
-    sendDiscordAlert(g_webhook_url, alert_msg);
+}
+
+// Without g_mutex.
+static void post_discord_alert(const HubAlert *a)
+{
+    if (!a->set) return;
+    if (!hub_webhook_post(a->prio, a->url, a->event_id[0] ? a->event_id : NULL, a->msg)) {
+        fprintf(stderr, "[hub_udp] alert dropped (webhook queue): %s\n", a->msg);
+    }
 }
 
 // ---------- door status helpers ----------
 
-static HubDoorStatus *find_or_create_door(const char *module_id)
+static HubDoorStatus *find_or_create_door(const char *module_id, bool *created)
 {
+    *created = false;
     for (int i = 0; i < HUB_MAX_DOORS; i++) {
         if (g_doors[i].known &&
             strncmp(g_doors[i].module_id, module_id, HUB_MODULE_ID_LEN) == 0) {
@@ -113,12 +223,28 @@ static HubDoorStatus *find_or_create_door(const char *module_id)
             snprintf(g_doors[i].module_id, sizeof(g_doors[i].module_id),
                      "%s", module_id);
             g_doors[i].known = true;
+            *created = true;
             return &g_doors[i];
         }
     }
     return NULL;
 }
 
+// Bits of a door's state that waiters care about (not timestamps)
+static unsigned door_state_bits(const HubDoorStatus *d)
+{
+    return (d->known     ? 1u << 0 : 0) | (d->offline   ? 1u << 1 : 0) |
+           (d->d0_open   ? 1u << 2 : 0) | (d->d0_locked ? 1u << 3 : 0) |
+           (d->d1_open   ? 1u << 4 : 0) | (d->d1_locked ? 1u << 5 : 0);
+}
+
+// Caller holds g_mutex.
+static void bump_state_version(void)
+{
+    g_state_version++;
+    pthread_cond_broadcast(&g_state_cond);
+}
+
 // ---------- pending client-command map ----------
 
 static void register_client_command(int cmdid, const char *module_id,
@@ -145,9 +271,10 @@ static void register_client_command(int cmdid, const char *module_id,
     g_pending_cmds[slot].issued_ms = now_ms();
 }
 
-// Lookup and remove a client command by module_id and cmdid
-static struct sockaddr_in *get_and_clear_client_cmd(const char *module_id,
-                                                    int cmdid)
+// Lookup a client command by module_id and cmdid; remove it if `clear`
+// (on the final feedback phase; ACCEPTED leaves it for the outcome)
+static struct sockaddr_in *get_client_cmd(const char *module_id,
+                                          int cmdid, bool clear)
 {
     for (int i = 0; i < HUB_MAX_PENDING_CMDS; i++) {
         if (g_pending_cmds[i].cmdid == cmdid &&
@@ -155,17 +282,55 @@ static struct sockaddr_in *get_and_clear_client_cmd(const char *module_id,
                     HUB_MODULE_ID_LEN) == 0) {
             static struct sockaddr_in result;
             result = g_pending_cmds[i].client_addr;
-            g_pending_cmds[i].cmdid = 0; // free
+            if (clear) g_pending_cmds[i].cmdid = 0; // free
             return &result;
         }
     }
     return NULL;
 }
 
+// ---------- command feedback phases ----------
+
+// Caller holds g_mutex.
+static CmdFeedback *find_cmd_feedback(const char *module_id, int cmdid)
+{
+    for (int i = 0; i < HUB_CMD_FEEDBACK_SLOTS; i++) {
+        CmdFeedback *f = &g_cmd_feedback[i];
+        if (f->phase != CMD_PHASE_NONE && f->cmdid == cmdid &&
+            strncmp(f->module_id, module_id, HUB_MODULE_ID_LEN) == 0) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+// Caller holds g_mutex. A late ACCEPTED never overwrites an outcome.
+static void record_cmd_feedback(const char *module_id, int cmdid, CmdPhase phase,
+                                const char *state, long long duration_ms)
+{
+    CmdFeedback *f = find_cmd_feedback(module_id, cmdid);
+    if (!f) {
+        f = &g_cmd_feedback[g_cmd_feedback_next];
+        g_cmd_feedback_next = (g_cmd_feedback_next + 1) % HUB_CMD_FEEDBACK_SLOTS;
+        snprintf(f->module_id, sizeof(f->module_id), "%s", module_id);
+        f->cmdid = cmdid;
+        f->phase = CMD_PHASE_NONE;
+    }
+    if (f->phase >= CMD_PHASE_COMPLETED) return;
+    f->phase = phase;
+    snprintf(f->state, sizeof(f->state), "%s", state ? state : "");
+    f->duration_ms = duration_ms;
+}
+
 // ---------- history ----------
 
 static void add_history(const char *module_id, const char *line, long long t)
 {
+    hub_metrics_inc(HUB_CTR_HISTORY_WRITES);
+    if (g_hist_count == HUB_MAX_HISTORY) {
+        hub_metrics_inc(HUB_CTR_HISTORY_OVERWRITES);
+    }
+
     HubEvent *e = &g_history[g_hist_head];
     e->timestamp_ms = t;
     snprintf(e->module_id, sizeof(e->module_id), "%s", module_id);
@@ -263,12 +428,23 @@ static void hub_update_endpoint(const char *module_id,
             module_id, ip, ntohs(src->sin_port));
 }
 
-// Forward the COMMAND line to the door module's last-known endpoint
+// Forward the COMMAND line to the door module's last-known endpoint.
+// Takes g_mutex only to copy the endpoint; the send happens unlocked.
 static bool hub_forward_command_to_module(const char *module_id,
                                           const char *line)
 {
-    HubEndpoint *ep = hub_find_endpoint(module_id);
-    if (!ep || !ep->has_addr) {
+    struct sockaddr_in addr;
+    bool have = false;
+
+    hub_lock();
+    HubEndpoint *ep = module_id ? hub_find_endpoint(module_id) : NULL;
+    if (ep && ep->has_addr) {
+        addr = ep->addr;
+        have = true;
+    }
+    hub_unlock();
+
+    if (!have) {
         fprintf(stderr,
                 "[hub_udp] No endpoint known for module %s; cannot forward COMMAND\n",
                 module_id ? module_id : "(null)");
@@ -283,8 +459,8 @@ static bool hub_forward_command_to_module(const char *module_id,
 
     ssize_t sent = sendto(g_sock,
                           line, strlen(line), 0,
-                          (struct sockaddr *)&ep->addr,
-                          sizeof(ep->addr));
+                          (struct sockaddr *)&addr,
+                          sizeof(addr));
     if (sent < 0) {
         perror("[hub_udp] sendto (forward COMMAND)");
         return false;
@@ -292,24 +468,37 @@ static bool hub_forward_command_to_module(const char *module_id,
 
     fprintf(stderr, "[hub_udp] Forwarded COMMAND to %s at %s:%u: '%s'\n",
             module_id,
-            inet_ntoa(ep->addr.sin_addr),
-            ntohs(ep->addr.sin_port),
+            inet_ntoa(addr.sin_addr),
+            ntohs(addr.sin_port),
             line);
     return true;
 }
 
 // ---------- offline detection ----------
 
+// Modules with an adaptive heartbeat advertise the interval until their
+// next one (HB=<ms>); a slow idle rate must not read as offline.
+static long long offline_timeout_ms(const HubDoorStatus *d)
+{
+    long long t = (long long)d->heartbeat_interval_ms * HUB_OFFLINE_MISSED_HB;
+    return t > HUB_OFFLINE_TIMEOUT_MS ? t : HUB_OFFLINE_TIMEOUT_MS;
+}
+
 static void check_offline_modules(void)
 {
     long long now = now_ms();
+    HubAlert alerts[HUB_MAX_DOORS];
+    int num_alerts = 0;
 
-    pthread_mutex_lock(&g_mutex);
+    hub_lock();
     for (int i = 0; i < HUB_MAX_DOORS; i++) {
         if (!g_doors[i].known) continue;
 
         bool should_be_offline =
-            (now - g_doors[i].last_heartbeat_ms) > HUB_OFFLINE_TIMEOUT_MS;
+            (now - g_doors[i].last_heartbeat_ms) > offline_timeout_ms(&g_doors[i]);
+        // A CONFIG RATE can move the next heartbeat past what it advertised
+        HubEndpoint *ep = hub_find_endpoint(g_doors[i].module_id);
+        if (ep && now < ep->rate_grace_ms) should_be_offline = false;
 
         if (should_be_offline && !g_doors[i].offline) {
             fprintf(stderr,
@@ -323,8 +512,9 @@ static void check_offline_modules(void)
             snprintf(event, sizeof(event),
                      "%s EVENT SYSTEM OFFLINE\n", g_doors[i].module_id);
             add_history(g_doors[i].module_id, event, now);
-            trigger_discord_alert(g_doors[i].module_id,
-                                  "SYSTEM", "MODULE", "OFFLINE");
+            alerts[num_alerts].set = false;
+            trigger_discord_alert(&alerts[num_alerts++], HUB_WEBHOOK_PRIO_CONNECTIVITY,
+                                  g_doors[i].module_id, "SYSTEM", "MODULE", "OFFLINE", NULL);
         } else if (!should_be_offline && g_doors[i].offline) {
             fprintf(stderr,
                     "[hub_offline_check] Module %s came back ONLINE\n",
@@ -335,28 +525,234 @@ static void check_offline_modules(void)
             snprintf(event, sizeof(event),
                      "%s EVENT SYSTEM ONLINE\n", g_doors[i].module_id);
             add_history(g_doors[i].module_id, event, now);
-            trigger_discord_alert(g_doors[i].module_id,
-                                  "SYSTEM", "MODULE", "ONLINE");
+            alerts[num_alerts].set = false;
+            trigger_discord_alert(&alerts[num_alerts++], HUB_WEBHOOK_PRIO_CONNECTIVITY,
+                                  g_doors[i].module_id, "SYSTEM", "MODULE", "ONLINE", NULL);
+        } else {
+            continue;  // no change to publish
+        }
+        hub_shm_publish(i, &g_doors[i]);
+        bump_state_version();
+    }
+    hub_unlock();
+
+    for (int i = 0; i < num_alerts; i++) post_discord_alert(&alerts[i]);
+}
+
+// ---------- heartbeat backpressure ----------
+//
+// The listener measures what one line costs it and how busy it was
+// over each HUB_RATE_WINDOW_MS. Heartbeats may take g_hb_budget_pct of its
+// time; with N modules online that gives the shortest period they may
+// beat at. A saturated listener doubles the floor on top of that, and the
+// floor comes down by at most half per window once it has room again.
+// Modules get it as
+//   <MOD> CONFIG RATE <PERIOD_MS> <JITTER_MS> <PHASE_MS>
+// each with its own random phase, so a fleet that reconnects together
+// doesn't keep beating in step.
+
+typedef struct {
+    struct sockaddr_in addr;
+    char line[64];
+} RateConfig;
+
+// Caller holds g_mutex.
+static int compute_rate_floor(int busy_pct)
+{
+    if (g_hb_budget_pct <= 0) return 0;
+
+    int fleet = 0;
+    for (int i = 0; i < HUB_MAX_DOORS; i++) {
+        if (g_doors[i].known && !g_doors[i].offline) fleet++;
+    }
+
+    int floor = 0;
+    if (fleet > 0 && g_rate_cost_us > 0) {
+        double hb_per_s = g_hb_budget_pct / 100.0 * 1e6 / g_rate_cost_us;
+        floor = (int)(fleet * 1000.0 / hb_per_s);
+    }
+    if (busy_pct >= HUB_RATE_SATURATED_PCT) {
+        int doubled = g_rate_period_ms > 0 ? g_rate_period_ms * 2 : 4 * HUB_RATE_MIN_MS;
+        if (doubled > floor) floor = doubled;
+    } else if (floor < g_rate_period_ms) {
+        // Relax gradually, and not at all while still fairly busy
+        int relaxed = busy_pct >= HUB_RATE_SATURATED_PCT / 2 ? g_rate_period_ms
+                                                             : g_rate_period_ms / 2;
+        if (relaxed > floor) floor = relaxed;
+    }
+
+    floor = (floor + HUB_RATE_STEP_MS - 1) / HUB_RATE_STEP_MS * HUB_RATE_STEP_MS;
+    if (floor < HUB_RATE_MIN_MS) floor = 0;
+    if (floor > HUB_RATE_MAX_MS) floor = HUB_RATE_MAX_MS;
+    return floor;
+}
+
+// Queue a CONFIG RATE for every module that doesn't have the current
+// floor (or hasn't been reminded of it for a while). Caller holds g_mutex.
+static int collect_rate_configs(RateConfig *out, long long now)
+{
+    int n = 0;
+    for (int i = 0; i < g_num_endpoints; i++) {
+        HubEndpoint *ep = &g_endpoints[i];
+        if (!ep->has_addr) continue;
+        bool stale = ep->rate_period_ms != g_rate_period_ms;
+        bool refresh = (g_rate_period_ms > 0 || ep->rate_period_ms > 0) &&
+                       now - ep->rate_sent_ms >= HUB_RATE_REFRESH_MS;
+        if (!(stale || refresh) || now - ep->rate_sent_ms < HUB_RATE_RESEND_MS) continue;
+
+        int phase = g_rate_period_ms > 0 ? rand_r(&g_rate_seed) % g_rate_period_ms : 0;
+        out[n].addr = ep->addr;
+        snprintf(out[n].line, sizeof(out[n].line), "%s CONFIG RATE %d %d %d\n",
+                 ep->module_id, g_rate_period_ms, g_rate_jitter_ms, phase);
+        n++;
+        ep->rate_period_ms = g_rate_period_ms;
+        ep->rate_sent_ms = now;
+        long long grace = now + (long long)(g_rate_period_ms + g_rate_jitter_ms) *
+                                HUB_OFFLINE_MISSED_HB;
+        if (grace > ep->rate_grace_ms) ep->rate_grace_ms = grace;
+    }
+    return n;
+}
+
+// Listener thread: account busy_us spent on `lines`, and once per
+// window update the floor and tell modules about it.
+static void rate_account(long long busy_us, int lines)
+{
+    long long now_us = getTimeInUs();
+    if (g_rate_window_start_us == 0) g_rate_window_start_us = now_us;
+    g_rate_busy_us += busy_us;
+    g_rate_lines += lines;
+    long long window_us = now_us - g_rate_window_start_us;
+    if (window_us < HUB_RATE_WINDOW_MS * 1000LL) return;
+
+    if (g_rate_lines > 0) {
+        double cost = (double)g_rate_busy_us / (double)g_rate_lines;
+        g_rate_cost_us = g_rate_cost_us > 0 ? 0.8 * g_rate_cost_us + 0.2 * cost : cost;
+    }
+    int busy_pct = (int)(g_rate_busy_us * 100 / window_us);
+    g_rate_window_start_us = now_us;
+    g_rate_busy_us = 0;
+    g_rate_lines = 0;
+
+    RateConfig configs[HUB_MAX_MODULES];
+    hub_lock();
+    int floor = compute_rate_floor(busy_pct);
+    if (floor != g_rate_period_ms) {
+        fprintf(stderr,
+                "[hub_udp] heartbeat floor %d -> %d ms (listener %d%% busy, %.1f us/line)\n",
+                g_rate_period_ms, floor, busy_pct, g_rate_cost_us);
+        g_rate_period_ms = floor;
+        g_rate_jitter_ms = floor / HUB_RATE_JITTER_DIV;
+    }
+    int n = collect_rate_configs(configs, now_ms());
+    hub_unlock();
+
+    for (int i = 0; i < n && g_sock >= 0; i++) {
+        if (sendto(g_sock, configs[i].line, strlen(configs[i].line), 0,
+                   (struct sockaddr *)&configs[i].addr, sizeof(configs[i].addr)) < 0) {
+            perror("[hub_udp] sendto (CONFIG RATE)");
+        } else {
+            hub_metrics_inc(HUB_CTR_RATE_CONFIGS_SENT);
+        }
+    }
+}
+
+// ---------- reliable EVENTs ----------
+//
+// Modules number their EVENTs "SEQ=<epoch>.<n>" and resend them until
+// acknowledged; "BASE=<n>" is the oldest one they still hold. Only the
+// next expected one is applied; duplicates and anything past a gap are
+// dropped (the module resends its whole window), so history and alerts
+// see each EVENT once and in order. "<MOD> EVENT LOST" stands in for one
+// the module's spool lost: it only moves the count on. ACKs are
+// cumulative and sent once per received batch:
+//   <MOD> ACK <epoch>.<n>      every EVENT up to n applied
+
+// Caller holds g_mutex. True if this EVENT is to be applied. base: the
+// line's BASE= value, NULL from modules that don't send it.
+static bool event_seq_accept(HubEndpoint *ep, const char *seq, const char *base)
+{
+    unsigned long epoch = 0, n = 0, b = 0;
+    if (sscanf(seq, "%lu.%lu", &epoch, &n) != 2 || epoch == 0 || n == 0) {
+        hub_metrics_inc(HUB_CTR_PARSE_ERRORS);
+        return true;   // apply it like an unnumbered EVENT
+    }
+    if ((uint32_t)epoch != ep->ev_epoch) {
+        // A restarted module starts again at 1. If the hub itself has no
+        // record (it restarted), start from the oldest EVENT the module
+        // still holds: a new one that overtook the resent window must not
+        // ACK away the ones before it. Modules without BASE= start from n.
+        if (!base || sscanf(base, "%lu", &b) != 1 || b == 0 || b > n) b = n;
+        ep->ev_next = ep->ev_epoch == 0 ? (uint32_t)b : 1;
+        ep->ev_epoch = (uint32_t)epoch;
+    }
+    ep->ack_pending = true;
+    if ((uint32_t)n == ep->ev_next) {
+        ep->ev_next++;
+        return true;
+    }
+    hub_metrics_inc((uint32_t)n < ep->ev_next ? HUB_CTR_EVENT_DUPLICATES
+                                              : HUB_CTR_EVENT_GAPS);
+    return false;
+}
+
+typedef struct {
+    struct sockaddr_in addr;
+    char line[64];
+} EventAck;
+
+// Listener thread, after a batch: one ACK per module that sent EVENTs.
+static void send_event_acks(void)
+{
+    EventAck acks[HUB_MAX_MODULES];
+    int n = 0;
+    hub_lock();
+    for (int i = 0; i < g_num_endpoints; i++) {
+        HubEndpoint *ep = &g_endpoints[i];
+        if (!ep->ack_pending) continue;
+        ep->ack_pending = false;
+        if (!ep->has_addr) continue;
+        acks[n].addr = ep->addr;
+        snprintf(acks[n].line, sizeof(acks[n].line), "%s ACK %u.%u\n",
+                 ep->module_id, ep->ev_epoch, ep->ev_next - 1);
+        n++;
+    }
+    hub_unlock();
+
+    for (int i = 0; i < n && g_sock >= 0; i++) {
+        if (sendto(g_sock, acks[i].line, strlen(acks[i].line), 0,
+                   (struct sockaddr *)&acks[i].addr, sizeof(acks[i].addr)) < 0) {
+            perror("[hub_udp] sendto (ACK)");
+        } else {
+            hub_metrics_inc(HUB_CTR_EVENT_ACKS_SENT);
         }
     }
-    pthread_mutex_unlock(&g_mutex);
 }
 
 // ---------- line handler ----------
 
-static void handle_line(char *line, const char *raw,
+// Returns false if the line was a repeated or out-of-order EVENT and
+// was dropped.
+static bool handle_line(char *line, const char *raw,
                         struct sockaddr_in *src, int fd)
 {
-    (void)fd;
     long long t = now_ms();
+    HubMetricPort port = (fd >= 0 && fd == g_sock2) ? HUB_METRIC_PORT_HB
+                                                    : HUB_METRIC_PORT_NOTIF;
 
     char *save = NULL;
     char *mod  = strtok_r(line, " \t\r\n", &save);
-    if (!mod) return;
-    char *type = strtok_r(NULL, " \t\r\n", &save);
-    if (!type) return;
+    char *type = mod ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+    if (!mod || !type) {
+        hub_metrics_count_datagram(port, HUB_METRIC_MSG_OTHER);
+        hub_metrics_inc(HUB_CTR_PARSE_ERRORS);
+        return true;
+    }
+    HubMetricMsgType msg_type = hub_metrics_msg_type(type);
+    hub_metrics_count_datagram(port, msg_type);
+    HubAlert alert = { .set = false };
 
-    pthread_mutex_lock(&g_mutex);
+    hub_lock();
 
     // Any non-COMMAND from a module (HELLO/EVENT/HEARTBEAT/FEEDBACK)
     // updates our endpoint table with that module's IP:port.
@@ -364,12 +760,14 @@ static void handle_line(char *line, const char *raw,
         hub_update_endpoint(mod, src);
     }
 
-    HubDoorStatus *door = find_or_create_door(mod);
+    bool created = false;
+    HubDoorStatus *door = find_or_create_door(mod, &created);
     if (!door) {
         add_history(mod, "<NO-STATE> (untracked)", t);
-        pthread_mutex_unlock(&g_mutex);
-        return;
+        hub_unlock();
+        return true;
     }
+    unsigned state_before = created ? 0 : door_state_bits(door);
 
     // Only treat non-COMMAND packets as coming from the door module
     // when updating door->last_addr; COMMAND packets are typically
@@ -379,6 +777,23 @@ static void handle_line(char *line, const char *raw,
         door->has_last_addr = 1;
     }
 
+    // Sequenced EVENTs are applied once, in order (see above)
+    const char *seq = msg_type == HUB_METRIC_MSG_EVENT ? strstr(raw, " SEQ=") : NULL;
+    HubEndpoint *seq_ep = seq && src ? hub_find_endpoint(mod) : NULL;
+    const char *base = seq_ep ? strstr(raw, " BASE=") : NULL;
+    if (seq_ep && !event_seq_accept(seq_ep, seq + 5, base ? base + 6 : NULL)) {
+        hub_unlock();
+        return false;
+    }
+    if (seq && strstr(raw, " EVENT LOST ")) {
+        // Placeholder for an EVENT the module's spool lost: not a door event
+        fprintf(stderr, "[hub_udp] %s lost EVENT %.*s from its spool\n", mod,
+                (int)strcspn(seq + 5, " \t\r\n"), seq + 5);
+        hub_metrics_inc(HUB_CTR_EVENTS_LOST);
+        hub_unlock();
+        return true;
+    }
+
     char hist_line[HUB_LINE_LEN];
     snprintf(hist_line, sizeof(hist_line), "%s %s", mod, type);
     add_history(mod, hist_line, t);
@@ -386,11 +801,15 @@ static void handle_line(char *line, const char *raw,
     if (strcmp(type, "HEARTBEAT") == 0) {
         char *tok = NULL;
         char hb_buf[HUB_LINE_LEN] = {0};
+        door->heartbeat_interval_ms = 0;   // older modules don't send HB=
         while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
             if (strncmp(tok, "D0=", 3) == 0) {
                 parse_d_state(tok, &door->d0_open, &door->d0_locked);
             } else if (strncmp(tok, "D1=", 3) == 0) {
                 parse_d_state(tok, &door->d1_open, &door->d1_locked);
+            } else if (strncmp(tok, "HB=", 3) == 0) {
+                int ms = atoi(tok + 3);
+                door->heartbeat_interval_ms = ms > 0 ? ms : 0;
             }
             if (hb_buf[0] != '\0')
                 strncat(hb_buf, " ",
@@ -399,6 +818,14 @@ static void handle_line(char *line, const char *raw,
                     sizeof(hb_buf)-strlen(hb_buf)-1);
         }
         door->last_heartbeat_ms = t;
+        // Beating faster than the floor: the module lost (or never got)
+        // its CONFIG RATE; have the next window send it again
+        HubEndpoint *ep = hub_find_endpoint(mod);
+        if (ep && door->heartbeat_interval_ms > 0 &&
+            door->heartbeat_interval_ms < g_rate_period_ms &&
+            t - ep->rate_sent_ms >= HUB_RATE_RESEND_MS) {
+            ep->rate_period_ms = 0;
+        }
         if (hb_buf[0] != '\0') {
             snprintf(door->last_heartbeat_line,
                      sizeof(door->last_heartbeat_line), "%s", hb_buf);
@@ -407,6 +834,12 @@ static void handle_line(char *line, const char *raw,
                      sizeof(door->last_heartbeat_line), "%s", hist_line);
         }
     } else if (strcmp(type, "EVENT") == 0) {
+        // Sequenced EVENTs are identified by module and SEQ
+        char event_id[HUB_WEBHOOK_EVENT_ID_LEN] = "";
+        if (seq) {
+            snprintf(event_id, sizeof(event_id), "%s-%.*s", mod,
+                     (int)strcspn(seq + 5, " \t\r\n"), seq + 5);
+        }
         char *which = strtok_r(NULL, " \t\r\n", &save);
         char *what  = strtok_r(NULL, " \t\r\n", &save);
         char *state = strtok_r(NULL, " \t\r\n", &save);
@@ -426,27 +859,62 @@ static void handle_line(char *line, const char *raw,
                 if (strcmp(what, "DOOR") == 0) {
                     if (strcmp(state, "OPEN") == 0) {
                         *p_open = true;
-                        trigger_discord_alert(mod, what, which, state);
+                        trigger_discord_alert(&alert, HUB_WEBHOOK_PRIO_SECURITY, mod, what, which, state, event_id);
                     } else if (strcmp(state, "CLOSED") == 0) {
                         *p_open = false;
-                        trigger_discord_alert(mod, what, which, state);
+                        trigger_discord_alert(&alert, HUB_WEBHOOK_PRIO_SECURITY, mod, what, which, state, event_id);
                     }
                 } else if (strcmp(what, "LOCK") == 0) {
                     if (strcmp(state, "LOCKED") == 0) {
                         *p_locked = true;
-                        trigger_discord_alert(mod, what, which, state);
+                        trigger_discord_alert(&alert, HUB_WEBHOOK_PRIO_SECURITY, mod, what, which, state, event_id);
                     } else if (strcmp(state, "UNLOCKED") == 0) {
                         *p_locked = false;
-                        trigger_discord_alert(mod, what, which, state);
+                        trigger_discord_alert(&alert, HUB_WEBHOOK_PRIO_SECURITY, mod, what, which, state, event_id);
                     }
                 }
+            } else {
+                hub_metrics_inc(HUB_CTR_PARSE_ERRORS);
             }
+        } else {
+            hub_metrics_inc(HUB_CTR_PARSE_ERRORS);
         }
         door->last_event_ms = t;
     } else if (strcmp(type, "FEEDBACK") == 0) {
+        // <ID> <TARGET> ACCEPTED <ACTION>
+        // <ID> <TARGET> COMPLETED|FAILED <ACTION> <STATE> <MS>
+        // <ID> <TARGET> <ACTION>            (single-phase modules)
         char *cmdid_s = strtok_r(NULL, " \t\r\n", &save);
         char *target  = strtok_r(NULL, " \t\r\n", &save);
-        char *action  = strtok_r(NULL, " \t\r\n", &save);
+        char *word    = strtok_r(NULL, " \t\r\n", &save);
+        char *action  = word;
+        const char *state = "";
+        long long duration_ms = 0;
+        CmdPhase phase;
+        if (word && strcmp(word, "ACCEPTED") == 0) {
+            phase = CMD_PHASE_ACCEPTED;
+        } else if (word && strcmp(word, "COMPLETED") == 0) {
+            phase = CMD_PHASE_COMPLETED;
+        } else if (word && strcmp(word, "FAILED") == 0) {
+            phase = CMD_PHASE_FAILED;
+        } else {
+            phase = CMD_PHASE_NONE;   // legacy
+        }
+        if (phase != CMD_PHASE_NONE) {
+            action = strtok_r(NULL, " \t\r\n", &save);
+            if (phase != CMD_PHASE_ACCEPTED) {
+                char *state_s = strtok_r(NULL, " \t\r\n", &save);
+                char *ms_s    = strtok_r(NULL, " \t\r\n", &save);
+                if (state_s) state = state_s;
+                if (ms_s) duration_ms = atoll(ms_s);
+            }
+        } else {
+            phase = CMD_PHASE_COMPLETED;
+            if (action && strncmp(action, "STATUS_", 7) == 0) state = action + 7;
+        }
+        static const char *const phase_names[] = { "", "ACCEPTED", "COMPLETED", "FAILED" };
+        const char *phase_s = phase_names[phase];
+
         int cmdid = 0;
         if (cmdid_s) cmdid = atoi(cmdid_s);
         if (target && action) {
@@ -454,23 +922,33 @@ static void handle_line(char *line, const char *raw,
                      sizeof(door->last_feedback_target), "%s", target);
             snprintf(door->last_feedback_action,
                      sizeof(door->last_feedback_action), "%s", action);
+            snprintf(door->last_feedback_phase,
+                     sizeof(door->last_feedback_phase), "%s", phase_s);
+            snprintf(door->last_feedback_state,
+                     sizeof(door->last_feedback_state), "%s", state);
+            door->last_feedback_duration_ms = duration_ms;
             door->last_feedback_ms    = t;
             door->last_feedback_cmdid = cmdid;
+            record_cmd_feedback(mod, cmdid, phase, state, duration_ms);
 
             char fbline[HUB_LINE_LEN];
-            snprintf(fbline, sizeof(fbline),
-                     "FEEDBACK %d %s %s", cmdid, target, action);
+            if (phase == CMD_PHASE_ACCEPTED) {
+                snprintf(fbline, sizeof(fbline), "FEEDBACK %d %s ACCEPTED %s",
+                         cmdid, target, action);
+            } else {
+                snprintf(fbline, sizeof(fbline), "FEEDBACK %d %s %s %s %s %lld",
+                         cmdid, target, phase_s, action,
+                         state[0] ? state : "UNKNOWN", duration_ms);
+            }
             add_history(mod, fbline, t);
 
             struct sockaddr_in *client_addr =
-                get_and_clear_client_cmd(mod, cmdid);
+                get_client_cmd(mod, cmdid, phase != CMD_PHASE_ACCEPTED);
             if (client_addr) {
-                char relay_msg[256];
-                snprintf(relay_msg, sizeof(relay_msg),
-                         "%s FEEDBACK %d %s %s\n",
-                         mod, cmdid, target, action);
+                char relay_msg[HUB_MODULE_ID_LEN + HUB_LINE_LEN + 2];
+                snprintf(relay_msg, sizeof(relay_msg), "%s %s\n", mod, fbline);
 
-                pthread_mutex_unlock(&g_mutex);
+                hub_unlock();
                 int relay_sock = socket(AF_INET, SOCK_DGRAM, 0);
                 if (relay_sock >= 0) {
                     sendto(relay_sock, relay_msg, strlen(relay_msg), 0,
@@ -478,10 +956,12 @@ static void handle_line(char *line, const char *raw,
                            sizeof(*client_addr));
                     close(relay_sock);
                 }
-                pthread_mutex_lock(&g_mutex);
+                hub_lock();
             }
 
             pthread_cond_broadcast(&g_feedback_cond);
+        } else {
+            hub_metrics_inc(HUB_CTR_PARSE_ERRORS);
         }
     } else if (strcmp(type, "COMMAND") == 0) {
         // COMMAND <CMDID> <TARGET> <ACTION> from Node → forward to door
@@ -495,16 +975,31 @@ static void handle_line(char *line, const char *raw,
 
             // Forward the ORIGINAL line (raw) to the module, so the
             // cmdid stays the same from Node → door → FEEDBACK
-            pthread_mutex_unlock(&g_mutex);
+            hub_unlock();
             hub_forward_command_to_module(mod, raw);
-            pthread_mutex_lock(&g_mutex);
+            hub_lock();
+        } else {
+            hub_metrics_inc(HUB_CTR_PARSE_ERRORS);
         }
     } else {
         // HELLO or unknown, just history+timestamp
+        if (msg_type == HUB_METRIC_MSG_OTHER) {
+            hub_metrics_inc(HUB_CTR_PARSE_ERRORS);
+        } else if (msg_type == HUB_METRIC_MSG_HELLO) {
+            // A (re)started module has no heartbeat floor yet
+            HubEndpoint *ep = hub_find_endpoint(mod);
+            if (ep) ep->rate_period_ms = 0;
+        }
         door->last_event_ms = t;
     }
 
-    pthread_mutex_unlock(&g_mutex);
+    hub_shm_publish((int)(door - g_doors), door);
+    if (door_state_bits(door) != state_before) {
+        bump_state_version();
+    }
+    hub_unlock();
+    post_discord_alert(&alert);
+    return true;
 }
 
 // ---------- receiver thread ----------
@@ -517,7 +1012,8 @@ static void *udp_thread(void *arg)
 
     struct sockaddr_in src;
     socklen_t src_len = sizeof(src);
-    char buf[HUB_LINE_LEN];
+    char buf[HUB_DGRAM_MAX];
+    char line[HUB_LINE_LEN];
     char raw[HUB_LINE_LEN];
 
     while (!g_stopping) {
@@ -540,6 +1036,7 @@ static void *udp_thread(void *arg)
             continue;
         } else if (r == 0) {
             check_offline_modules();
+            rate_account(0, 0);
             continue;
         }
 
@@ -548,6 +1045,8 @@ static void *udp_thread(void *arg)
         else if (g_sock2 >= 0 && FD_ISSET(g_sock2, &rfds)) fd = g_sock2;
         if (fd < 0) continue;
 
+        long long busy_start_us = getTimeInUs();
+        int lines = 0;
         while (1) {
             ssize_t n = recvfrom(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT,
                                  (struct sockaddr *)&src, &src_len);
@@ -560,8 +1059,8 @@ static void *udp_thread(void *arg)
                 break;
             }
             if (n == 0) break;
+            long long rx_us = getTimeInUs();
             buf[n] = '\0';
-            memcpy(raw, buf, n + 1);
 
             char src_ip[INET_ADDRSTRLEN];
             inet_ntop(AF_INET, &src.sin_addr, src_ip, INET_ADDRSTRLEN);
@@ -569,10 +1068,31 @@ static void *udp_thread(void *arg)
                     "[hub_udp_thread] RECEIVED: %zd bytes from %s:%u on fd=%d: '%s'\n",
                     n, src_ip, ntohs(src.sin_port), fd, buf);
 
-            handle_line(buf, raw, &src, fd);
+            // Batching modules send several '\n'-terminated records per
+            // datagram; each is handled (and published) as its own line
+            int records = 0;
+            for (char *rec = buf; *rec; ) {
+                size_t len = strcspn(rec, "\n");
+                size_t with_nl = len + (rec[len] == '\n');
+                if (len > 0) {
+                    size_t keep = with_nl < sizeof(raw) ? with_nl : sizeof(raw) - 1;
+                    memcpy(raw, rec, keep);
+                    raw[keep] = '\0';
+                    memcpy(line, raw, keep + 1);
+                    if (handle_line(line, raw, &src, fd)) hub_local_publish(raw);
+                    records++;
+                }
+                rec += with_nl;
+            }
+            hub_metrics_observe(HUB_HIST_INGEST_APPLY_US, getTimeInUs() - rx_us);
+            if (records > 1) hub_metrics_inc(HUB_CTR_MULTI_RECORD_DATAGRAMS);
+            lines += records;
         }
 
+        send_event_acks();
+
         check_offline_modules();
+        rate_account(getTimeInUs() - busy_start_us, lines);
     }
 
     return NULL;
@@ -580,6 +1100,68 @@ static void *udp_thread(void *arg)
 
 // ---------- public API ----------
 
+void hub_udp_set_heartbeat_budget(int pct)
+{
+    if (pct < 0) pct = 0;
+    if (pct > 100) pct = 100;
+    hub_lock();
+    g_hb_budget_pct = pct;
+    hub_unlock();
+}
+
+bool hub_udp_forward_raw(const char *module_id, const char *line)
+{
+    if (!module_id || !line) return false;
+    return hub_forward_command_to_module(module_id, line);
+}
+
+int hub_udp_alloc_cmdid(void)
+{
+    hub_lock();
+    int cmdid = g_next_cmdid++;
+    hub_unlock();
+    return cmdid;
+}
+
+uint64_t hub_udp_state_version(void)
+{
+    hub_lock();
+    uint64_t v = g_state_version;
+    hub_unlock();
+    return v;
+}
+
+uint64_t hub_udp_wait_state_change(uint64_t seen, int timeout_ms)
+{
+    struct timespec ts;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec  += timeout_ms / 1000;
+        ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec += 1;
+            ts.tv_nsec -= 1000000000L;
+        }
+    }
+
+    hub_lock();
+    uint64_t wake_gen = g_wake_gen;
+    while (g_state_version == seen && g_wake_gen == wake_gen) {
+        if (hub_cond_timedwait(&g_state_cond, timeout_ms >= 0 ? &ts : NULL) == ETIMEDOUT) break;
+    }
+    uint64_t v = g_state_version;
+    hub_unlock();
+    return v;
+}
+
+void hub_udp_wake_waiters(void)
+{
+    hub_lock();
+    g_wake_gen++;
+    pthread_cond_broadcast(&g_state_cond);
+    hub_unlock();
+}
+
 bool hub_udp_init(uint16_t listen_port1, uint16_t listen_port2)
 {
     fprintf(stderr,
@@ -593,6 +1175,12 @@ bool hub_udp_init(uint16_t listen_port1, uint16_t listen_port2)
         fprintf(stderr, "discordStart() failed\n");
     }
     g_listen_port = listen_port1;
+    // Modules remember (source, cmdid, target, action) for 10 s and replay
+    // the old FEEDBACK for a repeat; a hub restarted within that window
+    // must not reuse the last run's cmdids from the same port
+    hub_lock();
+    g_next_cmdid = 1 + (int)(time(NULL) % 1000000000);
+    hub_unlock();
 
     int s1 = socket(AF_INET, SOCK_DGRAM, 0);
     if (s1 < 0) {
@@ -657,14 +1245,23 @@ bool hub_udp_init(uint16_t listen_port1, uint16_t listen_port2)
 
     g_stopping = 0;
 
-    pthread_mutex_lock(&g_mutex);
+    hub_lock();
     memset(g_doors, 0, sizeof(g_doors));
     memset(g_history, 0, sizeof(g_history));
     g_hist_head  = 0;
     g_hist_count = 0;
     memset(g_endpoints, 0, sizeof(g_endpoints));
     g_num_endpoints = 0;
-    pthread_mutex_unlock(&g_mutex);
+    g_rate_period_ms = g_rate_jitter_ms = 0;
+    g_rate_seed = (unsigned)getTimeInUs();
+    hub_unlock();
+    g_rate_window_start_us = g_rate_busy_us = g_rate_lines = 0;
+    g_rate_cost_us = 0;
+
+    // Shared-memory mirror of g_doors for local readers (optional)
+    if (!hub_shm_create()) {
+        fprintf(stderr, "[hub_udp_init] WARNING: shared status table unavailable\n");
+    }
 
     fprintf(stderr, "[hub_udp_init] Creating listener thread...\n");
     if (pthread_create(&g_thread_id, NULL, udp_thread, NULL) != 0) {
@@ -693,6 +1290,7 @@ void hub_udp_shutdown(void)
     pthread_join(g_thread_id, NULL);
     if (g_sock  >= 0) { close(g_sock);  g_sock  = -1; }
     if (g_sock2 >= 0) { close(g_sock2); g_sock2 = -1; }
+    hub_shm_destroy();
     discordCleanup();
 }
 
@@ -701,7 +1299,7 @@ bool hub_udp_get_status(const char *module_id, HubDoorStatus *out)
     if (!module_id || !out) return false;
 
     bool found = false;
-    pthread_mutex_lock(&g_mutex);
+    hub_lock();
     for (int i = 0; i < HUB_MAX_DOORS; i++) {
         if (g_doors[i].known &&
             strncmp(g_doors[i].module_id, module_id,
@@ -711,7 +1309,7 @@ bool hub_udp_get_status(const char *module_id, HubDoorStatus *out)
             break;
         }
     }
-    pthread_mutex_unlock(&g_mutex);
+    hub_unlock();
     return found;
 }
 
@@ -719,7 +1317,7 @@ int hub_udp_get_history(HubEvent *out, int max_events)
 {
     if (!out || max_events <= 0) return 0;
 
-    pthread_mutex_lock(&g_mutex);
+    hub_lock();
     int count = (g_hist_count < max_events) ? g_hist_count : max_events;
 
     int start = (g_hist_head - g_hist_count + HUB_MAX_HISTORY)
@@ -729,22 +1327,61 @@ int hub_udp_get_history(HubEvent *out, int max_events)
         int idx = (start + i) % HUB_MAX_HISTORY;
         out[i] = g_history[idx];
     }
-    pthread_mutex_unlock(&g_mutex);
+    hub_unlock();
 
     return count;
 }
 
-// Existing hub_udp_send_command (used by hub CLI / internal code).
-// This now co-exists with the forwarding path used by Node commands.
-bool hub_udp_send_command(const char *module_id,
-                          const char *target, const char *action)
+static void deadline_in_ms(struct timespec *ts, long long ms)
 {
-    if (!module_id || !target || !action) return false;
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec  += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec += 1;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+// Caller holds g_mutex. Wait until the command's feedback reaches at least
+// `phase` or the deadline passes; returns the phase reached.
+static CmdPhase wait_cmd_phase(const char *module_id, int cmdid, CmdPhase phase,
+                               const struct timespec *deadline)
+{
+    for (;;) {
+        CmdFeedback *f = find_cmd_feedback(module_id, cmdid);
+        if (f && f->phase >= phase) return f->phase;
+        if (hub_cond_timedwait(&g_feedback_cond, deadline) == ETIMEDOUT) {
+            f = find_cmd_feedback(module_id, cmdid);
+            return f ? f->phase : CMD_PHASE_NONE;
+        }
+    }
+}
 
-    const int ACK_TIMEOUT_MS = 500;
-    const int ACK_RETRIES    = 2;
+const char *hub_cmd_outcome_name(HubCmdOutcome outcome)
+{
+    switch (outcome) {
+    case HUB_CMD_COMPLETED: return "completed";
+    case HUB_CMD_FAILED:    return "failed";
+    case HUB_CMD_NO_ACK:    return "no_ack";
+    case HUB_CMD_TIMEOUT:   return "timeout";
+    case HUB_CMD_NO_ROUTE:  return "no_route";
+    }
+    return "unknown";
+}
 
-    pthread_mutex_lock(&g_mutex);
+// Used by the hub CLI / HTTP API; co-exists with the forwarding path used
+// by Node commands. The module ACCEPTs within HUB_CMD_ACK_TIMEOUT_MS (the
+// COMMAND is resent otherwise) and reports COMPLETED/FAILED once the
+// motor has moved.
+bool hub_udp_send_command_ex(const char *module_id, const char *target,
+                             const char *action, HubCmdResult *out)
+{
+    HubCmdResult res = { .outcome = HUB_CMD_NO_ROUTE, .accepted_ms = -1 };
+    if (out) *out = res;
+    if (!module_id || !target || !action) return false;
+
+    hub_lock();
     HubDoorStatus *door = NULL;
     for (int i = 0; i < HUB_MAX_DOORS; i++) {
         if (g_doors[i].known &&
@@ -755,21 +1392,30 @@ bool hub_udp_send_command(const char *module_id,
         }
     }
     if (!door || !door->has_last_addr) {
-        pthread_mutex_unlock(&g_mutex);
+        hub_unlock();
         return false;
     }
 
     struct sockaddr_in dest = door->last_addr;
     int cmdid = g_next_cmdid++;
-    pthread_mutex_unlock(&g_mutex);
+    hub_unlock();
+    res.cmdid = cmdid;
 
     char buf[256];
     snprintf(buf, sizeof(buf),
              "%s COMMAND %d %s %s\n", module_id, cmdid, target, action);
 
+    hub_metrics_inc(HUB_CTR_CMD_SENT);
+    long long start_us = getTimeInUs();
+
+    // One socket for every attempt: retransmits then come from the same
+    // source port, which is how the module recognises them as duplicates
+    int s = -1;
+    CmdPhase phase = CMD_PHASE_NONE;
     int attempt = 0;
-    while (attempt <= ACK_RETRIES) {
-        int s = socket(AF_INET, SOCK_DGRAM, 0);
+    while (attempt <= HUB_CMD_ACK_RETRIES) {
+        if (attempt > 0) hub_metrics_inc(HUB_CTR_CMD_RETRIES);
+        if (s < 0) s = socket(AF_INET, SOCK_DGRAM, 0);
         if (s < 0) {
             attempt++;
             sleepForMs(1);
@@ -777,7 +1423,6 @@ bool hub_udp_send_command(const char *module_id,
         }
         ssize_t n = sendto(s, buf, strlen(buf), 0,
                            (struct sockaddr *)&dest, sizeof(dest));
-        close(s);
         if (n != (ssize_t)strlen(buf)) {
             attempt++;
             sleepForMs(20 * (1 << attempt));
@@ -785,42 +1430,58 @@ bool hub_udp_send_command(const char *module_id,
         }
 
         struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_sec  += (ACK_TIMEOUT_MS / 1000);
-        ts.tv_nsec += (ACK_TIMEOUT_MS % 1000) * 1000000;
-        if (ts.tv_nsec >= 1000000000) {
-            ts.tv_sec += 1;
-            ts.tv_nsec -= 1000000000;
-        }
+        deadline_in_ms(&ts, HUB_CMD_ACK_TIMEOUT_MS);
+        hub_lock();
+        phase = wait_cmd_phase(module_id, cmdid, CMD_PHASE_ACCEPTED, &ts);
+        hub_unlock();
+        if (phase != CMD_PHASE_NONE) break;
 
-        pthread_mutex_lock(&g_mutex);
-        int rc = 0;
-        while (door->last_feedback_cmdid < cmdid) {
-            rc = pthread_cond_timedwait(&g_feedback_cond, &g_mutex, &ts);
-            if (rc == ETIMEDOUT) break;
-        }
+        attempt++;
+        sleepForMs(50 * attempt);
+    }
+    if (s >= 0) close(s);
 
-        bool got = false;
-        if (door->last_feedback_cmdid >= cmdid) {
-            if (strncmp(door->last_feedback_target, target,
-                        sizeof(door->last_feedback_target)) == 0 &&
-                strncmp(door->last_feedback_action, action,
-                        sizeof(door->last_feedback_action)) == 0) {
-                got = true;
-            }
-        }
-        pthread_mutex_unlock(&g_mutex);
+    if (phase == CMD_PHASE_NONE) {
+        res.outcome = HUB_CMD_NO_ACK;
+        res.total_ms = (getTimeInUs() - start_us) / 1000;
+    } else {
+        hub_metrics_inc(HUB_CTR_CMD_ACKED);
+        res.accepted_ms = (getTimeInUs() - start_us) / 1000;
 
-        if (got) {
-            LED_enqueue_hub_command_success();
-            return true;
+        struct timespec ts;
+        deadline_in_ms(&ts, HUB_CMD_COMPLETE_TIMEOUT_MS);
+        hub_lock();
+        phase = wait_cmd_phase(module_id, cmdid, CMD_PHASE_COMPLETED, &ts);
+        CmdFeedback *f = find_cmd_feedback(module_id, cmdid);
+        if (f && phase >= CMD_PHASE_COMPLETED) {
+            snprintf(res.state, sizeof(res.state), "%s", f->state);
+            res.duration_ms = f->duration_ms;
         }
+        hub_unlock();
 
-        attempt++;
-        sleepForMs(50 * attempt);
+        res.total_ms = (getTimeInUs() - start_us) / 1000;
+        res.outcome = phase == CMD_PHASE_COMPLETED ? HUB_CMD_COMPLETED
+                    : phase == CMD_PHASE_FAILED    ? HUB_CMD_FAILED
+                                                   : HUB_CMD_TIMEOUT;
+    }
+    if (out) *out = res;
+
+    if (res.outcome == HUB_CMD_COMPLETED) {
+        hub_metrics_observe(HUB_HIST_CMD_RTT_US, getTimeInUs() - start_us);
+        LED_enqueue_hub_command_success();
+        return true;
     }
 
+    hub_metrics_inc(HUB_CTR_CMD_FAILED);
     LED_enqueue_blink_red_n(5, 2, 50);
-    LED_enqueue_status_network_error();
+    if (res.outcome != HUB_CMD_FAILED) {
+        LED_enqueue_status_network_error();   // the module didn't answer
+    }
     return false;
+}
+
+bool hub_udp_send_command(const char *module_id,
+                          const char *target, const char *action)
+{
+    return hub_udp_send_command_ex(module_id, target, action, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+// reactor.c
+// epoll loop with timerfd timers and an eventfd for posts and shutdown;
+// see reactor.h.
+#define _GNU_SOURCE
+#include "hal/reactor.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 8
+
+typedef enum { SRC_FREE = 0, SRC_FD, SRC_TIMER } SourceKind;
+
+typedef union {
+    ReactorFdCallback    fd_cb;
+    ReactorTimerCallback timer_cb;
+} SourceCallback;
+
+typedef struct {
+    SourceKind     kind;
+    int            id;
+    int            fd;      // watched fd, or the timerfd (owned here)
+    SourceCallback cb;
+    void          *ctx;
+} Source;
+
+typedef struct {
+    ReactorCallback cb;
+    void           *ctx;
+} Post;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_idle = PTHREAD_COND_INITIALIZER;   // a callback returned
+static int             g_refs = 0;
+static bool            g_stopping = false;
+static pthread_t       g_thread;
+static int             g_epfd = -1;
+static int             g_wakefd = -1;                       // eventfd: posts + shutdown
+static Source          g_sources[REACTOR_MAX_SOURCES];
+static int             g_next_id = 1;
+static int             g_dispatching = 0;                   // source id in a callback, 0 if none
+static Post            g_posts[REACTOR_POST_QUEUE];
+static int             g_post_head = 0, g_post_len = 0;
+
+static __thread bool   t_in_loop = false;
+
+// Caller holds g_lock.
+static Source *find_source(int id)
+{
+    for (int i = 0; i < REACTOR_MAX_SOURCES; i++) {
+        if (g_sources[i].kind != SRC_FREE && g_sources[i].id == id) return &g_sources[i];
+    }
+    return NULL;
+}
+
+// Caller holds g_lock. Returns the new id or -1.
+static int add_source(SourceKind kind, int fd, uint32_t events, SourceCallback cb, void *ctx)
+{
+    if (g_refs == 0 || g_stopping) return -1;
+    Source *s = NULL;
+    for (int i = 0; i < REACTOR_MAX_SOURCES && !s; i++) {
+        if (g_sources[i].kind == SRC_FREE) s = &g_sources[i];
+    }
+    if (!s) {
+        fprintf(stderr, "reactor: no free source slot\n");
+        return -1;
+    }
+    int id = g_next_id++;
+    if (g_next_id <= 0) g_next_id = 1;
+
+    struct epoll_event ev = { .events = events, .data.u64 = (uint64_t)id };
+    if (epoll_ctl(g_epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("reactor: epoll_ctl ADD");
+        return -1;
+    }
+    s->kind = kind;
+    s->id = id;
+    s->fd = fd;
+    s->cb = cb;
+    s->ctx = ctx;
+    return id;
+}
+
+// Caller holds g_lock.
+static void free_source(Source *s)
+{
+    if (g_epfd >= 0) epoll_ctl(g_epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    if (s->kind == SRC_TIMER) close(s->fd);
+    memset(s, 0, sizeof(*s));
+}
+
+// First expiry after delay_ms (0: disarmed), then every period_ms (0: once).
+static void arm_timer(int tfd, int delay_ms, int period_ms)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_interval.tv_sec = period_ms / 1000;
+    its.it_interval.tv_nsec = (long)(period_ms % 1000) * 1000000L;
+    its.it_value.tv_sec = delay_ms / 1000;
+    its.it_value.tv_nsec = (long)(delay_ms % 1000) * 1000000L;
+    timerfd_settime(tfd, 0, &its, NULL);
+}
+
+static void run_posts(void)
+{
+    uint64_t n;
+    while (read(g_wakefd, &n, sizeof(n)) < 0 && errno == EINTR) {}
+
+    pthread_mutex_lock(&g_lock);
+    while (g_post_len > 0) {
+        Post p = g_posts[g_post_head];
+        g_post_head = (g_post_head + 1) % REACTOR_POST_QUEUE;
+        g_post_len--;
+        pthread_mutex_unlock(&g_lock);
+        p.cb(p.ctx);
+        pthread_mutex_lock(&g_lock);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void dispatch(int id, uint32_t events)
+{
+    pthread_mutex_lock(&g_lock);
+    Source *s = find_source(id);
+    if (!s) {
+        // Removed earlier in this batch
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+    Source copy = *s;
+    g_dispatching = id;
+    pthread_mutex_unlock(&g_lock);
+
+    if (copy.kind == SRC_TIMER) {
+        uint64_t expirations = 0;
+        if (read(copy.fd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations) &&
+            expirations > 0) {
+            copy.cb.timer_cb(expirations, copy.ctx);
+        }
+    } else {
+        copy.cb.fd_cb(copy.fd, events, copy.ctx);
+    }
+
+    pthread_mutex_lock(&g_lock);
+    g_dispatching = 0;
+    pthread_cond_broadcast(&g_idle);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void *reactor_loop(void *arg)
+{
+    (void)arg;
+    t_in_loop = true;
+    struct epoll_event events[MAX_EVENTS];
+    for (;;) {
+        int n = epoll_wait(g_epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("reactor: epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u64 == 0) run_posts();
+            else dispatch((int)events[i].data.u64, events[i].events);
+        }
+        pthread_mutex_lock(&g_lock);
+        bool stopping = g_stopping;
+        pthread_mutex_unlock(&g_lock);
+        if (stopping) break;
+    }
+    return NULL;
+}
+
+bool reactor_start(void)
+{
+    pthread_mutex_lock(&g_lock);
+    if (g_refs > 0) {
+        g_refs++;
+        pthread_mutex_unlock(&g_lock);
+        return true;
+    }
+    g_epfd = epoll_create1(EPOLL_CLOEXEC);
+    g_wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = 0 };
+    if (g_epfd < 0 || g_wakefd < 0 || epoll_ctl(g_epfd, EPOLL_CTL_ADD, g_wakefd, &ev) < 0) {
+        perror("reactor: setup");
+        goto fail;
+    }
+    g_stopping = false;
+    g_post_head = g_post_len = 0;
+    if (pthread_create(&g_thread, NULL, reactor_loop, NULL) != 0) {
+        perror("reactor: pthread_create");
+        goto fail;
+    }
+    g_refs = 1;
+    pthread_mutex_unlock(&g_lock);
+    return true;
+
+fail:
+    if (g_epfd >= 0) close(g_epfd);
+    if (g_wakefd >= 0) close(g_wakefd);
+    g_epfd = g_wakefd = -1;
+    pthread_mutex_unlock(&g_lock);
+    return false;
+}
+
+void reactor_stop(void)
+{
+    pthread_mutex_lock(&g_lock);
+    if (g_refs == 0 || --g_refs > 0) {
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+    g_stopping = true;
+    pthread_mutex_unlock(&g_lock);
+
+    uint64_t one = 1;
+    if (write(g_wakefd, &one, sizeof(one)) < 0) perror("reactor: wake");
+    pthread_join(g_thread, NULL);
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < REACTOR_MAX_SOURCES; i++) {
+        if (g_sources[i].kind != SRC_FREE) free_source(&g_sources[i]);
+    }
+    close(g_epfd);
+    close(g_wakefd);
+    g_epfd = g_wakefd = -1;
+    g_post_len = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+int reactor_add_fd(int fd, uint32_t events, ReactorFdCallback cb, void *ctx)
+{
+    if (fd < 0 || !cb) return -1;
+    pthread_mutex_lock(&g_lock);
+    int id = add_source(SRC_FD, fd, events, (SourceCallback){ .fd_cb = cb }, ctx);
+    pthread_mutex_unlock(&g_lock);
+    return id;
+}
+
+int reactor_add_timer(int period_ms, ReactorTimerCallback cb, void *ctx)
+{
+    if (period_ms < 0 || !cb) return -1;
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0) {
+        perror("reactor: timerfd_create");
+        return -1;
+    }
+    pthread_mutex_lock(&g_lock);
+    int id = add_source(SRC_TIMER, tfd, EPOLLIN, (SourceCallback){ .timer_cb = cb }, ctx);
+    if (id > 0) arm_timer(tfd, period_ms, period_ms);
+    pthread_mutex_unlock(&g_lock);
+    if (id < 0) close(tfd);
+    return id;
+}
+
+bool reactor_set_timer_period(int id, int period_ms)
+{
+    if (period_ms <= 0) return false;
+    pthread_mutex_lock(&g_lock);
+    Source *s = find_source(id);
+    bool ok = s && s->kind == SRC_TIMER;
+    if (ok) arm_timer(s->fd, period_ms, period_ms);
+    pthread_mutex_unlock(&g_lock);
+    return ok;
+}
+
+bool reactor_arm_timer_once(int id, int delay_ms)
+{
+    if (delay_ms < 0) return false;
+    pthread_mutex_lock(&g_lock);
+    Source *s = find_source(id);
+    bool ok = s && s->kind == SRC_TIMER;
+    if (ok) arm_timer(s->fd, delay_ms, 0);
+    pthread_mutex_unlock(&g_lock);
+    return ok;
+}
+
+bool reactor_remove(int id)
+{
+    pthread_mutex_lock(&g_lock);
+    // Let a running callback finish first: it may still read the timerfd
+    while (!t_in_loop && g_dispatching == id) pthread_cond_wait(&g_idle, &g_lock);
+    Source *s = find_source(id);
+    if (s) free_source(s);
+    pthread_mutex_unlock(&g_lock);
+    return s != NULL;
+}
+
+bool reactor_post(ReactorCallback cb, void *ctx)
+{
+    if (!cb) return false;
+    pthread_mutex_lock(&g_lock);
+    if (g_refs == 0 || g_stopping || g_post_len == REACTOR_POST_QUEUE) {
+        pthread_mutex_unlock(&g_lock);
+        return false;
+    }
+    g_posts[(g_post_head + g_post_len) % REACTOR_POST_QUEUE] = (Post){ cb, ctx };
+    g_post_len++;
+    uint64_t one = 1;
+    bool ok = write(g_wakefd, &one, sizeof(one)) == (ssize_t)sizeof(one);
+    pthread_mutex_unlock(&g_lock);
+    return ok;
+}
+
+bool reactor_in_loop(void)
+{
+    return t_in_loop;
+}
@@ -0,0 +1,393 @@
+/* Simulated GPIO chip for HAL_BACKEND=sim: implements hal/GPIO.h in memory
+ * (see hal/sim.h for the scripting and recording side). */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#include "hal/GPIO.h"
+#include "hal/HC-SR04.h"
+#include "hal/sim.h"
+
+#define MAX_CHIPS 3
+#define MAX_LINES_PER_CHIP 70
+#define SIM_EVENT_QUEUE 16  /* like the hardware backend's event_buffer_size */
+
+/* Speed of sound as used by get_distance(): distance_cm = pulse_us * 0.01716 */
+#define SIM_US_PER_CM (1.0 / 0.01716)
+/* The HC-SR04 raises echo ~450 us after the trigger's falling edge */
+#define SIM_ECHO_DELAY_US 450
+
+typedef struct {
+    bool in_use;
+    bool is_output;
+    bool edges;
+    int  value;
+    /* Scripted input transitions, due times ascending */
+    long long pending_at[SIM_GPIO_MAX_STEPS];
+    int       pending_val[SIM_GPIO_MAX_STEPS];
+    int       pending_head, pending_len;
+    /* Edge events not yet read by wait_pin_edge() */
+    GpioEdgeEvent events[SIM_EVENT_QUEUE];
+    int           ev_head, ev_len;
+} SimLine;
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sim_cond;  /* a script changed */
+static bool            sim_ready = false;
+static SimLine         sim_lines[MAX_CHIPS][MAX_LINES_PER_CHIP];
+
+static SimGpioEdge edge_log[SIM_GPIO_EDGE_LOG];
+static int         edge_head = 0, edge_len = 0;
+static long long   edge_dropped = 0;
+
+static struct {
+    bool      on;
+    int       trig_chip, trig_line;
+    int       echo_chip, echo_line;
+    long long delay_us, pulse_us;
+} echo_responder;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool valid_line(int chip, int line) {
+    return chip >= 0 && chip < MAX_CHIPS && line >= 0 && line < MAX_LINES_PER_CHIP;
+}
+
+static void set_echo_locked(int trig_chip, int trig_line, int echo_chip, int echo_line,
+                            long long delay_us, long long pulse_us) {
+    echo_responder.on = pulse_us >= 0 && valid_line(trig_chip, trig_line) &&
+                        valid_line(echo_chip, echo_line);
+    echo_responder.trig_chip = trig_chip;
+    echo_responder.trig_line = trig_line;
+    echo_responder.echo_chip = echo_chip;
+    echo_responder.echo_line = echo_line;
+    echo_responder.delay_us = delay_us;
+    echo_responder.pulse_us = pulse_us;
+}
+
+static void set_distance_locked(double distance_cm) {
+    long long pulse_us = distance_cm < 0 ? -1 : (long long)(distance_cm * SIM_US_PER_CM + 0.5);
+    set_echo_locked(TRIG_GPIOCHIP, TRIG_GPIO_LINE, ECHO_GPIOCHIP, ECHO_GPIO_LINE,
+                    SIM_ECHO_DELAY_US, pulse_us);
+}
+
+/* Scripts, queued events and logs go; exported lines keep their setup and
+ * level, like a real chip between test runs. */
+static void reset_locked(void) {
+    for (int c = 0; c < MAX_CHIPS; c++) {
+        for (int i = 0; i < MAX_LINES_PER_CHIP; i++) {
+            SimLine *l = &sim_lines[c][i];
+            l->pending_head = l->pending_len = 0;
+            l->ev_head = l->ev_len = 0;
+        }
+    }
+    edge_head = edge_len = 0;
+    edge_dropped = 0;
+
+    const char *env = getenv("HAL_SIM_DISTANCE_CM");
+    set_distance_locked(env && *env ? atof(env) : 100.0);
+}
+
+/* Lazy one-time setup; caller holds sim_lock */
+static void ensure_ready_locked(void) {
+    if (sim_ready) return;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sim_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    reset_locked();
+    sim_ready = true;
+}
+
+static void lock_sim(void) {
+    pthread_mutex_lock(&sim_lock);
+    ensure_ready_locked();
+}
+
+/* Apply scripted transitions that are due by `now`, queueing edge events
+ * stamped with their scheduled time. */
+static void advance_line(SimLine *l, long long now) {
+    while (l->pending_len > 0 && l->pending_at[l->pending_head] <= now) {
+        long long at = l->pending_at[l->pending_head];
+        int v = l->pending_val[l->pending_head];
+        l->pending_head = (l->pending_head + 1) % SIM_GPIO_MAX_STEPS;
+        l->pending_len--;
+        if (v == l->value) continue;
+        l->value = v;
+        if (l->edges && l->ev_len < SIM_EVENT_QUEUE) {
+            GpioEdgeEvent *ev = &l->events[(l->ev_head + l->ev_len) % SIM_EVENT_QUEUE];
+            ev->rising = v != 0;
+            ev->timestamp_ns = (unsigned long long)at;
+            l->ev_len++;
+        }
+    }
+}
+
+static bool push_pending(SimLine *l, long long at, int value) {
+    if (l->pending_len == SIM_GPIO_MAX_STEPS) return false;
+    int i = (l->pending_head + l->pending_len) % SIM_GPIO_MAX_STEPS;
+    l->pending_at[i] = at;
+    l->pending_val[i] = value ? 1 : 0;
+    l->pending_len++;
+    return true;
+}
+
+static long long last_pending_at(const SimLine *l) {
+    if (l->pending_len == 0) return LLONG_MIN;
+    return l->pending_at[(l->pending_head + l->pending_len - 1) % SIM_GPIO_MAX_STEPS];
+}
+
+static void record_edge(int chip, int line, int value, long long ts) {
+    if (edge_len == SIM_GPIO_EDGE_LOG) {
+        /* Keep the newest: overwrite the oldest */
+        edge_head = (edge_head + 1) % SIM_GPIO_EDGE_LOG;
+        edge_len--;
+        edge_dropped++;
+    }
+    SimGpioEdge *e = &edge_log[(edge_head + edge_len) % SIM_GPIO_EDGE_LOG];
+    e->chip = chip;
+    e->line = line;
+    e->value = value;
+    e->timestamp_ns = ts;
+    edge_len++;
+}
+
+/* Drive an output line; caller holds sim_lock */
+static void drive_locked(int chip, int line, int value, long long ts) {
+    SimLine *l = &sim_lines[chip][line];
+    value = value ? 1 : 0;
+    if (l->value == value) return;
+    l->value = value;
+    record_edge(chip, line, value, ts);
+
+    if (echo_responder.on && value == 0 &&
+        chip == echo_responder.trig_chip && line == echo_responder.trig_line) {
+        SimLine *echo = &sim_lines[echo_responder.echo_chip][echo_responder.echo_line];
+        long long rise = ts + echo_responder.delay_us * 1000LL;
+        if (rise < last_pending_at(echo)) rise = last_pending_at(echo);
+        if (push_pending(echo, rise, 1)) {
+            push_pending(echo, rise + echo_responder.pulse_us * 1000LL, 0);
+        }
+        pthread_cond_broadcast(&sim_cond);
+    }
+}
+
+static bool line_init(int chip, int line, bool is_output, bool edges) {
+    if (!valid_line(chip, line)) return false;
+    lock_sim();
+    SimLine *l = &sim_lines[chip][line];
+    advance_line(l, now_ns());
+    l->in_use = true;
+    l->is_output = is_output;
+    l->edges = edges;
+    l->ev_head = l->ev_len = 0;
+    pthread_mutex_unlock(&sim_lock);
+    return true;
+}
+
+bool export_pin(int chip, int line, const char* direction) {
+    if (!direction) return false;
+    return line_init(chip, line, strcmp(direction, "out") == 0, false);
+}
+
+bool export_pin_edges(int chip, int line) {
+    return line_init(chip, line, false, true);
+}
+
+bool set_pin_direction(int chip, int line, const char* direction) {
+    return export_pin(chip, line, direction);
+}
+
+bool write_pin_value(int chip, int line, int value) {
+    if (!valid_line(chip, line)) return false;
+    lock_sim();
+    SimLine *l = &sim_lines[chip][line];
+    bool ok = l->in_use && l->is_output;
+    if (ok) drive_locked(chip, line, value, now_ns());
+    pthread_mutex_unlock(&sim_lock);
+    return ok;
+}
+
+int read_pin_value(int chip, int line) {
+    if (!valid_line(chip, line)) return -1;
+    lock_sim();
+    SimLine *l = &sim_lines[chip][line];
+    int v = -1;
+    if (l->in_use) {
+        advance_line(l, now_ns());
+        v = l->value;
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return v;
+}
+
+int wait_pin_edge(int chip, int line, int timeout_ms, GpioEdgeEvent *ev) {
+    if (!valid_line(chip, line) || !ev) return -1;
+    lock_sim();
+    SimLine *l = &sim_lines[chip][line];
+    if (!l->in_use || !l->edges) {
+        pthread_mutex_unlock(&sim_lock);
+        return -1;
+    }
+
+    long long deadline = timeout_ms < 0 ? LLONG_MAX : now_ns() + timeout_ms * 1000000LL;
+    int rc = 0;
+    for (;;) {
+        long long now = now_ns();
+        advance_line(l, now);
+        if (l->ev_len > 0) {
+            *ev = l->events[l->ev_head];
+            l->ev_head = (l->ev_head + 1) % SIM_EVENT_QUEUE;
+            l->ev_len--;
+            rc = 1;
+            break;
+        }
+        if (now >= deadline) break;
+
+        /* Sleep until the next scripted transition or the timeout; a new
+         * script wakes us through sim_cond */
+        long long until = deadline;
+        if (l->pending_len > 0 && l->pending_at[l->pending_head] < until) {
+            until = l->pending_at[l->pending_head];
+        }
+        if (until == LLONG_MAX) {
+            pthread_cond_wait(&sim_cond, &sim_lock);
+        } else {
+            struct timespec ts = { until / 1000000000LL, until % 1000000000LL };
+            pthread_cond_timedwait(&sim_cond, &sim_lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return rc;
+}
+
+void flush_pin_edges(int chip, int line) {
+    if (!valid_line(chip, line)) return;
+    lock_sim();
+    SimLine *l = &sim_lines[chip][line];
+    advance_line(l, now_ns());
+    l->ev_head = l->ev_len = 0;
+    pthread_mutex_unlock(&sim_lock);
+}
+
+bool export_pin_group(GpioPinGroup *group, int chip, const int *lines, int num_lines,
+                      const char* direction) {
+    if (!group || !lines || !direction ||
+        num_lines < 1 || num_lines > GPIO_GROUP_MAX_LINES) return false;
+    bool is_output = strcmp(direction, "out") == 0;
+    for (int i = 0; i < num_lines; i++) {
+        if (!line_init(chip, lines[i], is_output, false)) return false;
+    }
+    group->chip = chip;
+    group->num_lines = num_lines;
+    memcpy(group->lines, lines, (size_t)num_lines * sizeof(lines[0]));
+    group->line_fd = 0;  /* no real handle; >= 0 marks it requested */
+    group->is_output = is_output;
+    return true;
+}
+
+void release_pin_group(GpioPinGroup *group) {
+    if (!group) return;
+    if (group->num_lines > 0 && group->line_fd >= 0) {
+        lock_sim();
+        for (int i = 0; i < group->num_lines; i++) {
+            sim_lines[group->chip][group->lines[i]].in_use = false;
+        }
+        pthread_mutex_unlock(&sim_lock);
+    }
+    group->line_fd = -1;
+    group->num_lines = 0;
+}
+
+bool write_pin_group(const GpioPinGroup *group, unsigned int mask, unsigned int values) {
+    if (!group || group->num_lines < 1 || group->line_fd < 0 || !group->is_output) return false;
+    lock_sim();
+    /* One timestamp for the whole group, as with a single ioctl */
+    long long ts = now_ns();
+    for (int i = 0; i < group->num_lines; i++) {
+        if (mask & (1u << i)) {
+            drive_locked(group->chip, group->lines[i], (values >> i) & 1u, ts);
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return true;
+}
+
+int read_pin_group(const GpioPinGroup *group, unsigned int mask) {
+    if (!group || group->num_lines < 1 || group->line_fd < 0) return -1;
+    lock_sim();
+    long long now = now_ns();
+    int bits = 0;
+    for (int i = 0; i < group->num_lines; i++) {
+        if (!(mask & (1u << i))) continue;
+        SimLine *l = &sim_lines[group->chip][group->lines[i]];
+        advance_line(l, now);
+        if (l->value) bits |= 1 << i;
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return bits;
+}
+
+/* --- hal/sim.h ----------------------------------------------------------- */
+
+void sim_hal_reset(void) {
+    lock_sim();
+    reset_locked();
+    pthread_cond_broadcast(&sim_cond);
+    pthread_mutex_unlock(&sim_lock);
+    sim_pwm_reset();
+}
+
+bool sim_gpio_script(int chip, int line, const SimGpioStep *steps, int num_steps) {
+    if (!valid_line(chip, line) || (!steps && num_steps > 0)) return false;
+    lock_sim();
+    SimLine *l = &sim_lines[chip][line];
+    bool ok = l->pending_len + num_steps <= SIM_GPIO_MAX_STEPS;
+    if (ok) {
+        long long at = now_ns();
+        if (at < last_pending_at(l)) at = last_pending_at(l);
+        for (int i = 0; i < num_steps; i++) {
+            at += steps[i].after_us * 1000LL;
+            push_pending(l, at, steps[i].value);
+        }
+        pthread_cond_broadcast(&sim_cond);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return ok;
+}
+
+void sim_gpio_set_echo(int trig_chip, int trig_line, int echo_chip, int echo_line,
+                       long long delay_us, long long pulse_us) {
+    lock_sim();
+    set_echo_locked(trig_chip, trig_line, echo_chip, echo_line, delay_us, pulse_us);
+    pthread_mutex_unlock(&sim_lock);
+}
+
+void sim_hc_sr04_set_distance(double distance_cm) {
+    lock_sim();
+    set_distance_locked(distance_cm);
+    pthread_mutex_unlock(&sim_lock);
+}
+
+int sim_gpio_take_edges(SimGpioEdge *out, int max, long long *dropped) {
+    lock_sim();
+    int n = 0;
+    while (out && n < max && edge_len > 0) {
+        out[n++] = edge_log[edge_head];
+        edge_head = (edge_head + 1) % SIM_GPIO_EDGE_LOG;
+        edge_len--;
+    }
+    if (dropped) *dropped = edge_dropped;
+    pthread_mutex_unlock(&sim_lock);
+    return n;
+}
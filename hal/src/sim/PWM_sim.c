@@ -0,0 +1,128 @@
+/* Simulated PWM sysfs for HAL_BACKEND=sim: PWM.c hands every write to
+ * sim_pwm_write(), which records it and tracks each channel's settings. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "hal/PWM.h"
+#include "hal/sim.h"
+
+#define SIM_PWM_CHANNELS 4
+
+typedef struct {
+    const char *enable;   /* identifies the channel (LEDt.enable) */
+    long long   period_ns;
+    long long   duty_ns;
+    bool        enabled;
+} SimPwmChannel;
+
+static pthread_mutex_t pwm_lock = PTHREAD_MUTEX_INITIALIZER;
+static SimPwmChannel   channels[SIM_PWM_CHANNELS];
+static int             num_channels = 0;
+
+static SimPwmWrite write_log[SIM_PWM_WRITE_LOG];
+static int         write_head = 0, write_len = 0;
+static long long   write_dropped = 0;
+
+static const LEDt *const known_leds[] = { &RED_LED, &GREEN_LED };
+
+/* Channel a sysfs path belongs to, created on first use; NULL if the
+ * path isn't one of the known LEDs' files. Caller holds pwm_lock. */
+static SimPwmChannel *channel_for(const char *path, const char **field) {
+    const LEDt *led = NULL;
+    for (size_t i = 0; i < sizeof(known_leds) / sizeof(known_leds[0]) && !led; i++) {
+        const LEDt *l = known_leds[i];
+        if (strcmp(path, l->duty_cycle) == 0) { led = l; *field = "duty_cycle"; }
+        else if (strcmp(path, l->period) == 0) { led = l; *field = "period"; }
+        else if (strcmp(path, l->enable) == 0) { led = l; *field = "enable"; }
+    }
+    if (!led) return NULL;
+
+    for (int i = 0; i < num_channels; i++) {
+        if (channels[i].enable == led->enable) return &channels[i];
+    }
+    if (num_channels == SIM_PWM_CHANNELS) return NULL;
+    SimPwmChannel *c = &channels[num_channels++];
+    memset(c, 0, sizeof(*c));
+    c->enable = led->enable;
+    return c;
+}
+
+bool sim_pwm_write(const char *path, const char *value) {
+    if (!path || !value) return false;
+
+    const char *field = NULL;
+    long long v = atoll(value);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    pthread_mutex_lock(&pwm_lock);
+    SimPwmChannel *c = channel_for(path, &field);
+    if (!c) {
+        pthread_mutex_unlock(&pwm_lock);
+        fprintf(stderr, "sim PWM: no such file '%s'\n", path);
+        return false;
+    }
+    /* The driver rejects a duty cycle longer than the period */
+    if ((strcmp(field, "duty_cycle") == 0 && v > c->period_ns) ||
+        (strcmp(field, "period") == 0 && v < c->duty_ns)) {
+        pthread_mutex_unlock(&pwm_lock);
+        fprintf(stderr, "sim PWM: invalid %s %lld for '%s'\n", field, v, path);
+        return false;
+    }
+    if (strcmp(field, "duty_cycle") == 0) c->duty_ns = v;
+    else if (strcmp(field, "period") == 0) c->period_ns = v;
+    else c->enabled = v != 0;
+
+    if (write_len == SIM_PWM_WRITE_LOG) {
+        write_head = (write_head + 1) % SIM_PWM_WRITE_LOG;
+        write_len--;
+        write_dropped++;
+    }
+    SimPwmWrite *w = &write_log[(write_head + write_len) % SIM_PWM_WRITE_LOG];
+    w->path = path;
+    w->value = v;
+    w->timestamp_ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    write_len++;
+    pthread_mutex_unlock(&pwm_lock);
+    return true;
+}
+
+void sim_pwm_reset(void) {
+    pthread_mutex_lock(&pwm_lock);
+    num_channels = 0;
+    write_head = write_len = 0;
+    write_dropped = 0;
+    pthread_mutex_unlock(&pwm_lock);
+}
+
+int sim_pwm_take_writes(SimPwmWrite *out, int max, long long *dropped) {
+    pthread_mutex_lock(&pwm_lock);
+    int n = 0;
+    while (out && n < max && write_len > 0) {
+        out[n++] = write_log[write_head];
+        write_head = (write_head + 1) % SIM_PWM_WRITE_LOG;
+        write_len--;
+    }
+    if (dropped) *dropped = write_dropped;
+    pthread_mutex_unlock(&pwm_lock);
+    return n;
+}
+
+bool sim_pwm_state(LEDt led, long long *period_ns, long long *duty_ns, bool *enabled) {
+    bool found = false;
+    pthread_mutex_lock(&pwm_lock);
+    for (int i = 0; i < num_channels; i++) {
+        if (channels[i].enable != led.enable) continue;
+        if (period_ns) *period_ns = channels[i].period_ns;
+        if (duty_ns) *duty_ns = channels[i].duty_ns;
+        if (enabled) *enabled = channels[i].enabled;
+        found = true;
+        break;
+    }
+    pthread_mutex_unlock(&pwm_lock);
+    return found;
+}
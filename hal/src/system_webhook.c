@@ -5,76 +5,160 @@
 #include <string.h>
 #include <stdio.h>
 
-// Simple singly-linked queue of strdup'd messages
-typedef struct msg_node {
-    char *msg;
-    struct msg_node *next;
-} msg_node_t;
+// Fixed pool of message slots; each priority class is a FIFO ring of slot
+// indices into the pool. Everything is guarded by queue_lock.
+typedef struct {
+    char     text[HUB_WEBHOOK_MSG_LEN];
+    char     url[HUB_WEBHOOK_URL_LEN];           // "": the default URL
+    char     event_id[HUB_WEBHOOK_EVENT_ID_LEN]; // "": none
+    uint32_t repeat;    // identical messages collapsed into this one
+} msg_slot_t;
 
 static pthread_t worker_thread;
 static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
-static msg_node_t *queue_head = NULL;
-static msg_node_t *queue_tail = NULL;
+static msg_slot_t slots[HUB_WEBHOOK_CAPACITY];
+static int free_slots[HUB_WEBHOOK_CAPACITY];
+static int free_top = 0;
+static int ring[HUB_WEBHOOK_PRIO_COUNT][HUB_WEBHOOK_CAPACITY];
+static int ring_head[HUB_WEBHOOK_PRIO_COUNT];
+static int ring_count[HUB_WEBHOOK_PRIO_COUNT];
+static int queued_total = 0;
+static HubWebhookStats stats;
 static int running = 0;
 static char *g_webhook_url = NULL;
 
-static void enqueue_msg(const char *s)
+static void reset_queue(void)
 {
-    if (!s) return;
-    msg_node_t *n = malloc(sizeof(*n));
-    if (!n) return;
-    n->msg = strdup(s);
-    n->next = NULL;
+    free_top = 0;
+    for (int i = HUB_WEBHOOK_CAPACITY - 1; i >= 0; i--) free_slots[free_top++] = i;
+    memset(ring_head, 0, sizeof(ring_head));
+    memset(ring_count, 0, sizeof(ring_count));
+    queued_total = 0;
+}
 
-    pthread_mutex_lock(&queue_lock);
-    if (queue_tail) queue_tail->next = n; else queue_head = n;
-    queue_tail = n;
+// Remove the oldest slot of class `prio` and return its index.
+static int ring_pop(int prio)
+{
+    int idx = ring[prio][ring_head[prio]];
+    ring_head[prio] = (ring_head[prio] + 1) % HUB_WEBHOOK_CAPACITY;
+    ring_count[prio]--;
+    queued_total--;
+    return idx;
+}
+
+static void ring_push(int prio, int idx)
+{
+    int tail = (ring_head[prio] + ring_count[prio]) % HUB_WEBHOOK_CAPACITY;
+    ring[prio][tail] = idx;
+    ring_count[prio]++;
+    queued_total++;
+    if ((uint32_t)queued_total > stats.max_depth) stats.max_depth = (uint32_t)queued_total;
+}
+
+static bool enqueue_msg(HubWebhookPriority prio, const char *url, const char *event_id,
+                        const char *s)
+{
+    // Collapse into an identical message still waiting in the same class.
+    // Messages with an event id are distinct events and never collapse.
+    for (int i = 0; i < ring_count[prio] && !event_id[0]; i++) {
+        msg_slot_t *m = &slots[ring[prio][(ring_head[prio] + i) % HUB_WEBHOOK_CAPACITY]];
+        if (!m->event_id[0] && strcmp(m->url, url) == 0 &&
+            strncmp(m->text, s, sizeof(m->text) - 1) == 0) {
+            m->repeat++;
+            stats.collapsed++;
+            return true;
+        }
+    }
+
+    if (free_top == 0) {
+        // Full: evict the oldest message of the lowest class below (or, for
+        // informational messages, equal to) the new one
+        int victim = -1;
+        for (int c = HUB_WEBHOOK_PRIO_COUNT - 1; c >= (int)prio; c--) {
+            if (ring_count[c] > 0 && (c > (int)prio || prio == HUB_WEBHOOK_PRIO_INFO)) {
+                victim = c;
+                break;
+            }
+        }
+        if (victim < 0) {
+            stats.rejected[prio]++;
+            return false;
+        }
+        free_slots[free_top++] = ring_pop(victim);
+        stats.evicted[victim]++;
+    }
+
+    int idx = free_slots[--free_top];
+    snprintf(slots[idx].text, sizeof(slots[idx].text), "%s", s);
+    snprintf(slots[idx].url, sizeof(slots[idx].url), "%s", url);
+    snprintf(slots[idx].event_id, sizeof(slots[idx].event_id), "%s", event_id);
+    slots[idx].repeat = 1;
+    ring_push(prio, idx);
+    stats.enqueued++;
     pthread_cond_signal(&queue_cond);
-    pthread_mutex_unlock(&queue_lock);
+    return true;
 }
 
-static char *dequeue_msg(void)
+// Wait for the highest-priority message and copy it out. Returns false
+// once the worker is stopping and the queue is empty.
+static bool dequeue_msg(char *out, size_t out_len, msg_slot_t *meta, int *prio_out)
 {
     pthread_mutex_lock(&queue_lock);
-    while (running && queue_head == NULL) {
+    while (running && queued_total == 0) {
         pthread_cond_wait(&queue_cond, &queue_lock);
     }
-    if (!running && queue_head == NULL) {
+    if (queued_total == 0) {
         pthread_mutex_unlock(&queue_lock);
-        return NULL;
+        return false;
+    }
+    int prio = 0;
+    while (ring_count[prio] == 0) prio++;
+    int idx = ring_pop(prio);
+    *prio_out = prio;
+    memcpy(meta->url, slots[idx].url, sizeof(meta->url));
+    memcpy(meta->event_id, slots[idx].event_id, sizeof(meta->event_id));
+    if (slots[idx].repeat > 1) {
+        snprintf(out, out_len, "%s (x%u)", slots[idx].text, slots[idx].repeat);
+    } else {
+        snprintf(out, out_len, "%s", slots[idx].text);
     }
-    msg_node_t *n = queue_head;
-    queue_head = n->next;
-    if (!queue_head) queue_tail = NULL;
+    free_slots[free_top++] = idx;
     pthread_mutex_unlock(&queue_lock);
-
-    char *m = n->msg;
-    free(n);
-    return m;
+    return true;
 }
 
+// Hand messages to the Discord client highest class first. Security and
+// connectivity messages go out as urgent alerts, so they also overtake
+// routine ones already waiting in the Discord client.
 static void *worker(void *arg)
 {
     (void)arg;
-    while (1) {
-        char *m = dequeue_msg();
-        if (!m) break;
-        if (g_webhook_url) {
-            sendDiscordAlert(g_webhook_url, m);
+    char m[HUB_WEBHOOK_MSG_LEN + 16];
+    msg_slot_t meta;   // url and event id of `m`
+    int prio;
+    while (dequeue_msg(m, sizeof(m), &meta, &prio)) {
+        const char *url = meta.url[0] ? meta.url : g_webhook_url;
+        const char *event_id = meta.event_id[0] ? meta.event_id : NULL;
+        if (url && prio < HUB_WEBHOOK_PRIO_INFO) {
+            sendDiscordAlertUrgent(url, event_id, m);
+        } else if (url) {
+            sendDiscordAlertEvent(url, event_id, m);
         }
-        free(m);
+        pthread_mutex_lock(&queue_lock);
+        stats.sent++;
+        pthread_mutex_unlock(&queue_lock);
     }
     return NULL;
 }
 
 bool hub_webhook_init(const char *webhook_url)
 {
-    if (webhook_url == NULL) return false;
-
-    // store URL
-    g_webhook_url = strdup(webhook_url);
-    if (!g_webhook_url) return false;
+    // default URL, optional
+    if (webhook_url) {
+        g_webhook_url = strdup(webhook_url);
+        if (!g_webhook_url) return false;
+    }
 
     if (!discordStart()) {
         free(g_webhook_url);
@@ -82,7 +166,11 @@ bool hub_webhook_init(const char *webhook_url)
         return false;
     }
 
+    pthread_mutex_lock(&queue_lock);
+    reset_queue();
+    memset(&stats, 0, sizeof(stats));
     running = 1;
+    pthread_mutex_unlock(&queue_lock);
     if (pthread_create(&worker_thread, NULL, worker, NULL) != 0) {
         running = 0;
         discordCleanup();
@@ -103,33 +191,42 @@ void hub_webhook_shutdown(void)
 
     pthread_join(worker_thread, NULL);
 
-    // drain and free any remaining messages
+    // the worker drains the queue before exiting; reset for a later init
     pthread_mutex_lock(&queue_lock);
-    msg_node_t *n = queue_head;
-    while (n) {
-        msg_node_t *next = n->next;
-        free(n->msg);
-        free(n);
-        n = next;
-    }
-    queue_head = queue_tail = NULL;
+    reset_queue();
     pthread_mutex_unlock(&queue_lock);
 
-    if (g_webhook_url) {
-        discordCleanup();
-        free(g_webhook_url);
-        g_webhook_url = NULL;
-    }
+    discordCleanup();
+    free(g_webhook_url);
+    g_webhook_url = NULL;
 }
 
 void hub_webhook_send(const char *msg)
 {
-    if (!msg) return;
+    hub_webhook_send_prio(HUB_WEBHOOK_PRIO_INFO, msg);
+}
+
+bool hub_webhook_send_prio(HubWebhookPriority prio, const char *msg)
+{
+    return hub_webhook_post(prio, NULL, NULL, msg);
+}
+
+bool hub_webhook_post(HubWebhookPriority prio, const char *url, const char *event_id,
+                      const char *msg)
+{
+    if (!msg || prio >= HUB_WEBHOOK_PRIO_COUNT) return false;
+    if (url && strlen(url) >= HUB_WEBHOOK_URL_LEN) return false;
     pthread_mutex_lock(&queue_lock);
-    if (!running) {
-        pthread_mutex_unlock(&queue_lock);
-        return;
-    }
+    bool ok = running && enqueue_msg(prio, url ? url : "", event_id ? event_id : "", msg);
+    pthread_mutex_unlock(&queue_lock);
+    return ok;
+}
+
+void hub_webhook_get_stats(HubWebhookStats *out)
+{
+    if (!out) return;
+    pthread_mutex_lock(&queue_lock);
+    *out = stats;
+    for (int c = 0; c < HUB_WEBHOOK_PRIO_COUNT; c++) out->depth[c] = (uint32_t)ring_count[c];
     pthread_mutex_unlock(&queue_lock);
-    enqueue_msg(msg);
 }